@@ -126,7 +126,3 @@ dhewm WIP		42
 // special game init ids
 #define GAME_INIT_ID_INVALID	(-1)
 #define GAME_INIT_ID_MAP_LOAD	(-2)
-
-// threads
-
-#define MAX_THREADS				(10)
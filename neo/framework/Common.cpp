@@ -30,7 +30,12 @@ If you have questions concerning this license or the applicable additional terms
 
 #include "sys/platform.h"
 #include "idlib/containers/HashTable.h"
+#include "idlib/containers/FlatHashMap.h"
+#include "idlib/containers/ConcurrentQueue.h"
+#include "idlib/hashing/CRC32.h"
+#include "idlib/hashing/SipHash.h"
 #include "idlib/LangDict.h"
+#include "idlib/Arena.h"
 #include "framework/async/AsyncNetwork.h"
 #include "framework/async/NetworkSystem.h"
 #include "framework/BuildVersion.h"
@@ -38,6 +43,7 @@ If you have questions concerning this license or the applicable additional terms
 #include "framework/Console.h"
 #include "framework/KeyInput.h"
 #include "framework/EventLoop.h"
+#include "framework/Profiler.h"
 #include "framework/Common.h"
 
 #define	MAX_PRINT_MSG_SIZE	4096
@@ -85,6 +91,9 @@ idCVar com_timestampPrints( "com_timestampPrints", "0", CVAR_SYSTEM, "print time
 idCVar com_timescale( "timescale", "1", CVAR_SYSTEM | CVAR_FLOAT, "scales the time", 0.1f, 10.0f );
 idCVar com_makingBuild( "com_makingBuild", "0", CVAR_BOOL | CVAR_SYSTEM, "1 when making a build" );
 idCVar com_updateLoadSize( "com_updateLoadSize", "0", CVAR_BOOL | CVAR_SYSTEM | CVAR_NOCHEAT, "update the load size after loading a map" );
+idCVar com_headless( "com_headless", "1", CVAR_BOOL | CVAR_SYSTEM | CVAR_INIT | CVAR_NOCHEAT, "only initialize what the master server needs: no SDL video or joystick, key bindings or SIMD detection beyond CRC32" );
+idCVar com_trace( "com_trace", "1", CVAR_BOOL | CVAR_SYSTEM | CVAR_NOCHEAT, "record the newest runtime trace events per thread for writeTrace" );
+idCVar com_showStartupTimes( "com_showStartupTimes", "0", CVAR_BOOL | CVAR_SYSTEM | CVAR_NOCHEAT, "print how long each init phase took and when the first packet arrived" );
 
 idCVar com_product_lang_ext( "com_product_lang_ext", "1", CVAR_INTEGER | CVAR_SYSTEM | CVAR_ARCHIVE, "Extension to use when creating language files." );
 
@@ -100,6 +109,18 @@ volatile int	com_ticNumber;			// 60 hz tics
 int				com_editors;			// currently opened editor(s)
 bool			com_editorActive;		//  true if an editor has focus
 
+// init phases in the order they finished, see Com_StartupPhase
+typedef struct startupPhase_s {
+	const char *	name;
+	double			usec;				// since the previous phase
+	double			total;				// since idCommon::Init was entered
+} startupPhase_t;
+
+static const int MAX_STARTUP_PHASES = 32;
+static startupPhase_t	com_startupPhases[MAX_STARTUP_PHASES];
+static int				com_numStartupPhases;
+static double			com_startupTime;
+
 #ifdef _WIN32
 HWND			com_hwndMsg = NULL;
 bool			com_outputMsg = false;
@@ -170,6 +191,7 @@ public:
 	void						LocalizeSpecificMapData( const char *fileName, idLangDict &langDict, const idLangDict &replaceArgs );
 
 private:
+	void						InitSDL( void );
 	void						InitCommands( void );
 	void						InitSIMD( void );
 	bool						AddStartupCommands( void );
@@ -201,8 +223,6 @@ private:
 #ifdef ID_WRITE_VERSION
 	idCompressor *				config_compressor;
 #endif
-
-	SDL_TimerID					async_timer;
 };
 
 idCommonLocal	commonLocal;
@@ -227,8 +247,6 @@ idCommonLocal::idCommonLocal( void ) {
 #ifdef ID_WRITE_VERSION
 	config_compressor = NULL;
 #endif
-
-	async_timer = 0;
 }
 
 /*
@@ -310,6 +328,7 @@ A raw string should NEVER be passed as fmt, because of "%f" type crashes.
 ==================
 */
 void idCommonLocal::VPrintf( const char *fmt, va_list args ) {
+	TRACE_SCOPE( "idCommon::VPrintf" );
 	char		msg[MAX_PRINT_MSG_SIZE];
 	int			timeLength;
 
@@ -962,6 +981,9 @@ Returns the key bound to the command
 ===============
 */
 const char* idCommonLocal::KeysFromBinding( const char *bind ) {
+	if ( com_headless.GetBool() ) {
+		return "";
+	}
 	return idKeyInput::KeysFromBinding( bind );
 }
 
@@ -972,6 +994,9 @@ Returns the binding bound to key
 ===============
 */
 const char* idCommonLocal::BindingFromKey( const char *key ) {
+	if ( com_headless.GetBool() ) {
+		return NULL;
+	}
 	return idKeyInput::BindingFromKey( key );
 }
 
@@ -1204,6 +1229,67 @@ static void Com_Quit_f( const idCmdArgs &args ) {
 }
 
 
+/*
+=================
+Com_PrintStartupPhase
+=================
+*/
+static void Com_PrintStartupPhase( const startupPhase_t &phase ) {
+	common->Printf( "%-24s %8.2f msec %9.2f msec total\n", phase.name, phase.usec / 1000.0, phase.total / 1000.0 );
+}
+
+/*
+=================
+Com_StartupPhase
+
+Phases that end before the console is up are kept until Init is done.
+=================
+*/
+void Com_StartupPhase( const char *name ) {
+	if ( com_numStartupPhases >= MAX_STARTUP_PHASES ) {
+		return;
+	}
+
+	startupPhase_t &phase = com_startupPhases[com_numStartupPhases];
+	phase.name = name;
+	phase.total = Sys_Microseconds() - com_startupTime;
+	phase.usec = com_numStartupPhases ? phase.total - com_startupPhases[com_numStartupPhases - 1].total : phase.total;
+	com_numStartupPhases++;
+
+	profiler.AddInstant( name );
+
+	if ( commonLocal.IsInitialized() && com_showStartupTimes.GetBool() ) {
+		Com_PrintStartupPhase( phase );
+	}
+}
+
+/*
+=================
+Com_StartupPhaseTime
+
+Microseconds from entering Init to the end of the named phase, -1 if it hasn't ended.
+=================
+*/
+double Com_StartupPhaseTime( const char *name ) {
+	for ( int i = 0; i < com_numStartupPhases; i++ ) {
+		if ( !idStr::Cmp( com_startupPhases[i].name, name ) ) {
+			return com_startupPhases[i].total;
+		}
+	}
+	return -1.0;
+}
+
+/*
+=================
+Com_StartupTimes_f
+=================
+*/
+static void Com_StartupTimes_f( const idCmdArgs &args ) {
+	for ( int i = 0; i < com_numStartupPhases; i++ ) {
+		Com_PrintStartupPhase( com_startupPhases[i] );
+	}
+}
+
 /*
 =================
 Com_ReloadEngine_f
@@ -1613,6 +1699,30 @@ void Com_Help_f( const idCmdArgs &args ) {
 	common->Printf( "See mapcycle.scriptcfg for an example of a mapcyle script.\n\n" );
 }
 
+/*
+=================
+idCommonLocal::InitSDL
+
+Threads and timers don't go through SDL, the master only needs it for the
+event queue that carries console input. SDL 2 has an events subsystem for
+that, SDL 1.2 ties the event queue to video, so headless only makes a
+difference with SDL 2.
+=================
+*/
+void idCommonLocal::InitSDL( void ) {
+	Uint32 flags = SDL_INIT_VIDEO | SDL_INIT_JOYSTICK; // init joystick to work around SDL 2.0.9 bug #4391
+
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	if ( com_headless.GetBool() ) {
+		flags = SDL_INIT_EVENTS;
+	}
+#endif
+
+	if ( SDL_Init( flags ) ) {
+		Sys_Error( "Error while initializing SDL: %s", SDL_GetError() );
+	}
+}
+
 /*
 =================
 idCommonLocal::InitCommands
@@ -1626,15 +1736,28 @@ void idCommonLocal::InitCommands( void ) {
 	cmdSystem->AddCommand( "exit", Com_Quit_f, CMD_FL_SYSTEM, "exits the game" );
 	cmdSystem->AddCommand( "reloadEngine", Com_ReloadEngine_f, CMD_FL_SYSTEM, "reloads the engine down to including the file system" );
 
+	cmdSystem->AddCommand( "startupTimes", Com_StartupTimes_f, CMD_FL_SYSTEM, "prints how long each init phase took" );
+	cmdSystem->AddCommand( "writeStartupTrace", idProfiler::WriteTrace_f, CMD_FL_SYSTEM, "writes the init phases as Chrome trace event JSON" );
+	cmdSystem->AddCommand( "writeTrace", idTracer::WriteTrace_f, CMD_FL_SYSTEM, "writes the runtime trace buffers as Chrome trace event JSON and clears them" );
+
 	cmdSystem->AddCommand( "printMemInfo", PrintMemInfo_f, CMD_FL_SYSTEM, "prints memory debugging data" );
 
 	// idLib commands
 	cmdSystem->AddCommand( "memoryDump", Mem_Dump_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "creates a memory dump" );
 	cmdSystem->AddCommand( "memoryDumpCompressed", Mem_DumpCompressed_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "creates a compressed memory dump" );
+	cmdSystem->AddCommand( "memClassStats", Mem_ClassStats_f, CMD_FL_SYSTEM, "prints allocations and bytes in use per thread cache size class" );
 	cmdSystem->AddCommand( "showStringMemory", idStr::ShowMemoryUsage_f, CMD_FL_SYSTEM, "shows memory used by strings" );
 	cmdSystem->AddCommand( "showDictMemory", idDict::ShowMemoryUsage_f, CMD_FL_SYSTEM, "shows memory used by dictionaries" );
 	cmdSystem->AddCommand( "listDictKeys", idDict::ListKeys_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "lists all keys used by dictionaries" );
 	cmdSystem->AddCommand( "listDictValues", idDict::ListValues_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "lists all values used by dictionaries" );
+	cmdSystem->AddCommand( "testBitMsg", idBitMsg::Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "test bit message read/write speed" );
+	cmdSystem->AddCommand( "testCRC32", CRC32_Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "test CRC32 implementations for speed and correctness" );
+	cmdSystem->AddCommand( "testArena", idArena::Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "counts heap allocations of request temporaries with and without an arena" );
+	cmdSystem->AddCommand( "testContainers", Container_Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "compares copy and move costs of idList, idStr and idDict" );
+	cmdSystem->AddCommand( "testHashMap", HashMap_Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "times idHashIndex, idHashTable and idFlatHashMap lookups" );
+	cmdSystem->AddCommand( "testQueue", Queue_Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "times lock-free and locked queues with 1 to 8 producer and consumer threads" );
+	cmdSystem->AddCommand( "testHeap", Mem_Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "compares multi-threaded small allocation speed of libc malloc, idHeap and the thread cache" );
+	cmdSystem->AddCommand( "testSipHash", SipHash_Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "compare keyed hash speed with the string hash" );
 
 	// localization
 	cmdSystem->AddCommand( "localizeGuis", Com_LocalizeGuis_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "localize guis" );
@@ -1653,7 +1776,11 @@ idCommonLocal::InitSIMD
 =================
 */
 void idCommonLocal::InitSIMD( void ) {
-	idSIMD::InitProcessor( "doom", com_forceGenericSIMD.GetBool() );
+	// the master does no vector math, the generic implementation idLib::Init set up is enough
+	if ( !com_headless.GetBool() ) {
+		idSIMD::InitProcessor( "doom", com_forceGenericSIMD.GetBool() );
+	}
+	CRC32_InitProcessor( com_forceGenericSIMD.GetBool() );
 	com_forceGenericSIMD.ClearModified();
 }
 
@@ -1665,20 +1792,29 @@ idCommonLocal::Frame
 void idCommonLocal::Frame( void ) {
 	try {
 
-		// pump all the events
-		Sys_GenerateEvents();
+		// run anything that was queued up before going to sleep
+		cmdSystem->ExecuteCommandBuffer();
 
-		// change SIMD implementation if required
-		if ( com_forceGenericSIMD.IsModified() ) {
-			InitSIMD();
+		if ( com_trace.IsModified() ) {
+			tracer.Enable( com_trace.GetBool() );
+			com_trace.ClearModified();
 		}
 
-		eventLoop->RunEventLoop();
+		// sleep until a packet arrives, console input is pending, the next master timer is due
+		// or a signal interrupts the wait
+		idAsyncNetwork::RunFrame();
 
-		com_frameTime = com_ticNumber * USERCMD_MSEC;
+		com_frameTime = Sys_Milliseconds();
 
-		idAsyncNetwork::RunFrame();
+		// pump after every wakeup, SDL turns SIGINT and SIGTERM into an SDL_QUIT event that
+		// only SDL_PumpEvents delivers, and a daemonized master never sees console input
+		Sys_GenerateEvents();
+		eventLoop->RunEventLoop();
 
+		// change SIMD implementation if required
+		if ( com_forceGenericSIMD.IsModified() ) {
+			InitSIMD();
+		}
 
 		// report timing information
 		if ( com_speeds.GetBool() ) {
@@ -1809,20 +1945,6 @@ bool idCommonLocal::IsInitialized( void ) const {
 }
 
 
-static unsigned int AsyncTimer(unsigned int interval, void *) {
-	common->Async();
-	Sys_TriggerEvent(TRIGGER_EVENT_ONE);
-
-	// calculate the next interval to get as close to 60fps as possible
-	unsigned int now = SDL_GetTicks();
-	unsigned int tick = com_ticNumber * USERCMD_MSEC;
-
-	if (now >= tick)
-		return 1;
-
-	return tick - now;
-}
-
 #ifdef _WIN32
 #include "../sys/win32/win_local.h" // for Conbuf_AppendText()
 #endif // _WIN32
@@ -1905,6 +2027,10 @@ void idCommonLocal::Init( int argc, char **argv ) {
 		exit(1);
 	}
 
+	com_startupTime = Sys_Microseconds();
+	com_numStartupPhases = 0;
+	profiler.Reset();
+
 #ifdef ID_DEDICATED
 	// we want to use the SDL event queue for dedicated servers. That
 	// requires video to be initialized, so we just use the dummy
@@ -1917,9 +2043,6 @@ void idCommonLocal::Init( int argc, char **argv ) {
 #endif
 #endif
 
-	if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_JOYSTICK)) // init joystick to work around SDL 2.0.9 bug #4391
-		Sys_Error("Error while initializing SDL: %s", SDL_GetError());
-
 	Sys_InitThreads();
 
 	try {
@@ -1930,8 +2053,13 @@ void idCommonLocal::Init( int argc, char **argv ) {
 		idLib::cvarSystem	= cvarSystem;
 		idLib::fileSystem	= fileSystem;
 
+		// the timer needs idLib::sys
+		idProfileScope init( "idCommon::Init" );
+		idProfileScope phase( "idLib::Init" );
+
 		// initialize idLib
 		idLib::Init();
+		Com_StartupPhase( "idLib" );
 
 		// clear warning buffer
 		ClearWarnings( GAME_NAME " initialization" );
@@ -1940,16 +2068,27 @@ void idCommonLocal::Init( int argc, char **argv ) {
 		ParseCommandLine( argc, argv );
 
 		// init console command system
+		phase.Next( "cmdSystem->Init" );
 		cmdSystem->Init();
 
 		// init CVar system
+		phase.Next( "cvarSystem->Init" );
 		cvarSystem->Init();
 
 		// start file logging right away, before early console or whatever
 		StartupVariable( "win_outputDebugString", false );
 
+		// SDL is initialized according to this
+		StartupVariable( "com_headless", false );
+
 		// register all static CVars
+		phase.Next( "RegisterStaticVars" );
 		idCVar::RegisterStaticVars();
+		Com_StartupPhase( "cmd and cvar systems" );
+
+		phase.Next( "SDL_Init" );
+		InitSDL();
+		Com_StartupPhase( "SDL" );
 
 		// print engine version
 #if SDL_VERSION_ATLEAST(2, 0, 0)
@@ -1962,16 +2101,26 @@ void idCommonLocal::Init( int argc, char **argv ) {
 				version.string, sdlv.major, sdlv.minor, sdlv.patch );
 
 		// initialize key input/binding, done early so bind command exists
-		idKeyInput::Init();
+		// without video there are no key events, so the headless master has no use for bindings
+		if ( !com_headless.GetBool() ) {
+			phase.Next( "idKeyInput::Init" );
+			idKeyInput::Init();
+			Com_StartupPhase( "key input" );
+		}
 
 		// init the console so we can take prints
+		phase.Next( "console->Init" );
 		console->Init();
 
 		// get architecture info
+		phase.Next( "Sys_Init" );
 		Sys_Init();
+		Com_StartupPhase( "console and Sys_Init" );
 
 		// initialize networking
+		phase.Next( "Sys_InitNetworking" );
 		Sys_InitNetworking();
+		Com_StartupPhase( "networking" );
 
 		// override cvars from command line
 		StartupVariable( NULL, false );
@@ -1979,10 +2128,13 @@ void idCommonLocal::Init( int argc, char **argv ) {
 		// set fpu double extended precision
 		Sys_FPU_SetPrecision();
 
-		// initialize processor specific SIMD implementation
+		// initialize processor specific SIMD implementation, headless only picks the CRC32 one
+		phase.Next( "InitSIMD" );
 		InitSIMD();
+		Com_StartupPhase( "SIMD" );
 
 		// init commands
+		phase.Next( "InitCommands" );
 		InitCommands();
 
 #ifdef ID_WRITE_VERSION
@@ -1990,9 +2142,11 @@ void idCommonLocal::Init( int argc, char **argv ) {
 #endif
 
 		// game specific initialization
+		phase.Next( "InitGame" );
 		InitGame();
 
 		// don't add startup commands if no CD key is present
+		phase.Next( "AddStartupCommands" );
 #if ID_ENFORCE_KEY
 		if ( !session->CDKeysAreValid( false ) || !AddStartupCommands() ) {
 #else
@@ -2000,6 +2154,8 @@ void idCommonLocal::Init( int argc, char **argv ) {
 #endif
 			// if the user didn't give any commands, run default action
 		}
+		Com_StartupPhase( "startup commands" );
+		phase.End();
 
 		// print all warnings queued during initialization
 		PrintWarnings();
@@ -2015,16 +2171,19 @@ void idCommonLocal::Init( int argc, char **argv ) {
 		console->LoadHistory();
 
 		com_fullyInitialized = true;
+
+		tracer.Enable( com_trace.GetBool() );
+		com_trace.ClearModified();
+
+		Com_StartupPhase( "init" );
+		if ( com_showStartupTimes.GetBool() ) {
+			Com_StartupTimes_f( idCmdArgs() );
+		}
 	}
 
 	catch( idException & ) {
 		Sys_Error( "Error during initialization" );
 	}
-
-	async_timer = SDL_AddTimer(USERCMD_MSEC, AsyncTimer, NULL);
-
-	if (!async_timer)
-		Sys_Error("Error while starting the async timer: %s", SDL_GetError());
 }
 
 
@@ -2034,11 +2193,6 @@ idCommonLocal::Shutdown
 =================
 */
 void idCommonLocal::Shutdown( void ) {
-	if (async_timer) {
-		SDL_RemoveTimer(async_timer);
-		async_timer = 0;
-	}
-
 	idAsyncNetwork::server.Kill();
 
 	// save persistent console history
@@ -2092,8 +2246,11 @@ idCommonLocal::InitGame
 =================
 */
 void idCommonLocal::InitGame( void ) {
+	idProfileScope phase( "fileSystem->Init" );
+
 	// initialize the file system
 	fileSystem->Init();
+	Com_StartupPhase( "file system" );
 
 	// force r_fullscreen 0 if running a tool
 	CheckToolMode();
@@ -2110,22 +2267,26 @@ void idCommonLocal::InitGame( void ) {
 	idCmdArgs args;
 
 	// initialize string database right off so we can use it for loading messages
+	phase.Next( "InitLanguageDict" );
 	InitLanguageDict();
 
 	// load the font, etc
 	console->LoadGraphics();
 
 	// init journalling, etc
+	phase.Next( "eventLoop->Init" );
 	eventLoop->Init();
 
 	// reload the language dictionary now that we've loaded config files
 	cmdSystem->BufferCommandText( CMD_EXEC_APPEND, "reloadLanguage\n" );
 
 	// run cfg execution
+	phase.Next( "config execution" );
 	cmdSystem->ExecuteCommandBuffer();
 
 	// re-override anything from the config files with command line args
 	StartupVariable( NULL, false );
+	Com_StartupPhase( "configs" );
 
 	// if any archived cvars are modified after this, we will trigger a writing of the config file
 	cvarSystem->ClearModifiedFlags( CVAR_ARCHIVE );
@@ -2134,10 +2295,13 @@ void idCommonLocal::InitGame( void ) {
 	usercmdGen->Init();
 
 	// init async network
+	phase.Next( "idAsyncNetwork::Init" );
 	idAsyncNetwork::Init();
 
+	phase.Next( "InitPort" );
 	idAsyncNetwork::server.InitPort();
 	cvarSystem->SetCVarBool( "s_noSound", true );
+	Com_StartupPhase( "master port" );
 }
 
 /*
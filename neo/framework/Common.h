@@ -73,6 +73,7 @@ extern idCVar		com_showAsyncStats;
 extern idCVar		com_showSoundDecoders;
 extern idCVar		com_makingBuild;
 extern idCVar		com_updateLoadSize;
+extern idCVar		com_headless;
 
 extern int			time_gameFrame;			// game logic time
 extern int			time_gameDraw;			// game present time
@@ -84,6 +85,11 @@ extern volatile int	com_ticNumber;			// 60 hz tics, incremented by async functio
 extern int			com_editors;			// current active editor(s)
 extern bool			com_editorActive;		// true if an editor has focus
 
+// marks the end of an init phase, com_showStartupTimes prints the time since the previous one
+void				Com_StartupPhase( const char *name );
+// microseconds from entering Init to the end of the phase, -1 if it hasn't ended yet
+double				Com_StartupPhaseTime( const char *name );
+
 #ifdef _WIN32
 const char			DMAP_MSGID[] = "DMAPOutput";
 const char			DMAP_DONE[] = "DMAPDone";
@@ -0,0 +1,306 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "sys/platform.h"
+#include "framework/Common.h"
+#include "framework/CmdSystem.h"
+#include "framework/FileSystem.h"
+
+#include "framework/Profiler.h"
+
+idProfiler		profiler;
+idTracer		tracer;
+
+static ID_THREAD_LOCAL traceBuffer_t *	threadTraceBuffer;
+static ID_THREAD_LOCAL bool				threadTraceFull;		// all buffers were taken when the thread first recorded
+
+/*
+================
+idProfiler::idProfiler
+================
+*/
+idProfiler::idProfiler( void ) {
+	numEvents = 0;
+	numDropped = 0;
+	depth = 0;
+	baseTime = 0.0;
+}
+
+/*
+================
+idProfiler::Reset
+================
+*/
+void idProfiler::Reset( void ) {
+	numEvents = 0;
+	numDropped = 0;
+	depth = 0;
+	baseTime = Sys_Microseconds();
+}
+
+/*
+================
+idProfiler::BeginPhase
+================
+*/
+int idProfiler::BeginPhase( const char *name ) {
+	if ( numEvents >= MAX_PROFILE_EVENTS ) {
+		numDropped++;
+		depth++;
+		return -1;
+	}
+
+	profileEvent_t &ev = events[numEvents];
+	ev.name = name;
+	ev.start = Sys_Microseconds() - baseTime;
+	ev.usec = -1.0;
+	ev.depth = depth++;
+	ev.instant = false;
+	return numEvents++;
+}
+
+/*
+================
+idProfiler::EndPhase
+================
+*/
+void idProfiler::EndPhase( int index, const idTimer &timer ) {
+	depth--;
+	if ( index >= 0 && index < numEvents ) {
+		events[index].usec = timer.Microseconds();
+	}
+}
+
+/*
+================
+idProfiler::AddInstant
+================
+*/
+void idProfiler::AddInstant( const char *name ) {
+	if ( numEvents >= MAX_PROFILE_EVENTS ) {
+		numDropped++;
+		return;
+	}
+
+	profileEvent_t &ev = events[numEvents++];
+	ev.name = name;
+	ev.start = Sys_Microseconds() - baseTime;
+	ev.usec = 0.0;
+	ev.depth = depth;
+	ev.instant = true;
+}
+
+/*
+================
+idProfiler::WriteChromeTrace
+
+Phases that are still open are written up to now.
+================
+*/
+bool idProfiler::WriteChromeTrace( const char *fileName ) const {
+	idFile *	f;
+	idStr		name;
+	double		now;
+	int			i;
+
+	f = fileSystem->OpenFileWrite( fileName );
+	if ( !f ) {
+		return false;
+	}
+
+	now = Sys_Microseconds() - baseTime;
+	f->Printf( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	for ( i = 0; i < numEvents; i++ ) {
+		const profileEvent_t &ev = events[i];
+
+		name = ev.name;
+		name.Replace( "\\", "\\\\" );
+		name.Replace( "\"", "\\\"" );
+
+		if ( ev.instant ) {
+			f->Printf( "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":1,\"ts\":%.3f}", name.c_str(), ev.start );
+		} else {
+			f->Printf( "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}", name.c_str(), ev.start,
+				ev.usec >= 0.0 ? ev.usec : now - ev.start );
+		}
+		f->Printf( "%s\n", i < numEvents - 1 ? "," : "" );
+	}
+	f->Printf( "]}\n" );
+
+	fileSystem->CloseFile( f );
+	return true;
+}
+
+/*
+================
+idProfiler::WriteTrace_f
+================
+*/
+void idProfiler::WriteTrace_f( const idCmdArgs &args ) {
+	const char *fileName = ( args.Argc() > 1 ) ? args.Argv( 1 ) : "startup_trace.json";
+
+	if ( !profiler.WriteChromeTrace( fileName ) ) {
+		common->Warning( "couldn't write %s", fileName );
+		return;
+	}
+	common->Printf( "%d profile events written to %s", profiler.NumEvents(), fileName );
+	if ( profiler.NumDropped() ) {
+		common->Printf( ", %d dropped", profiler.NumDropped() );
+	}
+	common->Printf( "\n" );
+}
+
+/*
+================
+idTracer::idTracer
+================
+*/
+idTracer::idTracer( void ) {
+	numBuffers = 0;
+	enabled = false;
+}
+
+/*
+================
+idTracer::GetThreadBuffer
+
+Only the first event of a thread takes the lock.
+================
+*/
+traceBuffer_t *idTracer::GetThreadBuffer( void ) {
+	if ( threadTraceBuffer || threadTraceFull ) {
+		return threadTraceBuffer;
+	}
+
+	const char *threadName = Sys_GetThreadName();
+
+	Sys_EnterCriticalSection();
+	if ( numBuffers < MAX_TRACE_THREADS ) {
+		threadTraceBuffer = &buffers[numBuffers];
+		threadTraceBuffer->numEvents = 0;
+		threadTraceBuffer->threadName = threadName;
+		numBuffers++;
+	} else {
+		threadTraceFull = true;
+	}
+	Sys_LeaveCriticalSection();
+
+	return threadTraceBuffer;
+}
+
+/*
+================
+idTracer::Record
+================
+*/
+void idTracer::Record( const char *name, const idTimer &timer ) {
+	traceBuffer_t *buffer = GetThreadBuffer();
+
+	if ( !buffer ) {
+		return;
+	}
+	traceEvent_t &ev = buffer->events[buffer->numEvents & ( TRACE_BUFFER_EVENTS - 1 )];
+	ev.name = name;
+	ev.start = timer.StartTime();
+	ev.usec = (float)timer.Microseconds();
+	buffer->numEvents++;
+}
+
+/*
+================
+idTracer::Clear
+================
+*/
+void idTracer::Clear( void ) {
+	for ( int i = 0; i < numBuffers; i++ ) {
+		buffers[i].numEvents = 0;
+	}
+}
+
+/*
+================
+idTracer::WriteChromeTrace
+================
+*/
+bool idTracer::WriteChromeTrace( const char *fileName, double baseTime, int &numWritten ) const {
+	idFile *	f;
+	int			i, j, first, last;
+	const char *separator;
+
+	numWritten = 0;
+	f = fileSystem->OpenFileWrite( fileName );
+	if ( !f ) {
+		return false;
+	}
+
+	f->Printf( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	separator = "";
+	for ( i = 0; i < numBuffers; i++ ) {
+		const traceBuffer_t &buffer = buffers[i];
+
+		f->Printf( "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", separator, i + 1, buffer.threadName );
+		separator = ",\n";
+
+		last = buffer.numEvents;
+		first = Max( 0, last - TRACE_BUFFER_EVENTS );
+		for ( j = first; j < last; j++ ) {
+			const traceEvent_t &ev = buffer.events[j & ( TRACE_BUFFER_EVENTS - 1 )];
+			// marker names are literals, they need no escaping
+			f->Printf( "%s{\"name\":\"%s\",\"cat\":\"trace\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				separator, ev.name, i + 1, ev.start - baseTime, ev.usec );
+		}
+		numWritten += last - first;
+	}
+	f->Printf( "\n]}\n" );
+
+	fileSystem->CloseFile( f );
+	return true;
+}
+
+/*
+================
+idTracer::WriteTrace_f
+
+Writes what the buffers hold and empties them, so the next flush starts from here.
+================
+*/
+void idTracer::WriteTrace_f( const idCmdArgs &args ) {
+	const char *fileName = ( args.Argc() > 1 ) ? args.Argv( 1 ) : "trace.json";
+	int numWritten;
+
+	if ( !tracer.IsEnabled() && !tracer.numBuffers ) {
+		common->Printf( "tracing is off, set com_trace 1\n" );
+		return;
+	}
+	if ( !tracer.WriteChromeTrace( fileName, profiler.GetBaseTime(), numWritten ) ) {
+		common->Warning( "couldn't write %s", fileName );
+		return;
+	}
+	tracer.Clear();
+	common->Printf( "%d trace events from %d threads written to %s\n", numWritten, tracer.numBuffers, fileName );
+}
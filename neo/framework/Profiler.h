@@ -0,0 +1,221 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include "idlib/Timer.h"
+
+/*
+===============================================================================
+
+	Phase profiler.
+
+	Records nested, named phases into a fixed buffer, so instrumenting startup
+	doesn't allocate. The timeline can be written as Chrome trace event JSON,
+	load it in chrome://tracing or Perfetto. Only the main thread records phases.
+
+===============================================================================
+*/
+
+const int MAX_PROFILE_EVENTS			= 1024;
+
+typedef struct profileEvent_s {
+	const char *		name;			// not copied, has to outlive the profiler
+	double				start;			// microseconds since Reset
+	double				usec;			// duration, -1 while the phase is open
+	int					depth;			// number of enclosing phases
+	bool				instant;		// a point in time instead of a phase
+} profileEvent_t;
+
+class idProfiler {
+public:
+						idProfiler( void );
+
+	void				Reset( void );
+
+	int					BeginPhase( const char *name );		// returns -1 if the buffer is full
+	void				EndPhase( int index, const idTimer &timer );
+	void				AddInstant( const char *name );
+
+	int					NumEvents( void ) const { return numEvents; }
+	const profileEvent_t &GetEvent( int index ) const { return events[index]; }
+	int					NumDropped( void ) const { return numDropped; }
+	double				GetBaseTime( void ) const { return baseTime; }
+
+	bool				WriteChromeTrace( const char *fileName ) const;
+
+	static void			WriteTrace_f( const class idCmdArgs &args );
+
+private:
+	profileEvent_t		events[MAX_PROFILE_EVENTS];
+	int					numEvents;
+	int					numDropped;
+	int					depth;
+	double				baseTime;
+};
+
+extern idProfiler		profiler;
+
+/*
+===============================================================================
+
+	Times the phase from construction to End, Next or destruction.
+
+	idProfileScope phase( "fileSystem->Init" );
+	fileSystem->Init();
+	phase.Next( "eventLoop->Init" );
+	eventLoop->Init();
+
+===============================================================================
+*/
+
+class idProfileScope {
+public:
+	explicit			idProfileScope( const char *name ) { Begin( name ); }
+						~idProfileScope( void ) { End(); }
+
+	void				Next( const char *name ) { End(); Begin( name ); }
+	void				End( void );
+
+private:
+	idTimer				timer;
+	int					index;
+	bool				open;
+
+	void				Begin( const char *name );
+};
+
+ID_INLINE void idProfileScope::Begin( const char *name ) {
+	index = profiler.BeginPhase( name );
+	open = true;
+	timer.Clear();
+	timer.Start();
+}
+
+ID_INLINE void idProfileScope::End( void ) {
+	if ( open ) {
+		timer.Stop();
+		profiler.EndPhase( index, timer );
+		open = false;
+	}
+}
+
+/*
+===============================================================================
+
+	Runtime tracer.
+
+	Every thread that records gets its own ring buffer of the newest
+	TRACE_BUFFER_EVENTS scopes, so recording takes no lock. writeTrace flushes
+	the buffers to Chrome trace event JSON, on the same time base as the startup
+	profile. Buffers of other threads are read while they may be written, an
+	event that is overwritten during the flush can come out garbled.
+
+	Building with ID_TRACE 0 removes the TRACE_SCOPE markers.
+
+===============================================================================
+*/
+
+#ifndef ID_TRACE
+#define ID_TRACE						1
+#endif
+
+const int MAX_TRACE_THREADS				= 8;
+const int TRACE_BUFFER_EVENTS			= 8192;		// per thread, must be a power of two
+
+typedef struct traceEvent_s {
+	const char *		name;			// not copied, has to outlive the tracer
+	double				start;			// Sys_Microseconds clock
+	float				usec;
+} traceEvent_t;
+
+typedef struct traceBuffer_s {
+	traceEvent_t		events[TRACE_BUFFER_EVENTS];
+	int					numEvents;		// recorded since the last flush, only the newest TRACE_BUFFER_EVENTS are kept
+	const char *		threadName;
+} traceBuffer_t;
+
+class idTracer {
+public:
+						idTracer( void );
+
+	void				Enable( bool enable ) { enabled = enable; }
+	bool				IsEnabled( void ) const { return enabled; }
+
+	void				Record( const char *name, const idTimer &timer );
+	void				Clear( void );
+
+	bool				WriteChromeTrace( const char *fileName, double baseTime, int &numWritten ) const;
+
+	static void			WriteTrace_f( const class idCmdArgs &args );
+
+private:
+	traceBuffer_t		buffers[MAX_TRACE_THREADS];
+	int					numBuffers;
+	bool				enabled;
+
+	traceBuffer_t *		GetThreadBuffer( void );
+};
+
+extern idTracer			tracer;
+
+class idTraceScope {
+public:
+	explicit			idTraceScope( const char *name );
+						~idTraceScope( void );
+
+private:
+	const char *		name;			// NULL if tracing was off when the scope started
+	idTimer				timer;
+};
+
+ID_INLINE idTraceScope::idTraceScope( const char *_name ) {
+	name = tracer.IsEnabled() ? _name : NULL;
+	if ( name ) {
+		timer.Start();
+	}
+}
+
+ID_INLINE idTraceScope::~idTraceScope( void ) {
+	if ( name ) {
+		timer.Stop();
+		tracer.Record( name, timer );
+	}
+}
+
+#define TRACE_CONCAT2( a, b )			a##b
+#define TRACE_CONCAT( a, b )			TRACE_CONCAT2( a, b )
+
+#if ID_TRACE
+#define TRACE_SCOPE( name )				idTraceScope TRACE_CONCAT( traceScope, __LINE__ )( name )
+#else
+#define TRACE_SCOPE( name )
+#endif
+
+#endif /* !__PROFILER_H__ */
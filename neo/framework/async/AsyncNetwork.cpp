@@ -28,7 +28,6 @@ If you have questions concerning this license or the applicable additional terms
 
 #include "sys/platform.h"
 #include "idlib/LangDict.h"
-#include "framework/Console.h"
 
 #include "framework/async/AsyncNetwork.h"
 
@@ -62,8 +61,17 @@ idCVar				idAsyncNetwork::LANServer( "net_LANServer", "0", CVAR_SYSTEM | CVAR_BO
 idCVar				idAsyncNetwork::serverReloadEngine( "net_serverReloadEngine", "0", CVAR_SYSTEM | CVAR_INTEGER | CVAR_NOCHEAT, "perform a full reload on next map restart (including flushing referenced pak files) - decreased if > 0" );
 idCVar				idAsyncNetwork::idleServer( "si_idleServer", "0", CVAR_SYSTEM | CVAR_BOOL | CVAR_INIT | CVAR_SERVERINFO, "game clients are idle" );
 idCVar				idAsyncNetwork::clientDownload( "net_clientDownload", "1", CVAR_SYSTEM | CVAR_INTEGER | CVAR_ARCHIVE, "client pk4 downloads policy: 0 - never, 1 - ask, 2 - always (will still prompt for binary code)" );
+idCVar				idAsyncNetwork::masterProbeInterval( "net_masterProbeInterval", "60", CVAR_SYSTEM | CVAR_INTEGER | CVAR_NOCHEAT, "seconds between serverinfo probes of registered servers, 0 disables probing", 0, 3600 );
+
+idCVar				idAsyncNetwork::masterFilterFile( "net_masterFilterFile", "banlist.txt", CVAR_SYSTEM | CVAR_NOCHEAT, "file with the address ranges to ban or allow, see reloadFilter" );
+idCVar				idAsyncNetwork::masterRegionFile( "net_masterRegionFile", "regions.txt", CVAR_SYSTEM | CVAR_NOCHEAT, "file mapping address ranges to region names, see reloadRegions" );
+idCVar				idAsyncNetwork::masterMaxServersPerSubnet( "net_masterMaxServersPerSubnet", "128", CVAR_SYSTEM | CVAR_INTEGER | CVAR_NOCHEAT, "servers registered per /24 network at most, 0 for no limit", 0, 65535 );
+idCVar				idAsyncNetwork::masterUnverifiedBytes( "net_masterUnverifiedBytes", "1400", CVAR_SYSTEM | CVAR_INTEGER | CVAR_NOCHEAT, "bytes sent every 10 seconds at most to an address that didn't echo its reply cookie, and per reply to legacy getServers requests, 0 for no limit", 0, 1000000 );
+idCVar				idAsyncNetwork::masterCore( "net_masterCore", "-1", CVAR_SYSTEM | CVAR_INTEGER | CVAR_NOCHEAT, "CPU core the thread doing the master's network I/O is pinned to, -1 lets the system schedule it on any core", -1, 1023 );
+idCVar				idAsyncNetwork::masterHttpPort( "net_masterHttpPort", "0", CVAR_SYSTEM | CVAR_INTEGER | CVAR_NOCHEAT, "TCP port serving the server list and statistics as JSON over HTTP, 0 disables it", 0, 65535 );
 
 int					idAsyncNetwork::realTime;
+bool				idAsyncNetwork::masterCorePinned;
 master_t			idAsyncNetwork::masters[ MAX_MASTER_SERVERS ];
 
 /*
@@ -92,6 +100,13 @@ void idAsyncNetwork::Init( void ) {
 
 	cmdSystem->AddCommand( "startMaster", StartMasterServer_f, CMD_FL_SYSTEM, "start master server listening" );
 	cmdSystem->AddCommand( "stopMaster", StopMasterServer_f, CMD_FL_SYSTEM, "top master server listening" );
+	cmdSystem->AddCommand( "reloadFilter", ReloadFilter_f, CMD_FL_SYSTEM, "reloads the address ban list from net_masterFilterFile" );
+	cmdSystem->AddCommand( "reloadRegions", ReloadRegions_f, CMD_FL_SYSTEM, "reloads the address to region table from net_masterRegionFile" );
+	cmdSystem->AddCommand( "masterStats", MasterStats_f, CMD_FL_SYSTEM, "prints master server statistics" );
+	cmdSystem->AddCommand( "testNetFilter", idNetFilter::Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "checks and times address filter lookups" );
+	cmdSystem->AddCommand( "testRegionTable", idRegionTable::Test_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "checks and times address to region lookups" );
+	cmdSystem->AddCommand( "testListCompression", idAsyncServer::TestListCompression_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "compares server list compression ratios and encode times" );
+	cmdSystem->AddCommand( "testStartup", idAsyncServer::TestStartup_f, CMD_FL_SYSTEM|CMD_FL_CHEAT, "checks the time from process start to the first packet, testStartup [maxMsec] [quit]" );
 }
 
 
@@ -110,15 +125,21 @@ void idAsyncNetwork::Shutdown( void ) {
 idAsyncNetwork::RunFrame
 ==================
 */
-void idAsyncNetwork::RunFrame( void ) {
-	if ( console->Active() ) {
-		Sys_GrabMouseCursor( false );
-		usercmdGen->InhibitUsercmd( INHIBIT_ASYNC, true );
-	} else {
-		Sys_GrabMouseCursor( true );
-		usercmdGen->InhibitUsercmd( INHIBIT_ASYNC, false );
+int idAsyncNetwork::RunFrame( void ) {
+	// the network I/O runs on the thread calling RunFrame, leave the affinity
+	// the process was started with alone until a core is asked for
+	if ( masterCore.IsModified() ) {
+		masterCore.ClearModified();
+		if ( masterCore.GetInteger() >= 0 || masterCorePinned ) {
+			if ( Sys_SetThreadAffinity( NULL, masterCore.GetInteger() ) ) {
+				masterCorePinned = ( masterCore.GetInteger() >= 0 );
+			} else {
+				common->Warning( "can't set the network thread affinity to core %d", masterCore.GetInteger() );
+			}
+		}
 	}
-	server.RunFrame();
+
+	return server.RunFrame();
 }
 
 /*
@@ -139,4 +160,31 @@ idAsyncNetwork::StopMasterServer_f
 void idAsyncNetwork::StopMasterServer_f( const idCmdArgs &args ) {
 	server.active = false;
 	common->Printf("Master server stopped\n");
-}
\ No newline at end of file
+}
+
+/*
+=================
+idAsyncNetwork::ReloadFilter_f
+=================
+*/
+void idAsyncNetwork::ReloadFilter_f( const idCmdArgs &args ) {
+	server.LoadFilter( true );
+}
+
+/*
+=================
+idAsyncNetwork::ReloadRegions_f
+=================
+*/
+void idAsyncNetwork::ReloadRegions_f( const idCmdArgs &args ) {
+	server.LoadRegions( true );
+}
+
+/*
+=================
+idAsyncNetwork::MasterStats_f
+=================
+*/
+void idAsyncNetwork::MasterStats_f( const idCmdArgs &args ) {
+	server.PrintStats();
+}
@@ -119,7 +119,7 @@ public:
 	static void				Init( void );
 	static void				Shutdown( void );
 	static bool				IsActive( void ) { return ( server.IsActive() ); }
-	static void				RunFrame( void );
+	static int				RunFrame( void );			// returns Sys_WaitForEvents flags
 
 	static idAsyncServer	server;
 
@@ -150,16 +150,27 @@ public:
 	static idCVar			serverAllowServerMod;			// let a pure server start with a different game code than what is referenced in game code
 	static idCVar			idleServer;						// serverinfo reply, indicates all clients are idle
 	static idCVar			clientDownload;					// preferred download policy
+	static idCVar			masterProbeInterval;			// seconds between serverinfo probes of registered servers
+	static idCVar			masterFilterFile;				// ban and allow ranges
+	static idCVar			masterRegionFile;				// address prefix to region table
+	static idCVar			masterMaxServersPerSubnet;		// heartbeats from a full subnet are ignored
+	static idCVar			masterUnverifiedBytes;			// reply budget for sources without a cookie
+	static idCVar			masterHttpPort;					// JSON list and stats over HTTP, 0 disables it
+	static idCVar			masterCore;						// core the network thread is pinned to, -1 for any
 
 	// same message used for offline check and network reply
 	static void				BuildInvalidKeyMsg( idStr &msg, bool valid[ 2 ] );
 
 private:
 	static int				realTime;
+	static bool				masterCorePinned;				// net_masterCore moved the network thread off its startup cores
 	static master_t			masters[ MAX_MASTER_SERVERS];	// master1 etc.
 
 	static void				StartMasterServer_f( const idCmdArgs &args );
 	static void				StopMasterServer_f( const idCmdArgs &args );
+	static void				ReloadFilter_f( const idCmdArgs &args );
+	static void				ReloadRegions_f( const idCmdArgs &args );
+	static void				MasterStats_f( const idCmdArgs &args );
 };
 
 #endif /* !__ASYNCNETWORK_H__ */
@@ -28,7 +28,10 @@ If you have questions concerning this license or the applicable additional terms
 
 #include "sys/platform.h"
 #include "idlib/LangDict.h"
+#include "idlib/Arena.h"
+#include "idlib/hashing/SipHash.h"
 #include "framework/async/AsyncNetwork.h"
+#include "framework/Profiler.h"
 
 const int MIN_RECONNECT_TIME			= 2000;
 const int EMPTY_RESEND_TIME				= 500;
@@ -37,6 +40,34 @@ const int NOINPUT_IDLE_TIME				= 30000;
 
 const int HEARTBEAT_MSEC				= 5*60*1000;
 
+// servers heartbeat every HEARTBEAT_MSEC, one lost heartbeat is tolerated before they are dropped
+const int SERVER_TIMEOUT				= 2*HEARTBEAT_MSEC + 30000;
+
+// packets handled per wakeup at most, so console input still gets through while flooded
+const int MAX_PACKETS_PER_FRAME			= 256;
+
+// getInfo probes are sent in small bursts so a large registry doesn't flood the uplink
+const int MAX_PROBES_PER_FRAME			= 32;
+const int PROBE_BURST_DELAY				= 50;
+
+// cached serverinfo is dropped when this many probes in a row went unanswered
+const int MAX_MISSED_PROBES				= 3;
+
+// reply cookies change this often, the one from the previous period is still accepted
+const int REPLY_COOKIE_MSEC				= 30000;
+
+// net_masterUnverifiedBytes applies per window of this length
+const int REPLY_WINDOW_MSEC				= 10000;
+
+// most ports sent in one group of a grouped list, servers on the same ip past that start a new group
+const int MAX_GROUP_PORTS				= 255;
+
+// serversInfo and serversDelta replies are split in packets of about this size, entries are never split
+const int MAX_INFO_PACKET_SIZE			= 1400;
+
+// time from process start to the first processed packet testStartup allows by default
+const int DEFAULT_STARTUP_BUDGET_MSEC	= 500;
+
 const char* authReplyStr[] = {
 	"AUTH_NONE",
 	"AUTH_OK",
@@ -59,15 +90,38 @@ idAsyncServer::idAsyncServer( void ) {
 	gameInitId = 0;
 	gameFrame = 0;
 	gameTime = 0;
-	gameTimeResidual = 0;
 	memset( challenges, 0, sizeof( challenges ) );
 	memset( userCmds, 0, sizeof( userCmds ) );
 	serverReloadingEngine = false;
 	nextHeartbeatTime = 0;
 	nextAsyncStatsTime = 0;
+	nextExpireTime = 0;
+	nextProbeTime = 0;
+	listGeneration = 0;
+	listHistoryNum = 0;
+	listCacheGeneration = 0;
+	listCacheValid = false;
 	noRconOutput = true;
 	lastAuthTime = 0;
+	serverPool.Clear();
 	servers.Clear();
+	serverHash.Clear();
+	numSortedServers = 0;
+	numFilteredPackets = 0;
+	receivedPacket = false;
+	startupBudget = -1;
+	startupQuit = false;
+	frameArena = NULL;
+	numQuotaRefused = 0;
+	memset( replySources, 0, sizeof( replySources ) );
+	replySource = NULL;
+	replyActive = false;
+	replyBudget = -1;
+	replySent = 0;
+	replyStartTime = 0;
+	memset( &replyStats, 0, sizeof( replyStats ) );
+	listJSON = NULL;
+	listJSONGeneration = 0;
 	memset( stats_outrate, 0, sizeof( stats_outrate ) );
 	stats_current = 0;
 	stats_average_sum = 0;
@@ -85,6 +139,15 @@ bool idAsyncServer::InitPort( void ) {
 
 	// if this is the first time we have spawned a server, open the UDP port
 	if ( !serverPort.GetPort() ) {
+		// start from an unpredictable list generation so clients still holding one from a previous run get a full list
+		unsigned int seed = Sys_Milliseconds();
+		listGeneration = (int)( SipHash_BlockChecksum( &seed, sizeof( seed ) ) & 0x3fffffff );
+		listHistoryNum = 0;
+		listCacheValid = false;
+
+		LoadFilter( false );
+		LoadRegions( false );
+
 		if ( cvarSystem->GetCVarInteger( "net_port" ) != 0 ) {
 			if ( !serverPort.InitForPort( cvarSystem->GetCVarInteger( "net_port" ) ) ) {
 				common->Printf( "Unable to open server on port %d (net_port)\n", cvarSystem->GetCVarInteger( "net_port" ) );
@@ -102,6 +165,11 @@ bool idAsyncServer::InitPort( void ) {
 				return false;
 			}
 		}
+
+		// the web listener is optional, the master works without it
+		if ( idAsyncNetwork::masterHttpPort.GetInteger() ) {
+			http.Init( idAsyncNetwork::masterHttpPort.GetInteger(), HttpHandler, this, &filter );
+		}
 	}
 
 	return true;
@@ -119,6 +187,12 @@ void idAsyncServer::ClosePort( void ) {
 	for ( i = 0; i < MAX_CHALLENGES; i++ ) {
 		challenges[ i ].authReplyPrint.Clear();
 	}
+
+	http.Shutdown();
+	if ( listJSON ) {
+		listJSON->Release();
+		listJSON = NULL;
+	}
 }
 
 /*
@@ -203,13 +277,13 @@ int idAsyncServer::GetIncomingRate( void ) const {
 idAsyncServer::ProcessMessage
 ==================
 */
-bool idAsyncServer::ProcessMessage( const netadr_t from, idBitMsg &msg ) {
+bool idAsyncServer::ProcessMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "idAsyncServer::ProcessMessage" );
 	int			id;
-	idBitMsg	outMsg;
 
 	id = msg.ReadShort();
 
-	if ( msg.GetRemaingData() < 4 ) {
+	if ( msg.GetRemainingData() < 4 ) {
 		common->DPrintf( "%s: tiny packet\n", Sys_NetAdrToString( from ) );
 		return false;
 	}
@@ -227,70 +301,460 @@ bool idAsyncServer::ProcessMessage( const netadr_t from, idBitMsg &msg ) {
 
 /*
 ==================
-idAsyncServer::UpdateTime
+idAsyncServer::RunFrame
+
+Sleeps until a packet arrives, console input is pending, an HTTP connection is ready
+or the next server expires.
+Returns the Sys_WaitForEvents flags.
 ==================
 */
-int idAsyncServer::UpdateTime( int clamp ) {
-	int time, msec;
+int idAsyncServer::RunFrame( void ) {
+	int			i, timeout, httpTimeout, events, size, numSockets;
+	idMsgView	msg;
+	netadr_t	from;
+	idTCP *		sockets[MAX_HTTP_CONNECTIONS + 1];
+
+	realTime = Sys_Milliseconds();
+
+	// nothing is scheduled unless there are servers that can time out or need probing
+	timeout = -1;
+	if ( active && servers.Num() ) {
+		timeout = Max( 0, nextExpireTime - realTime );
+		if ( idAsyncNetwork::masterProbeInterval.GetInteger() ) {
+			timeout = Min( timeout, Max( 0, nextProbeTime - realTime ) );
+		}
+	}
+
+	// wake up now and then to drop idle connections or to retry a failed accept
+	numSockets = http.GetWaitSockets( sockets, MAX_HTTP_CONNECTIONS + 1, realTime );
+	httpTimeout = http.GetWaitTimeout( realTime );
+	if ( httpTimeout >= 0 ) {
+		timeout = ( timeout < 0 ) ? httpTimeout : Min( timeout, httpTimeout );
+	}
+
+	{
+		TRACE_SCOPE( "Sys_WaitForEvents" );
+		events = Sys_WaitForEvents( serverPort, timeout, sockets, numSockets );
+	}
+
+	// the wait isn't part of the frame
+	TRACE_SCOPE( "idAsyncServer::RunFrame" );
+
+	realTime = Sys_Milliseconds();
+	serverTime = realTime;
+
+	// everything the handlers build for this batch of packets comes from one arena
+	frameArena = arenaPool.Get();
+
+	if ( events & SYS_WAIT_PACKET ) {
+		// drain whatever queued up while we were asleep
+		for ( i = 0; i < MAX_PACKETS_PER_FRAME; i++ ) {
+			if ( !serverPort.GetPacket( from, packetBuf, size, MAX_MESSAGE_SIZE ) ) {
+				break;
+			}
+			if ( !active ) {
+				continue;
+			}
+			if ( filter.IsBanned( from ) ) {
+				numFilteredPackets++;
+				continue;
+			}
+			// the handlers parse in place, keep strings at the end of the packet terminated
+			packetBuf[size] = 0;
+			msg.Init( packetBuf, size );
+			ProcessMessage( from, msg );
+			if ( !receivedPacket ) {
+				receivedPacket = true;
+				Com_StartupPhase( "first packet" );
+				CheckStartupTime();
+			}
+		}
+	}
+
+	SortServers();
+
+	// HTTP sockets are non blocking, this never waits on a slow client
+	http.RunFrame( realTime );
+
+	if ( active && servers.Num() && realTime - nextExpireTime >= 0 ) {
+		ExpireServers();
+	}
+
+	if ( active && servers.Num() && idAsyncNetwork::masterProbeInterval.GetInteger() && realTime - nextProbeTime >= 0 ) {
+		ProbeServers();
+	}
+
+	arenaPool.Release( frameArena );
+	frameArena = NULL;
 
-	time = Sys_Milliseconds();
-	msec = idMath::ClampInt( 0, clamp, time - realTime );
-	realTime = time;
-	serverTime += msec;
-	return msec;
+	return events;
 }
 
 /*
 ==================
-idAsyncServer::RunFrame
+idAsyncServer::RemoveServer
 ==================
 */
-void idAsyncServer::RunFrame( void ) {
-	int			msec, size;
-	idBitMsg	msg;
-	byte		msgBuf[MAX_MESSAGE_SIZE];
-	netadr_t	from;
-	bool		newPacket;
-	msec = UpdateTime( 100 );
+void idAsyncServer::RemoveServer( int index ) {
+	serverData_t *sv = servers[index];
+	slotHandle_t handle = serverPool.GetHandle( sv );
+
+	serverHash.Remove( ServerHashKey( sv->address ), handle.index );
+	AdjustSubnetCount( sv->address, -1 );
+	RecordListChange( sv->address, false );
+	serverPool.Free( handle );
+	servers.RemoveIndex( index );
+	if ( index < numSortedServers ) {
+		numSortedServers--;
+	}
+}
 
-	if ( !serverPort.GetPort() ) {
-		return;
+/*
+==================
+idAsyncServer::FindSubnet
+==================
+*/
+int idAsyncServer::FindSubnet( unsigned int subnet ) const {
+	int i;
+
+	for ( i = subnetHash.First( subnetHash.GenerateSecureKey( &subnet, sizeof( subnet ) ) ); i != -1; i = subnetHash.Next( i ) ) {
+		if ( subnetCounts[i].subnet == subnet ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+==================
+idAsyncServer::SubnetServerCount
+==================
+*/
+int idAsyncServer::SubnetServerCount( const netadr_t &adr ) const {
+	int i = FindSubnet( Net_AdrToIP( adr ) & ( 0xffffffffu << ( 32 - SUBNET_QUOTA_BITS ) ) );
+	return ( i == -1 ) ? 0 : subnetCounts[i].count;
+}
+
+/*
+==================
+idAsyncServer::AdjustSubnetCount
+
+Subnets without servers are dropped by moving the last entry into their slot.
+==================
+*/
+void idAsyncServer::AdjustSubnetCount( const netadr_t &adr, int delta ) {
+	unsigned int subnet;
+	int i, last;
+
+	subnet = Net_AdrToIP( adr ) & ( 0xffffffffu << ( 32 - SUBNET_QUOTA_BITS ) );
+	i = FindSubnet( subnet );
+	if ( i == -1 ) {
+		if ( delta <= 0 ) {
+			return;
+		}
+		subnetCount_t &sc = subnetCounts.Alloc();
+		sc.subnet = subnet;
+		sc.count = 0;
+		i = subnetCounts.Num() - 1;
+		subnetHash.Add( subnetHash.GenerateSecureKey( &subnet, sizeof( subnet ) ), i );
 	}
 
-	if (!active) {
+	subnetCounts[i].count += delta;
+	if ( subnetCounts[i].count > 0 ) {
 		return;
 	}
 
-	gameTimeResidual += msec;
+	last = subnetCounts.Num() - 1;
+	subnetHash.Remove( subnetHash.GenerateSecureKey( &subnet, sizeof( subnet ) ), i );
+	if ( i != last ) {
+		subnet = subnetCounts[last].subnet;
+		subnetHash.Remove( subnetHash.GenerateSecureKey( &subnet, sizeof( subnet ) ), last );
+		subnetCounts[i] = subnetCounts[last];
+		subnetHash.Add( subnetHash.GenerateSecureKey( &subnet, sizeof( subnet ) ), i );
+	}
+	subnetCounts.SetNum( last, false );
+}
+
+/*
+==================
+CompareSubnetCounts
+==================
+*/
+static int CompareSubnetCounts( const subnetCount_t *a, const subnetCount_t *b ) {
+	return b->count - a->count;
+}
 
+/*
+==================
+idAsyncServer::PrintStats
+==================
+*/
+void idAsyncServer::PrintStats( void ) const {
+	idList<subnetCount_t> busiest;
+	int i;
 
-	// spin in place processing incoming packets until enough time lapsed to run a new game frame
-	do {
+	common->Printf( "%5d servers registered on %d /%d networks, at most %d per network\n", servers.Num(), subnetCounts.Num(),
+		SUBNET_QUOTA_BITS, idAsyncNetwork::masterMaxServersPerSubnet.GetInteger() );
+	common->Printf( "%5d heartbeats refused because the network was full\n", numQuotaRefused );
+	common->Printf( "%5d packets dropped by the address filter (%d rules)\n", numFilteredPackets, filter.NumRules() );
+	if ( regions.NumRegions() ) {
+		idList<int> regionCounts;
+		regionCounts.AssureSize( regions.NumRegions() + 1, 0 );
+		for ( i = 0; i < serverPool.Num(); i++ ) {
+			regionCounts[serverPool[i]->region + 1]++;
+		}
+		common->Printf( "      servers per region:" );
+		for ( i = 0; i < regionCounts.Num(); i++ ) {
+			if ( regionCounts[i] ) {
+				common->Printf( " %s %d", regions.GetRegionName( i - 1 ), regionCounts[i] );
+			}
+		}
+		common->Printf( "\n" );
+	}
+	common->Printf( "%5d list requests with a valid cookie, %d with a bad one\n", replyStats.verified, replyStats.badCookies );
+	common->Printf( "%5d list requests without a cookie, %d cut short, %d not answered\n", replyStats.unverified, replyStats.truncated, replyStats.dropped );
+	common->Printf( "      %d bytes and %.1f msec spent on requests without a cookie\n", replyStats.unverifiedBytes, replyStats.unverifiedUsec / 1000.0 );
+	if ( http.IsActive() ) {
+		const httpStats_t &hs = http.GetStats();
+		common->Printf( "%5d HTTP requests on port %d, %d errors, %d bytes sent\n", hs.requests, http.GetPort(), hs.errors, hs.bytesSent );
+		common->Printf( "      %d connections open, %d accepted, %d refused\n", http.NumConnections(), hs.connections, hs.refused );
+	}
 
-		do {
+	busiest = subnetCounts;
+	busiest.Sort( CompareSubnetCounts );
+	for ( i = 0; i < busiest.Num() && i < 10; i++ ) {
+		unsigned int subnet = busiest[i].subnet;
+		common->Printf( "  %3d servers on %u.%u.%u.0/%d\n", busiest[i].count, subnet >> 24, ( subnet >> 16 ) & 0xff, ( subnet >> 8 ) & 0xff, SUBNET_QUOTA_BITS );
+	}
+}
 
-			// blocking read with game time residual timeout
-			newPacket = serverPort.GetPacketBlocking( from, msgBuf, size, sizeof( msgBuf ), USERCMD_MSEC - gameTimeResidual - 1 );
-			if ( newPacket ) {
-				msg.Init( msgBuf, sizeof( msgBuf ) );
-				msg.SetSize( size );
-				msg.BeginReading();
-				if ( ProcessMessage( from, msg ) ) {
-					return;
-				}
+/*
+==================
+idAsyncServer::HttpHandler
+
+/servers is the cached list, /stats what masterStats prints.
+==================
+*/
+idHttpBody *idAsyncServer::HttpHandler( void *context, const char *path ) {
+	idAsyncServer *server = static_cast<idAsyncServer *>( context );
+
+	if ( !idStr::Cmp( path, "/servers" ) || !idStr::Cmp( path, "/servers.json" ) ) {
+		return server->GetListJSON();
+	}
+	if ( !idStr::Cmp( path, "/stats" ) || !idStr::Cmp( path, "/stats.json" ) ) {
+		return server->GetStatsJSON();
+	}
+	return NULL;
+}
+
+/*
+==================
+idAsyncServer::GetListJSON
+
+Built from the same cache as the UDP list replies and kept until the list changes,
+connections still sending an older one keep it alive.
+==================
+*/
+idHttpBody *idAsyncServer::GetListJSON( void ) {
+	int i;
+
+	UpdateListCache();
+	if ( !listJSON || listJSONGeneration != listCacheGeneration ) {
+		if ( listJSON ) {
+			listJSON->Release();
+		}
+		listJSON = new idHttpBody( "application/json" );
+		listJSONGeneration = listCacheGeneration;
+
+		// idStr grows in small steps, so size it for the whole list up front
+		idStr &text = listJSON->text;
+		text.ReAllocate( plainListCache.Num() / 6 * 64 + 64, false );
+		text = va( "{\"generation\":%d,\"servers\":[", listCacheGeneration );
+		for ( i = 0; i < plainListCache.Num(); i += 6 ) {
+			const byte *p = &plainListCache[i];
+			text += va( "%s{\"ip\":\"%d.%d.%d.%d\",\"port\":%d,\"region\":\"%s\"}", i ? "," : "", p[0], p[1], p[2], p[3], p[4] | ( p[5] << 8 ),
+				regions.GetRegionName( regionListCache[i / 6] ) );
+		}
+		text += "]}\n";
+	}
+	listJSON->AddRef();
+	return listJSON;
+}
+
+/*
+==================
+idAsyncServer::GetStatsJSON
+==================
+*/
+idHttpBody *idAsyncServer::GetStatsJSON( void ) const {
+	const httpStats_t &hs = http.GetStats();
+	idHttpBody *body = new idHttpBody( "application/json" );
+
+	body->text = va( "{\"servers\":%d,\"subnets\":%d,\"quotaRefused\":%d,\"filterRules\":%d,\"filteredPackets\":%d,",
+		servers.Num(), subnetCounts.Num(), numQuotaRefused, filter.NumRules(), numFilteredPackets );
+	body->text += va( "\"replies\":{\"verified\":%d,\"unverified\":%d,\"badCookies\":%d,\"truncated\":%d,\"dropped\":%d,\"unverifiedBytes\":%d,\"unverifiedUsec\":%.0f},",
+		replyStats.verified, replyStats.unverified, replyStats.badCookies, replyStats.truncated, replyStats.dropped, replyStats.unverifiedBytes, replyStats.unverifiedUsec );
+	body->text += va( "\"http\":{\"connections\":%d,\"open\":%d,\"refused\":%d,\"requests\":%d,\"errors\":%d,\"bytesSent\":%d}}\n",
+		hs.connections, http.NumConnections(), hs.refused, hs.requests, hs.errors, hs.bytesSent );
+	return body;
+}
+
+/*
+==================
+idAsyncServer::LoadFilter
+
+Reads net_masterFilterFile and drops registered servers that are banned now.
+Dropping them bumps the list generation, so the cached lists are rebuilt as well.
+==================
+*/
+bool idAsyncServer::LoadFilter( bool verbose ) {
+	int i, j, start, num, numPurged;
+	const char *fileName = idAsyncNetwork::masterFilterFile.GetString();
+
+	if ( !fileName[0] ) {
+		filter.Clear();
+		return true;
+	}
+	if ( !filter.LoadFile( fileName ) ) {
+		if ( verbose ) {
+			common->Warning( "couldn't load filter file '%s'", fileName );
+		}
+		return false;
+	}
+
+	numPurged = 0;
+	for ( i = 0; i < filter.NumRules(); i++ ) {
+		const filterRule_t &rule = filter.GetRule( i );
+		if ( rule.action != FILTER_BAN ) {
+			continue;
+		}
+		start = FindServerRange( rule.prefix, rule.numBits, num );
+		for ( j = start + num - 1; j >= start; j-- ) {
+			if ( filter.IsBanned( servers[j]->address ) ) {
+				common->Printf( "Server %s is banned\n", Sys_NetAdrToString( servers[j]->address ) );
+				RemoveServer( j );
+				numPurged++;
 			}
+		}
+	}
+
+	common->Printf( "%d address filter rules loaded from %s, %d servers dropped\n", filter.NumRules(), fileName, numPurged );
+	return true;
+}
+
+/*
+==================
+idAsyncServer::LoadRegions
 
-			msec = UpdateTime( 100 );
-			gameTimeResidual += msec;
+Reads net_masterRegionFile and tags the registered servers again.
+The list generation doesn't change, so the cached lists are dropped by hand.
+==================
+*/
+bool idAsyncServer::LoadRegions( bool verbose ) {
+	int i;
+	const char *fileName = idAsyncNetwork::masterRegionFile.GetString();
+
+	if ( !fileName[0] ) {
+		regions.Clear();
+	} else if ( !regions.LoadFile( fileName ) ) {
+		if ( verbose ) {
+			common->Warning( "couldn't load region file '%s'", fileName );
+		}
+		return false;
+	}
+
+	for ( i = 0; i < serverPool.Num(); i++ ) {
+		serverPool[i]->region = regions.Lookup( serverPool[i]->address );
+	}
+	listCacheValid = false;
+	if ( listJSON ) {
+		listJSON->Release();
+		listJSON = NULL;
+	}
 
-		} while( newPacket );
+	if ( fileName[0] ) {
+		common->Printf( "%d regions in %d address ranges loaded from %s\n", regions.NumRegions(), regions.NumIntervals(), fileName );
+	}
+	return true;
+}
 
-	} while( gameTimeResidual < USERCMD_MSEC );
+/*
+==================
+idAsyncServer::ExpireServers
+==================
+*/
+void idAsyncServer::ExpireServers( void ) {
+	int i;
 
-	idAsyncNetwork::serverMaxClientRate.ClearModified();
+	nextExpireTime = realTime + SERVER_TIMEOUT;
+	for ( i = servers.Num() - 1; i >= 0; i-- ) {
+		int expireTime = servers[i]->lastHeartbeatTime + SERVER_TIMEOUT;
+		if ( realTime - expireTime >= 0 ) {
+			common->Printf( "Server %s timed out\n", Sys_NetAdrToString( servers[i]->address ) );
+			RemoveServer( i );
+		} else if ( expireTime - nextExpireTime < 0 ) {
+			nextExpireTime = expireTime;
+		}
+	}
 }
 
 
+/*
+==================
+idAsyncServer::ProbeServers
+
+Sends a getInfo query to every server whose probe interval has elapsed.
+The replies are cached so clients can get the serverinfo of the whole list from the master.
+==================
+*/
+void idAsyncServer::ProbeServers( void ) {
+	int			i, interval, probeTime, numProbes;
+	idBitMsg	outMsg;
+	byte		msgBuf[64];
+
+	interval = idAsyncNetwork::masterProbeInterval.GetInteger() * 1000;
+	nextProbeTime = realTime + interval;
+	numProbes = 0;
+
+	for ( i = 0; i < serverPool.Num(); i++ ) {
+		serverData_t &sv = *serverPool[i];
+
+		probeTime = sv.lastProbeTime + interval;
+		if ( realTime - probeTime < 0 ) {
+			if ( probeTime - nextProbeTime < 0 ) {
+				nextProbeTime = probeTime;
+			}
+			continue;
+		}
+
+		if ( numProbes >= MAX_PROBES_PER_FRAME ) {
+			// pick up the rest after a short delay
+			if ( realTime + PROBE_BURST_DELAY - nextProbeTime < 0 ) {
+				nextProbeTime = realTime + PROBE_BURST_DELAY;
+			}
+			break;
+		}
+
+		if ( sv.lastInfoTime && realTime - sv.lastInfoTime > MAX_MISSED_PROBES * interval ) {
+			common->DPrintf( "Server %s stopped answering probes\n", Sys_NetAdrToString( sv.address ) );
+			sv.serverInfo.Clear();
+			sv.numClients = 0;
+			sv.lastInfoTime = 0;
+		}
+
+		sv.infoChallenge = ( ( rand() << 16 ) ^ rand() ) ^ realTime;
+		sv.lastProbeTime = realTime;
+
+		outMsg.Init( msgBuf, sizeof( msgBuf ) );
+		outMsg.BeginWriting();
+		outMsg.WriteShort( CONNECTIONLESS_MESSAGE_ID );
+		outMsg.WriteString( "getInfo" );
+		outMsg.WriteInt( sv.infoChallenge );
+		serverPort.SendPacket( sv.address, outMsg.GetData(), outMsg.GetSize() );
+		numProbes++;
+	}
+}
+
 /*
 ===============
 idAsyncServer::UpdateAsyncStatsAvg
@@ -331,10 +795,14 @@ void idAsyncServer::GetAsyncStatsAvgMsg( idStr &msg ) {
 idAsyncServer::ConnectionlessMessage
 ==================
 */
-bool idAsyncServer::ConnectionlessMessage( const netadr_t from, const idBitMsg &msg ) {
-	char		string[MAX_STRING_CHARS*2];  // M. Quinn - Even Balance - PB Packets need more than 1024
+bool idAsyncServer::ConnectionlessMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "idAsyncServer::ConnectionlessMessage" );
+	const char *string;
 
-	msg.ReadString( string, sizeof( string ) );
+	string = msg.ReadString();
+	if ( !string ) {
+		return false;
+	}
 
 	// receiving heartbeat
 	if ( idStr::Icmp( string, "heartbeat" ) == 0 ) {
@@ -343,12 +811,32 @@ bool idAsyncServer::ConnectionlessMessage( const netadr_t from, const idBitMsg &
 	}
 	if (idStr::Icmp(string, "getServers") == 0) {
 		ProcessRequestServersMessage(from, msg);
+		EndReply();
 		return false;
 	}
 	if (idStr::Icmp(string, "srvAuth") == 0) {
 		ProcessAuthRequestMessage(from, msg);
 		return false;
 	}
+	if ( idStr::Icmp( string, "infoResponse" ) == 0 ) {
+		ProcessInfoResponseMessage( from, msg );
+		return false;
+	}
+	if ( idStr::Icmp( string, "getServersDelta" ) == 0 ) {
+		ProcessRequestServersDeltaMessage( from, msg );
+		EndReply();
+		return false;
+	}
+	if ( idStr::Icmp( string, "getServersInfo" ) == 0 ) {
+		ProcessRequestServersInfoMessage( from, msg );
+		EndReply();
+		return false;
+	}
+	if ( idStr::Icmp( string, "getList" ) == 0 ) {
+		ProcessRequestListMessage( from, msg );
+		EndReply();
+		return false;
+	}
 
 	common->Printf("Receiving unknown packet from %s\n", Sys_NetAdrToString(from));
 	return false;
@@ -356,48 +844,1055 @@ bool idAsyncServer::ConnectionlessMessage( const netadr_t from, const idBitMsg &
 
 
 bool idAsyncServer::ProcessHeartbeatMessage( const netadr_t from ){
+	TRACE_SCOPE( "heartbeat" );
 	AddServerToMaster(from);
 	common->Printf("Receiving heartbeat from %s\n", Sys_NetAdrToString(from));
 	return true;
 }
 
-void idAsyncServer::ProcessRequestServersMessage( const netadr_t from, const idBitMsg &msg ) {
+void idAsyncServer::ProcessRequestServersMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "getServers" );
 	common->Printf("Receiving getServers from %s\n", Sys_NetAdrToString(from));
 
 	idBitMsg	outMsg;
 	byte		msgBuf[MAX_MESSAGE_SIZE];
+	int			size, region, pass, i, num, numWanted;
+
+	// the protocol version and fs_game of legacy clients follow, nothing in them is for the master
+	if ( !BeginReply( from, 0, false ) ) {
+		return;
+	}
+
+	UpdateListCache();
+	region = regions.Lookup( from );
 
 	outMsg.Init( msgBuf, sizeof( msgBuf ) );
 	outMsg.WriteShort( CONNECTIONLESS_MESSAGE_ID );
 	outMsg.WriteString( "servers" );
-	for (int i=0; i < servers.Num(); i++) {
-		outMsg.WriteByte(servers[i].address.ip[0]);
-		outMsg.WriteByte(servers[i].address.ip[1]);
-		outMsg.WriteByte(servers[i].address.ip[2]);
-		outMsg.WriteByte(servers[i].address.ip[3]);
-		outMsg.WriteShort(servers[i].address.port);
-		common->Printf("Sending data... %s\n", Sys_NetAdrToString(from));
+	size = outMsg.GetRemainingSpace();
+	if ( replyBudget >= 0 ) {
+		// a short list is better than none for clients that don't know about cookies
+		size = Min( size, replyBudget - outMsg.GetSize() );
 	}
-	serverPort.SendPacket( from, outMsg.GetData(), outMsg.GetSize() );
-	//a.ip[0], a.ip[1], a.ip[2], a.ip[3], a.port );
+	size = Max( size, 0 ) / 6;
+
+	// servers in the requester's region first, so a truncated list still has the close ones
+	num = 0;
+	numWanted = 0;
+	for ( pass = 0; pass < 2; pass++ ) {
+		for ( i = 0; i < regionListCache.Num(); i++ ) {
+			if ( region >= 0 && ( regionListCache[i] == region ) != ( pass == 0 ) ) {
+				continue;
+			}
+			numWanted++;
+			if ( num < size ) {
+				outMsg.WriteData( &plainListCache[i * 6], 6 );
+				num++;
+			}
+		}
+		if ( region < 0 ) {
+			break;
+		}
+	}
+	if ( num < numWanted ) {
+		replyStats.truncated++;
+	}
+	SendReply( from, outMsg );
+	common->Printf( "Sent %d servers to %s (region %s)\n", num, Sys_NetAdrToString( from ), regions.GetRegionName( region ) );
 }
 
-void idAsyncServer::ProcessAuthRequestMessage( const netadr_t from, const idBitMsg &msg ) {
+void idAsyncServer::ProcessAuthRequestMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "auth" );
 	common->Printf("Receiving srvAuth from %s\n", Sys_NetAdrToString(from));
 }
 
-bool idAsyncServer::AddServerToMaster(const netadr_t from) {
-	serverData_t sv;
-	sv.address = from;
-	sv.filterGameType = 0;
-	sv.filterPassword = 0;
-	sv.filterPlayers = 0;
-	strcpy(sv.fsGame, "base"); //is all this necessary?
-	if (servers.FindIndex(sv) != -1) {
-		common->Printf("Server %s already in list\n", Sys_NetAdrToString(from));
-	} else {
-		common->Printf("Server %s added to list\n", Sys_NetAdrToString(from));
-		servers.AddUnique(sv);
+/*
+==================
+idAsyncServer::ReplyCookie
+
+Keyed hash of the source address and the cookie period, never 0.
+==================
+*/
+int idAsyncServer::ReplyCookie( const netadr_t &adr, int timeSlot ) const {
+	byte key[10];
+
+	key[0] = adr.ip[0];
+	key[1] = adr.ip[1];
+	key[2] = adr.ip[2];
+	key[3] = adr.ip[3];
+	key[4] = adr.port & 0xff;
+	key[5] = adr.port >> 8;
+	key[6] = timeSlot & 0xff;
+	key[7] = ( timeSlot >> 8 ) & 0xff;
+	key[8] = ( timeSlot >> 16 ) & 0xff;
+	key[9] = ( timeSlot >> 24 ) & 0xff;
+	return (int)( SipHash_BlockChecksum( key, sizeof( key ) ) | 1 );
+}
+
+/*
+==================
+idAsyncServer::BeginReply
+
+List replies can be much larger than the request, so with a spoofed source the master
+would reflect traffic at the victim. A source that echoes the cookie it was sent proves
+it can receive and gets everything. Other sources get at most net_masterUnverifiedBytes
+per REPLY_WINDOW_MSEC, along with a replyCookie packet to come back with if offerCookie
+is set. Legacy getServers requests carry no cookie and their clients don't understand
+the replyCookie packet. They can never leave the budget, so a window would starve every
+client behind one address; they get net_masterUnverifiedBytes per reply instead.
+Returns false if nothing should be sent.
+==================
+*/
+bool idAsyncServer::BeginReply( const netadr_t from, int cookie, bool offerCookie ) {
+	idBitMsg	outMsg;
+	byte		msgBuf[64];
+	int			limit, slot, elapsed, used;
+	unsigned int ip;
+
+	replyActive = true;
+	replySource = NULL;
+	replyBudget = -1;
+	replySent = 0;
+
+	slot = realTime / REPLY_COOKIE_MSEC;
+	if ( cookie ) {
+		if ( cookie == ReplyCookie( from, slot ) || cookie == ReplyCookie( from, slot - 1 ) ) {
+			replyStats.verified++;
+			return true;
+		}
+		replyStats.badCookies++;
+	}
+
+	limit = idAsyncNetwork::masterUnverifiedBytes.GetInteger();
+	if ( !limit || from.type != NA_IP ) {
+		return true;
+	}
+
+	replyStats.unverified++;
+	replyStartTime = Sys_Microseconds();
+
+	ip = Net_AdrToIP( from );
+	// serverHash keys are masked to its own size, index the whole table with the full hash
+	replySource = &replySources[ SipHash_BlockChecksum( &ip, sizeof( ip ) ) & ( MAX_REPLY_SOURCES - 1 ) ];
+	if ( replySource->ip != ip || realTime - replySource->windowStart >= 2 * REPLY_WINDOW_MSEC ) {
+		replySource->ip = ip;
+		replySource->windowStart = realTime;
+		replySource->bytes = 0;
+		replySource->prevBytes = 0;
+	} else if ( realTime - replySource->windowStart >= REPLY_WINDOW_MSEC ) {
+		replySource->windowStart += REPLY_WINDOW_MSEC;
+		replySource->prevBytes = replySource->bytes;
+		replySource->bytes = 0;
+	}
+
+	// the previous window counts for the part of it that still overlaps the last REPLY_WINDOW_MSEC
+	elapsed = realTime - replySource->windowStart;
+	used = replySource->bytes + (int)( (long long)replySource->prevBytes * ( REPLY_WINDOW_MSEC - elapsed ) / REPLY_WINDOW_MSEC );
+	if ( !offerCookie ) {
+		// the bytes still count against the window of requests that can verify
+		replyBudget = limit;
+		return true;
+	}
+	if ( used >= limit ) {
+		replyStats.dropped++;
+		return false;
+	}
+
+	outMsg.Init( msgBuf, sizeof( msgBuf ) );
+	outMsg.WriteShort( CONNECTIONLESS_MESSAGE_ID );
+	outMsg.WriteString( "replyCookie" );
+	outMsg.WriteInt( ReplyCookie( from, slot ) );
+	serverPort.SendPacket( from, outMsg.GetData(), outMsg.GetSize() );
+	replySent = outMsg.GetSize();
+
+	replyBudget = Max( limit - used - replySent, 0 );
+	return true;
+}
+
+/*
+==================
+idAsyncServer::SendReply
+
+Returns false if the packet didn't fit in what is left of the reply budget, the rest of the reply should be dropped.
+==================
+*/
+bool idAsyncServer::SendReply( const netadr_t to, const idBitMsg &msg ) {
+	if ( replyBudget >= 0 ) {
+		if ( msg.GetSize() > replyBudget ) {
+			replyStats.truncated++;
+			replyBudget = 0;
+			return false;
+		}
+		replyBudget -= msg.GetSize();
 	}
+	serverPort.SendPacket( to, msg.GetData(), msg.GetSize() );
+	replySent += msg.GetSize();
 	return true;
+}
+
+/*
+==================
+idAsyncServer::EndReply
+==================
+*/
+void idAsyncServer::EndReply( void ) {
+	if ( !replyActive ) {
+		return;
+	}
+	if ( replySource ) {
+		replySource->bytes += replySent;
+		replyStats.unverifiedBytes += replySent;
+		replyStats.unverifiedUsec += Sys_Microseconds() - replyStartTime;
+	}
+	replyActive = false;
+	replySource = NULL;
+	replyBudget = -1;
+}
+
+/*
+==================
+idAsyncServer::ProcessRequestServersDeltaMessage
+
+The client sends the generation of the last list it got, 0 if it has none.
+An optional flags byte and reply cookie follow the generation, SERVERS_REQUEST_COMPRESSED
+and SERVERS_REQUEST_GROUPED map to the MASTER_CAP_ bits of the same name.
+==================
+*/
+void idAsyncServer::ProcessRequestServersDeltaMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "getServersDelta" );
+	int			generation, requestFlags, capabilities;
+
+	generation = msg.ReadInt();
+	if ( msg.IsOverflowed() ) {
+		generation = listGeneration + 1;
+	}
+	requestFlags = msg.GetRemainingData() > 0 ? msg.ReadByte() : 0;
+	if ( !BeginReply( from, msg.GetRemainingData() >= 4 ? msg.ReadInt() : 0 ) ) {
+		return;
+	}
+
+	capabilities = MASTER_CAP_DELTA;
+	if ( requestFlags & SERVERS_REQUEST_COMPRESSED ) {
+		capabilities |= MASTER_CAP_COMPRESSED;
+	}
+	if ( requestFlags & SERVERS_REQUEST_GROUPED ) {
+		capabilities |= MASTER_CAP_GROUPED;
+	}
+	if ( requestFlags & SERVERS_REQUEST_REGION_ONLY ) {
+		capabilities |= MASTER_CAP_REGION_ONLY;
+	}
+	SendServerList( from, generation, capabilities );
+}
+
+/*
+==================
+idAsyncServer::ProcessRequestListMessage
+
+Versioned list request:
+1 byte		version of the request header, MASTER_PROTOCOL_VERSION
+4 bytes		MASTER_CAP_ bits the client understands
+4 bytes		generation of the last list the client got, 0 if it has none
+4 bytes		reply cookie, 0 if the client has none
+Later versions only append fields, so the master reads the ones it knows about and
+ignores capabilities it doesn't have.
+==================
+*/
+void idAsyncServer::ProcessRequestListMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "getList" );
+	int			version, capabilities, generation, cookie;
+
+	version = msg.ReadByte();
+	capabilities = msg.ReadInt();
+	generation = msg.ReadInt();
+	cookie = msg.ReadInt();
+	if ( msg.IsOverflowed() || version < 1 ) {
+		common->DPrintf( "%s: bad getList request\n", Sys_NetAdrToString( from ) );
+		return;
+	}
+	if ( !BeginReply( from, cookie ) ) {
+		return;
+	}
+
+	capabilities &= MASTER_CAPS_SUPPORTED;
+	if ( capabilities & MASTER_CAP_INFO ) {
+		SendServersInfo( from );
+	} else {
+		SendServerList( from, generation, capabilities );
+	}
+}
+
+/*
+==================
+idAsyncServer::SendServerList
+
+Sends serversDelta replies in the smallest encoding the client understands.
+If the client's generation is still in the history and it understands deltas only
+the changes since then are sent, otherwise the full list with SERVERS_DELTA_RESET set
+in the first packet. A full list is sent compressed in a single packet when possible,
+else as groups of servers sharing an ip, else one record per server.
+A region only list is always a full list with one record per server, the history
+and the cached encodings cover every region.
+==================
+*/
+void idAsyncServer::SendServerList( const netadr_t from, int generation, int capabilities ) {
+	int			i, behind, headerSize, flagsOffset, numPackets, groupSize, region;
+	idBitMsg	outMsg;
+	byte		msgBuf[MAX_MESSAGE_SIZE];
+
+	region = ( capabilities & MASTER_CAP_REGION_ONLY ) ? regions.Lookup( from ) : -1;
+	if ( region >= 0 ) {
+		capabilities &= ~( MASTER_CAP_DELTA | MASTER_CAP_COMPRESSED | MASTER_CAP_GROUPED );
+	}
+
+	behind = listGeneration - generation;
+	if ( !( capabilities & MASTER_CAP_DELTA ) || behind < 0 || behind > listHistoryNum ) {
+		behind = -1;
+	}
+
+	outMsg.Init( msgBuf, sizeof( msgBuf ) );
+	outMsg.BeginWriting();
+	outMsg.WriteShort( CONNECTIONLESS_MESSAGE_ID );
+	outMsg.WriteString( "serversDelta" );
+	outMsg.WriteInt( listGeneration );
+	flagsOffset = outMsg.GetSize();
+
+	if ( capabilities & MASTER_CAP_COMPRESSED ) {
+		UpdateListCache();
+		// a long delta can be bigger than the whole compressed list
+		if ( behind > 0 && compressedListCache.Num() && behind * 7 > compressedListCache.Num() ) {
+			behind = -1;
+		}
+	}
+
+	if ( behind < 0 && ( capabilities & MASTER_CAP_COMPRESSED ) ) {
+		if ( compressedListCache.Num() && compressedListCache.Num() < outMsg.GetRemainingSpace() ) {
+			outMsg.WriteByte( SERVERS_DELTA_RESET | SERVERS_DELTA_COMPRESSED );
+			outMsg.WriteData( compressedListCache.Ptr(), compressedListCache.Num() );
+			SendReply( from, outMsg );
+			return;
+		}
+	}
+
+	if ( behind < 0 && ( capabilities & MASTER_CAP_GROUPED ) ) {
+		UpdateListCache();
+		outMsg.WriteByte( SERVERS_DELTA_RESET | SERVERS_DELTA_GROUPED );
+		headerSize = outMsg.GetSize();
+
+		numPackets = 0;
+		for ( i = 0; i < groupedListCache.Num(); i += groupSize ) {
+			groupSize = 5 + groupedListCache[i + 4] * 2;
+			if ( outMsg.GetSize() + groupSize > MAX_INFO_PACKET_SIZE ) {
+				if ( !SendReply( from, outMsg ) ) {
+					return;
+				}
+				outMsg.SetSize( headerSize );
+				outMsg.GetData()[flagsOffset] = SERVERS_DELTA_GROUPED;
+				numPackets++;
+			}
+			outMsg.WriteData( &groupedListCache[i], groupSize );
+		}
+		if ( outMsg.GetSize() > headerSize || !numPackets ) {
+			SendReply( from, outMsg );
+		}
+		return;
+	}
+
+	outMsg.WriteByte( behind < 0 ? SERVERS_DELTA_RESET : 0 );
+	headerSize = outMsg.GetSize();
+
+	numPackets = 0;
+	for ( i = 0; i < ( behind < 0 ? servers.Num() : behind ); i++ ) {
+		const netadr_t *adr;
+		bool added;
+
+		if ( behind < 0 ) {
+			if ( region >= 0 && servers[i]->region != region ) {
+				continue;
+			}
+			adr = &servers[i]->address;
+			added = true;
+		} else {
+			const listChange_t &change = listHistory[ ( listGeneration - behind + 1 + i ) & ( MAX_LIST_HISTORY - 1 ) ];
+			adr = &change.address;
+			added = change.added;
+		}
+
+		if ( outMsg.GetSize() + 7 > MAX_INFO_PACKET_SIZE ) {
+			if ( !SendReply( from, outMsg ) ) {
+				return;
+			}
+			outMsg.SetSize( headerSize );
+			// only the first packet resets the client's list
+			outMsg.GetData()[flagsOffset] = 0;
+			numPackets++;
+		}
+
+		outMsg.WriteByte( added ? 1 : 0 );
+		outMsg.WriteByte( adr->ip[0] );
+		outMsg.WriteByte( adr->ip[1] );
+		outMsg.WriteByte( adr->ip[2] );
+		outMsg.WriteByte( adr->ip[3] );
+		outMsg.WriteUShort( adr->port );
+	}
+
+	if ( outMsg.GetSize() > headerSize || !numPackets ) {
+		SendReply( from, outMsg );
+	}
+}
+
+/*
+==================
+CompareServerAdr
+==================
+*/
+static int CompareServerAdr( const netadr_t *a, const netadr_t *b ) {
+	int d = memcmp( a->ip, b->ip, sizeof( a->ip ) );
+	if ( d ) {
+		return d;
+	}
+	return (int)a->port - (int)b->port;
+}
+
+/*
+==================
+ServerGroupSize
+
+Number of servers starting at first that share its ip, at most MAX_GROUP_PORTS.
+==================
+*/
+static int ServerGroupSize( const idList<netadr_t> &sorted, int first ) {
+	int i;
+
+	for ( i = first + 1; i < sorted.Num() && i - first < MAX_GROUP_PORTS; i++ ) {
+		if ( memcmp( sorted[i].ip, sorted[first].ip, sizeof( sorted[i].ip ) ) ) {
+			break;
+		}
+	}
+	return i - first;
+}
+
+/*
+==================
+EncodeServerList
+
+Compressed full list: an unsigned short server count, then the entropy coded groups.
+The addresses must be sorted, each group is the number of leading ip bytes shared
+with the previous group, the remaining ip bytes, the number of ports and the ports,
+low byte first.
+Returns the encoded size or -1 if it doesn't fit in maxSize.
+==================
+*/
+static int EncodeServerList( const idList<netadr_t> &sorted, idCompressor *compressor, byte *out, int maxSize ) {
+	int			i, j, num, prefix;
+	byte		entry[6];
+	idBitMsg	msg;
+
+	msg.Init( out, maxSize );
+	msg.SetAllowOverflow( true );
+	msg.BeginWriting();
+	msg.WriteUShort( sorted.Num() );
+
+	idFile_BitMsg file( msg );
+	compressor->Init( &file, true, 8 );
+	for ( i = 0; i < sorted.Num(); i += num ) {
+		const netadr_t &adr = sorted[i];
+
+		num = ServerGroupSize( sorted, i );
+		prefix = 0;
+		if ( i > 0 ) {
+			while ( prefix < 4 && adr.ip[prefix] == sorted[i - 1].ip[prefix] ) {
+				prefix++;
+			}
+		}
+		entry[0] = prefix;
+		memcpy( entry + 1, adr.ip + prefix, 4 - prefix );
+		entry[5 - prefix] = num;
+		compressor->Write( entry, 6 - prefix );
+		for ( j = i; j < i + num; j++ ) {
+			entry[0] = sorted[j].port & 0xff;
+			entry[1] = sorted[j].port >> 8;
+			compressor->Write( entry, 2 );
+		}
+	}
+	compressor->FinishCompress();
+
+	if ( msg.IsOverflowed() ) {
+		return -1;
+	}
+	return msg.GetSize();
+}
+
+/*
+==================
+DecodeServerList
+==================
+*/
+static bool DecodeServerList( const byte *data, int size, idCompressor *compressor, idList<netadr_t> &list ) {
+	int			i, total, num, prefix;
+	byte		entry[6];
+	netadr_t	adr;
+	idBitMsg	msg;
+
+	msg.Init( data, size );
+	msg.SetSize( size );
+	msg.BeginReading();
+	total = msg.ReadUShort();
+	if ( total < 0 ) {
+		return false;
+	}
+
+	idFile_BitMsg file( msg );
+	compressor->Init( &file, false, 8 );
+	adr = netadr_t();
+	adr.type = NA_IP;
+	list.SetNum( 0, false );
+	while ( list.Num() < total ) {
+		if ( compressor->Read( entry, 1 ) != 1 || entry[0] > 4 || ( !list.Num() && entry[0] != 0 ) ) {
+			return false;
+		}
+		prefix = entry[0];
+		if ( compressor->Read( entry, 5 - prefix ) != 5 - prefix ) {
+			return false;
+		}
+		memcpy( adr.ip + prefix, entry, 4 - prefix );
+		num = entry[4 - prefix];
+		if ( !num || list.Num() + num > total ) {
+			return false;
+		}
+		for ( i = 0; i < num; i++ ) {
+			if ( compressor->Read( entry, 2 ) != 2 ) {
+				return false;
+			}
+			adr.port = entry[0] | ( entry[1] << 8 );
+			list.Append( adr );
+		}
+	}
+	return true;
+}
+
+/*
+==================
+idAsyncServer::UpdateListCache
+
+Rebuilds the cached full lists when the registry changed since they were built.
+==================
+*/
+void idAsyncServer::UpdateListCache( void ) {
+	int					i, j, num, size;
+	idList<netadr_t>	sorted;
+	byte				buf[MAX_MESSAGE_SIZE];
+
+	if ( listCacheValid && listCacheGeneration == listGeneration ) {
+		return;
+	}
+
+	SortServers();
+	sorted.SetArena( frameArena );
+	sorted.SetNum( servers.Num() );
+	for ( i = 0; i < servers.Num(); i++ ) {
+		sorted[i] = servers[i]->address;
+	}
+
+	plainListCache.SetNum( sorted.Num() * 6 );
+	regionListCache.SetNum( sorted.Num() );
+	for ( i = 0; i < sorted.Num(); i++ ) {
+		regionListCache[i] = servers[i]->region;
+		byte *p = &plainListCache[i * 6];
+		p[0] = sorted[i].ip[0];
+		p[1] = sorted[i].ip[1];
+		p[2] = sorted[i].ip[2];
+		p[3] = sorted[i].ip[3];
+		p[4] = sorted[i].port & 0xff;
+		p[5] = sorted[i].port >> 8;
+	}
+
+	groupedListCache.SetNum( 0, false );
+	for ( i = 0; i < sorted.Num(); i += num ) {
+		num = ServerGroupSize( sorted, i );
+		groupedListCache.Append( sorted[i].ip[0] );
+		groupedListCache.Append( sorted[i].ip[1] );
+		groupedListCache.Append( sorted[i].ip[2] );
+		groupedListCache.Append( sorted[i].ip[3] );
+		groupedListCache.Append( num );
+		for ( j = i; j < i + num; j++ ) {
+			groupedListCache.Append( sorted[j].port & 0xff );
+			groupedListCache.Append( sorted[j].port >> 8 );
+		}
+	}
+
+	idCompressor *compressor = idCompressor::AllocArithmetic();
+	size = EncodeServerList( sorted, compressor, buf, sizeof( buf ) );
+	delete compressor;
+
+	compressedListCache.SetNum( Max( size, 0 ) );
+	if ( size > 0 ) {
+		memcpy( compressedListCache.Ptr(), buf, size );
+	}
+
+	listCacheGeneration = listGeneration;
+	listCacheValid = true;
+}
+
+/*
+==================
+idAsyncServer::CheckStartupTime
+
+Reports the result of testStartup once the first packet was processed.
+==================
+*/
+void idAsyncServer::CheckStartupTime( void ) {
+	double	usec;
+	bool	passed;
+
+	if ( startupBudget < 0 ) {
+		return;
+	}
+
+	usec = Com_StartupPhaseTime( "first packet" );
+	passed = ( usec >= 0.0 && usec <= startupBudget * 1000.0 );
+	common->Printf( "time to first packet: %.2f msec, %d msec allowed %s\n", usec / 1000.0, startupBudget,
+		passed ? "ok" : S_COLOR_RED "X" S_COLOR_DEFAULT );
+	startupBudget = -1;
+
+	if ( startupQuit ) {
+		if ( !passed ) {
+			common->FatalError( "testStartup: the first packet took too long" );
+		}
+		cmdSystem->BufferCommandText( CMD_EXEC_APPEND, "quit\n" );
+	}
+}
+
+/*
+==================
+idAsyncServer::TestStartup_f
+
+testStartup [maxMsec] [quit]
+Checks the time from process start to the first processed packet. Given on the command
+line after startMaster, a packet it sends to the master's own port is the first one.
+With quit the process exits after the check, with an error if it took longer than maxMsec.
+==================
+*/
+void idAsyncServer::TestStartup_f( const idCmdArgs &args ) {
+	idAsyncServer &	server = idAsyncNetwork::server;
+	idPort			probe;
+	idBitMsg		msg;
+	byte			msgBuf[64];
+	netadr_t		to;
+
+	if ( !server.active ) {
+		common->Printf( "the master isn't running, startMaster first\n" );
+		return;
+	}
+
+	server.startupBudget = ( args.Argc() > 1 ) ? Max( atoi( args.Argv( 1 ) ), 0 ) : DEFAULT_STARTUP_BUDGET_MSEC;
+	server.startupQuit = ( args.Argc() > 2 && !idStr::Icmp( args.Argv( 2 ), "quit" ) );
+	if ( server.receivedPacket ) {
+		server.CheckStartupTime();
+		return;
+	}
+
+	// the master only logs commands it doesn't know
+	if ( !probe.InitForPort( PORT_ANY ) ) {
+		common->Printf( "testStartup: can't open a port for the probe\n" );
+		server.startupBudget = -1;
+		return;
+	}
+	to = netadr_t();
+	to.type = NA_IP;
+	to.ip[0] = 127;
+	to.ip[3] = 1;
+	to.port = server.GetPort();
+	msg.Init( msgBuf, sizeof( msgBuf ) );
+	msg.WriteShort( CONNECTIONLESS_MESSAGE_ID );
+	msg.WriteString( "startupProbe" );
+	probe.SendPacket( to, msg.GetData(), msg.GetSize() );
+	probe.Close();
+}
+
+/*
+==================
+idAsyncServer::TestListCompression_f
+
+Encodes a synthetic list with every entropy coder and checks it decodes back.
+==================
+*/
+void idAsyncServer::TestListCompression_f( const idCmdArgs &args ) {
+	static const char *names[] = { "Huffman", "Arithmetic", "LZSS", "LZW" };
+	int					i, j, num, size, plainSize;
+	idList<netadr_t>	list, decoded;
+	netadr_t			adr;
+	byte				buf[MAX_MESSAGE_SIZE];
+	double				start, usec;
+	idRandom			rnd( 0x5eed );
+
+	num = ( args.Argc() > 1 ) ? atoi( args.Argv( 1 ) ) : 2000;
+	num = idMath::ClampInt( 1, 65535, num );
+
+	// servers cluster in hosting ranges and often run several ports on one address
+	adr = netadr_t();
+	adr.type = NA_IP;
+	while ( list.Num() < num ) {
+		adr.ip[0] = 1 + rnd.RandomInt( 223 );
+		adr.ip[1] = rnd.RandomInt( 256 );
+		adr.ip[2] = rnd.RandomInt( 256 );
+		int hosts = 1 + rnd.RandomInt( 4 );
+		for ( j = 0; j < hosts && list.Num() < num; j++ ) {
+			adr.ip[3] = rnd.RandomInt( 256 );
+			int ports = 1 + rnd.RandomInt( 3 );
+			for ( int k = 0; k < ports && list.Num() < num; k++ ) {
+				adr.port = PORT_SERVER + k;
+				list.AddUnique( adr );
+			}
+		}
+	}
+	list.Sort( CompareServerAdr );
+	plainSize = list.Num() * 6;
+
+	common->Printf( "%d servers, %d bytes uncompressed\n", list.Num(), plainSize );
+	for ( i = 0; i < 4; i++ ) {
+		idCompressor *compressor;
+		switch( i ) {
+			case 0: compressor = idCompressor::AllocHuffman(); break;
+			case 1: compressor = idCompressor::AllocArithmetic(); break;
+			case 2: compressor = idCompressor::AllocLZSS(); break;
+			default: compressor = idCompressor::AllocLZW(); break;
+		}
+
+		start = Sys_Microseconds();
+		size = EncodeServerList( list, compressor, buf, sizeof( buf ) );
+		usec = Sys_Microseconds() - start;
+
+		if ( size < 0 ) {
+			common->Printf( "%-12s doesn't fit in a packet\n", names[i] );
+		} else {
+			bool ok = DecodeServerList( buf, size, compressor, decoded ) && decoded.Num() == list.Num();
+			for ( j = 0; ok && j < list.Num(); j++ ) {
+				ok = ( decoded[j] == list[j] );
+			}
+			common->Printf( "%-12s %6d bytes  ratio %5.2f  %.2f bytes/server  encode %8.1f usec %s\n", names[i], size,
+				(float)plainSize / size, (float)size / list.Num(), usec, ok ? "ok" : S_COLOR_RED "X" S_COLOR_DEFAULT );
+		}
+		delete compressor;
+	}
+}
+
+/*
+==================
+idAsyncServer::RecordListChange
+==================
+*/
+void idAsyncServer::RecordListChange( const netadr_t &adr, bool added ) {
+	listGeneration++;
+	listChange_t &change = listHistory[ listGeneration & ( MAX_LIST_HISTORY - 1 ) ];
+	change.address = adr;
+	change.added = added;
+	if ( listHistoryNum < MAX_LIST_HISTORY ) {
+		listHistoryNum++;
+	}
+}
+
+/*
+==================
+idAsyncServer::ProcessInfoResponseMessage
+
+Reply to one of our getInfo probes, same layout a game server sends to clients.
+==================
+*/
+void idAsyncServer::ProcessInfoResponseMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "infoResponse" );
+	int				challenge, clientNum, numClients;
+	idBitMsg		infoMsg;
+	char			nickname[MAX_STRING_CHARS];
+	serverData_t *	found;
+
+	found = FindServer( from );
+	if ( !found ) {
+		common->DPrintf( "infoResponse from unregistered server %s\n", Sys_NetAdrToString( from ) );
+		return;
+	}
+
+	serverData_t &sv = *found;
+
+	// only one reply per probe is taken, and only with the challenge it was sent
+	challenge = msg.ReadInt();
+	if ( !sv.infoChallenge || sv.lastInfoTime - sv.lastProbeTime >= 0 || challenge != sv.infoChallenge ) {
+		common->DPrintf( "unexpected infoResponse from %s\n", Sys_NetAdrToString( from ) );
+		return;
+	}
+	sv.protocol = msg.ReadInt();
+	if ( msg.IsOverflowed() ) {
+		return;
+	}
+
+	// the serverinfo is delta encoded against nothing, parse the rest with the bit message helpers
+	infoMsg.Init( msg.GetData(), msg.GetSize() );
+	infoMsg.SetSize( msg.GetSize() );
+	infoMsg.BeginReading();
+	infoMsg.SetReadCount( msg.GetReadCount() );
+	infoMsg.ReadDeltaDict( sv.serverInfo, NULL );
+
+	numClients = 0;
+	while ( ( clientNum = infoMsg.ReadByte() ) >= 0 && clientNum < MAX_ASYNC_CLIENTS ) {
+		infoMsg.ReadShort();		// ping
+		infoMsg.ReadInt();			// rate
+		infoMsg.ReadString( nickname, sizeof( nickname ) );
+		numClients++;
+	}
+
+	sv.numClients = numClients;
+	sv.lastInfoTime = realTime;
+}
+
+/*
+==================
+idAsyncServer::ProcessRequestServersInfoMessage
+
+Extended list request: every registered server with its cached serverinfo.
+The request may end with a reply cookie, see BeginReply.
+==================
+*/
+void idAsyncServer::ProcessRequestServersInfoMessage( const netadr_t from, const idMsgView &msg ) {
+	TRACE_SCOPE( "getServersInfo" );
+	if ( !BeginReply( from, msg.GetRemainingData() >= 4 ? msg.ReadInt() : 0 ) ) {
+		return;
+	}
+	SendServersInfo( from );
+}
+
+/*
+==================
+idAsyncServer::SendServersInfo
+
+Every registered server with its cached serverinfo.
+Servers that did not answer a probe yet have an empty dictionary and 255 clients.
+==================
+*/
+void idAsyncServer::SendServersInfo( const netadr_t from ) {
+	int			i, headerSize, numPackets;
+	idBitMsg	outMsg, entryMsg;
+	byte		msgBuf[MAX_MESSAGE_SIZE];
+	byte		entryBuf[MAX_MESSAGE_SIZE];
+
+	outMsg.Init( msgBuf, sizeof( msgBuf ) );
+	outMsg.BeginWriting();
+	outMsg.WriteShort( CONNECTIONLESS_MESSAGE_ID );
+	outMsg.WriteString( "serversInfo" );
+	headerSize = outMsg.GetSize();
+
+	numPackets = 0;
+	for ( i = 0; i < servers.Num(); i++ ) {
+		const serverData_t &sv = *servers[i];
+
+		entryMsg.Init( entryBuf, sizeof( entryBuf ) );
+		entryMsg.BeginWriting();
+		entryMsg.WriteByte( sv.address.ip[0] );
+		entryMsg.WriteByte( sv.address.ip[1] );
+		entryMsg.WriteByte( sv.address.ip[2] );
+		entryMsg.WriteByte( sv.address.ip[3] );
+		entryMsg.WriteUShort( sv.address.port );
+		entryMsg.WriteByte( sv.lastInfoTime ? sv.numClients : 255 );
+		entryMsg.WriteDeltaDict( sv.serverInfo, NULL );
+
+		if ( outMsg.GetSize() > headerSize && outMsg.GetSize() + entryMsg.GetSize() > MAX_INFO_PACKET_SIZE ) {
+			if ( !SendReply( from, outMsg ) ) {
+				return;
+			}
+			outMsg.SetSize( headerSize );
+			numPackets++;
+		}
+		if ( entryMsg.GetSize() > outMsg.GetRemainingSpace() ) {
+			continue;
+		}
+		outMsg.WriteData( entryMsg.GetData(), entryMsg.GetSize() );
+	}
+
+	if ( outMsg.GetSize() > headerSize || !numPackets ) {
+		SendReply( from, outMsg );
+		numPackets++;
+	}
+
+	common->DPrintf( "Sent serversInfo to %s in %d packets\n", Sys_NetAdrToString( from ), numPackets );
+}
+
+bool idAsyncServer::AddServerToMaster(const netadr_t from) {
+	serverData_t *sv = FindServer( from );
+	if ( sv ) {
+		common->Printf("Server %s already in list\n", Sys_NetAdrToString(from));
+		sv->lastHeartbeatTime = realTime;
+	} else {
+		int maxPerSubnet = idAsyncNetwork::masterMaxServersPerSubnet.GetInteger();
+		if ( maxPerSubnet > 0 && SubnetServerCount( from ) >= maxPerSubnet ) {
+			common->DPrintf( "Server %s refused, %d servers on its subnet already\n", Sys_NetAdrToString( from ), maxPerSubnet );
+			numQuotaRefused++;
+			return false;
+		}
+		common->Printf("Server %s added to list\n", Sys_NetAdrToString(from));
+		if ( !servers.Num() ) {
+			nextExpireTime = realTime + SERVER_TIMEOUT;
+		}
+
+		// pool entries keep their old contents, set everything
+		slotHandle_t handle;
+		sv = serverPool.Alloc( handle );
+		sv->address = from;
+		sv->filterGameType = 0;
+		sv->filterPassword = 0;
+		sv->filterPlayers = 0;
+		sv->lastHeartbeatTime = realTime;
+		sv->lastInfoTime = 0;
+		sv->infoChallenge = 0;
+		sv->protocol = 0;
+		sv->numClients = 0;
+		sv->region = regions.Lookup( from );
+		sv->serverInfo.Clear();
+		strcpy(sv->fsGame, "base"); //is all this necessary?
+
+		// probe new servers right away so their info is there for the next list request
+		sv->lastProbeTime = realTime - idAsyncNetwork::masterProbeInterval.GetInteger() * 1000;
+		nextProbeTime = realTime;
+		servers.Append( sv );
+		serverHash.Add( ServerHashKey( from ), handle.index );
+		AdjustSubnetCount( from, 1 );
+		RecordListChange( from, true );
+	}
+	return true;
+}
+
+/*
+==================
+idAsyncServer::ServerHashKey
+
+Addresses come straight from the network, use the keyed hash so nobody can pile servers into one bucket.
+==================
+*/
+int idAsyncServer::ServerHashKey( const netadr_t &adr ) const {
+	byte key[6];
+
+	key[0] = adr.ip[0];
+	key[1] = adr.ip[1];
+	key[2] = adr.ip[2];
+	key[3] = adr.ip[3];
+	key[4] = adr.port & 0xff;
+	key[5] = adr.port >> 8;
+	return serverHash.GenerateSecureKey( key, sizeof( key ) );
+}
+
+/*
+==================
+ServerAdrIP
+
+The ip as a number that orders like CompareServerAdr.
+==================
+*/
+static ID_INLINE unsigned int ServerAdrIP( const byte ip[4] ) {
+	return ( (unsigned int)ip[0] << 24 ) | ( ip[1] << 16 ) | ( ip[2] << 8 ) | ip[3];
+}
+
+typedef struct pendingServer_s {
+	netadr_t			address;
+	int					index;
+} pendingServer_t;
+
+static int ComparePendingServers( const pendingServer_t *a, const pendingServer_t *b ) {
+	return CompareServerAdr( &a->address, &b->address );
+}
+
+/*
+==================
+idAsyncServer::SortServers
+
+New servers are appended to the registry and merged into the sorted part once per frame,
+so a burst of heartbeats doesn't shift the whole list for every server.
+Only the pointers move, the entries stay where serverPool put them.
+==================
+*/
+void idAsyncServer::SortServers( void ) {
+	int						i, j, k;
+	idList<pendingServer_t>	pending;
+	idList<serverData_t *>	merged;
+
+	if ( numSortedServers >= servers.Num() ) {
+		return;
+	}
+
+	pending.SetArena( frameArena );
+	pending.SetNum( servers.Num() - numSortedServers );
+	for ( i = 0; i < pending.Num(); i++ ) {
+		pending[i].address = servers[numSortedServers + i]->address;
+		pending[i].index = numSortedServers + i;
+	}
+	pending.Sort( ComparePendingServers );
+
+	merged.SetNum( servers.Num() );
+	for ( i = j = k = 0; k < merged.Num(); k++ ) {
+		if ( j >= pending.Num() || ( i < numSortedServers && CompareServerAdr( &servers[i]->address, &pending[j].address ) < 0 ) ) {
+			merged[k] = servers[i++];
+		} else {
+			merged[k] = servers[pending[j++].index];
+		}
+	}
+	servers.Swap( merged );
+	numSortedServers = servers.Num();
+}
+
+/*
+==================
+idAsyncServer::LowerBoundServer
+
+Index of the first sorted server at or after ip:port.
+==================
+*/
+int idAsyncServer::LowerBoundServer( unsigned int ip, int port ) const {
+	int lo, hi, mid;
+
+	lo = 0;
+	hi = numSortedServers;
+	while ( lo < hi ) {
+		mid = ( lo + hi ) >> 1;
+		const netadr_t &adr = servers[mid]->address;
+		unsigned int midIP = ServerAdrIP( adr.ip );
+		if ( midIP < ip || ( midIP == ip && adr.port < port ) ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/*
+==================
+idAsyncServer::FindServerRange
+
+The servers inside ip/prefixBits are the num servers starting at the returned index.
+==================
+*/
+int idAsyncServer::FindServerRange( unsigned int ip, int prefixBits, int &num ) {
+	unsigned int mask, first;
+	int start;
+
+	SortServers();
+
+	mask = ( prefixBits <= 0 ) ? 0 : 0xffffffffu << ( 32 - Min( prefixBits, 32 ) );
+	first = ip & mask;
+	start = LowerBoundServer( first, 0 );
+	num = LowerBoundServer( first | ~mask, 0x10000 ) - start;
+	return start;
+}
+
+/*
+==================
+idAsyncServer::FindServer
+==================
+*/
+serverData_t *idAsyncServer::FindServer( const netadr_t &adr ) const {
+	int i;
+
+	for ( i = serverHash.First( ServerHashKey( adr ) ); i != -1; i = serverHash.Next( i ) ) {
+		serverData_t *sv = serverPool.GetSlot( i );
+		if ( sv && sv->address == adr ) {
+			return sv;
+		}
+	}
+	return NULL;
 }
\ No newline at end of file
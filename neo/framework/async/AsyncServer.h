@@ -29,7 +29,11 @@ If you have questions concerning this license or the applicable additional terms
 #ifndef __ASYNCSERVER_H__
 #define __ASYNCSERVER_H__
 
+#include "idlib/containers/SlotMap.h"
 #include "framework/UsercmdGen.h"
+#include "framework/async/NetFilter.h"
+#include "framework/async/RegionTable.h"
+#include "framework/async/HttpServer.h"
 
 /*
 ===============================================================================
@@ -135,6 +139,14 @@ struct serverData_t {
 	short				filterPassword;
 	short				filterPlayers;
 	short				filterGameType;
+	int					lastHeartbeatTime;	// the server is dropped when it stops sending heartbeats
+	int					lastProbeTime;		// last time a getInfo probe was sent
+	int					lastInfoTime;		// last time the server answered a probe, 0 if it never did
+	int					infoChallenge;		// challenge of the outstanding probe
+	int					protocol;			// protocol version from the last infoResponse
+	int					numClients;			// clients listed in the last infoResponse
+	int					region;				// index in the region table, -1 if the address isn't in it
+	idDict				serverInfo;			// serverinfo from the last infoResponse
     // assignment operator modifies object, therefore non-const
     serverData_t& operator=(const serverData_t& a)
     {
@@ -145,6 +157,14 @@ struct serverData_t {
         filterPassword = a.filterPassword;
 		filterPlayers = a.filterPlayers;
 		filterGameType = a.filterGameType;
+		lastHeartbeatTime = a.lastHeartbeatTime;
+		lastProbeTime = a.lastProbeTime;
+		lastInfoTime = a.lastInfoTime;
+		infoChallenge = a.infoChallenge;
+		protocol = a.protocol;
+		numClients = a.numClients;
+		region = a.region;
+		serverInfo = a.serverInfo;
         return *this;
     }
 
@@ -155,6 +175,65 @@ struct serverData_t {
     }
 };
 
+// one registry change, kept so polling clients can be sent only what changed
+typedef struct listChange_s {
+	netadr_t			address;
+	bool				added;			// false if the server was removed
+} listChange_t;
+
+// number of registry changes remembered for getServersDelta, must be a power of two
+const int MAX_LIST_HISTORY				= 1024;
+
+// registered servers are counted per network of this size for net_masterMaxServersPerSubnet
+const int SUBNET_QUOTA_BITS				= 24;
+
+typedef struct subnetCount_s {
+	unsigned int		subnet;			// host order, the bits past SUBNET_QUOTA_BITS are zero
+	int					count;
+} subnetCount_t;
+
+// bytes sent to sources that didn't echo a reply cookie, per source ip over a sliding window
+typedef struct replySource_s {
+	unsigned int		ip;
+	int					windowStart;
+	int					bytes;			// sent in the window that started at windowStart
+	int					prevBytes;		// sent in the window before that
+} replySource_t;
+
+// slots in the reply source table, must be a power of two, sources sharing a slot replace each other
+const int MAX_REPLY_SOURCES				= 4096;
+
+typedef struct replyStats_s {
+	int					verified;		// list requests with a valid cookie
+	int					unverified;		// list requests without one
+	int					badCookies;		// requests with a stale or forged cookie
+	int					truncated;		// unverified replies cut short by the byte budget
+	int					dropped;		// unverified requests not answered at all
+	int					unverifiedBytes;	// sent to unverified sources, cookies included
+	double				unverifiedUsec;	// time spent answering unverified requests
+} replyStats_t;
+
+// version of the getList request header
+const int MASTER_PROTOCOL_VERSION		= 1;
+
+// getList capabilities, the reply encodings a client understands
+const int MASTER_CAP_DELTA				= BIT( 0 );	// changes since the client's generation instead of the full list
+const int MASTER_CAP_COMPRESSED			= BIT( 1 );	// SERVERS_DELTA_COMPRESSED full lists
+const int MASTER_CAP_GROUPED			= BIT( 2 );	// SERVERS_DELTA_GROUPED full lists
+const int MASTER_CAP_INFO				= BIT( 3 );	// wants a serversInfo reply with the cached serverinfo
+const int MASTER_CAP_REGION_ONLY		= BIT( 4 );	// only servers in the client's region, if the master knows it
+const int MASTER_CAPS_SUPPORTED			= MASTER_CAP_DELTA | MASTER_CAP_COMPRESSED | MASTER_CAP_GROUPED | MASTER_CAP_INFO | MASTER_CAP_REGION_ONLY;
+
+// getServersDelta request flags
+const int SERVERS_REQUEST_COMPRESSED	= BIT( 0 );	// client can decode a compressed full list
+const int SERVERS_REQUEST_GROUPED		= BIT( 1 );	// client can decode a grouped full list
+const int SERVERS_REQUEST_REGION_ONLY	= BIT( 2 );	// only servers in the client's region
+
+// serversDelta flags
+const int SERVERS_DELTA_RESET			= BIT( 0 );	// full list follows, drop what you have
+const int SERVERS_DELTA_COMPRESSED		= BIT( 1 );	// the list is compressed, see EncodeServerList
+const int SERVERS_DELTA_GROUPED			= BIT( 2 );	// ip, port count and ports per group instead of one record per change
+
 class idAsyncServer {
 public:
 						idAsyncServer();
@@ -166,17 +245,22 @@ public:
 	int					GetPort( void ) const;
 	netadr_t			GetBoundAdr( void ) const;
 	bool				IsActive( void ) const { return active; }
-	int					GetDelay( void ) const { return gameTimeResidual; }
 	int					GetOutgoingRate( void ) const;
 	int					GetIncomingRate( void ) const;
 
-	void				RunFrame( void );
+	int					RunFrame( void );
 	void				RemoteConsoleOutput( const char *string );
 
 	void				UpdateAsyncStatsAvg( void );
 	void				GetAsyncStatsAvgMsg( idStr &msg );
 
-	bool				ConnectionlessMessage( const netadr_t from, const idBitMsg &msg );
+	bool				ConnectionlessMessage( const netadr_t from, const idMsgView &msg );
+	bool				LoadFilter( bool verbose );	// false if net_masterFilterFile couldn't be read
+	bool				LoadRegions( bool verbose );	// false if net_masterRegionFile couldn't be read
+	void				PrintStats( void ) const;
+
+	static void			TestListCompression_f( const idCmdArgs &args );
+	static void			TestStartup_f( const idCmdArgs &args );
 	bool				active;						// true if server is active
 
 private:
@@ -184,6 +268,7 @@ private:
 
 	int					serverTime;					// local server time
 	idPort				serverPort;					// UDP port
+	byte				packetBuf[MAX_MESSAGE_SIZE+1];	// receive buffer, one spare byte to terminate the packet
 	int					serverId;					// server identification
 	int					serverDataChecksum;			// checksum of the data used by the server
 	int					localClientNum;				// local client on listen server
@@ -195,12 +280,13 @@ private:
 	int					gameInitId;					// game initialization identification
 	int					gameFrame;					// local game frame
 	int					gameTime;					// local game time
-	int					gameTimeResidual;			// left over time from previous frame
 
 	netadr_t			rconAddress;
 
 	int					nextHeartbeatTime;
 	int					nextAsyncStatsTime;
+	int					nextExpireTime;				// next time a registered server may time out
+	int					nextProbeTime;				// next time a registered server is due for a getInfo probe
 
 	bool				serverReloadingEngine;		// flip-flop to not loop over when net_serverReloadEngine is on
 
@@ -217,14 +303,79 @@ private:
 	int					stats_max;
 	int					stats_max_index;
 
-	bool				ProcessMessage( const netadr_t from, idBitMsg &msg );
+	bool				ProcessMessage( const netadr_t from, const idMsgView &msg );
 	bool				ProcessHeartbeatMessage( const netadr_t from );
-	void				ProcessRequestServersMessage( const netadr_t from, const idBitMsg &msg );
-	void				ProcessAuthRequestMessage( const netadr_t from, const idBitMsg &msg );
-	int					UpdateTime( int clamp );
+	void				ProcessRequestServersMessage( const netadr_t from, const idMsgView &msg );
+	void				ProcessAuthRequestMessage( const netadr_t from, const idMsgView &msg );
+	void				ProcessInfoResponseMessage( const netadr_t from, const idMsgView &msg );
+	void				ProcessRequestServersInfoMessage( const netadr_t from, const idMsgView &msg );
+	void				ProbeServers( void );
+	void				ProcessRequestServersDeltaMessage( const netadr_t from, const idMsgView &msg );
+	void				ProcessRequestListMessage( const netadr_t from, const idMsgView &msg );
+	void				SendServerList( const netadr_t from, int generation, int capabilities );
+	void				SendServersInfo( const netadr_t from );
+	void				RecordListChange( const netadr_t &adr, bool added );
+	void				UpdateListCache( void );
 	bool				AddServerToMaster( const netadr_t from);
-
-	idList<serverData_t>	servers;
+	void				ExpireServers( void );
+	int					ServerHashKey( const netadr_t &adr ) const;
+	serverData_t *		FindServer( const netadr_t &adr ) const;
+	void				SortServers( void );
+	int					LowerBoundServer( unsigned int ip, int port ) const;
+	int					FindServerRange( unsigned int ip, int prefixBits, int &num );
+	void				RemoveServer( int index );
+	int					FindSubnet( unsigned int subnet ) const;
+	int					SubnetServerCount( const netadr_t &adr ) const;
+	void				AdjustSubnetCount( const netadr_t &adr, int delta );
+	int					ReplyCookie( const netadr_t &adr, int timeSlot ) const;
+	void				CheckStartupTime( void );
+	bool				BeginReply( const netadr_t from, int cookie, bool offerCookie = true );
+	bool				SendReply( const netadr_t to, const idBitMsg &msg );
+	void				EndReply( void );
+	static idHttpBody *	HttpHandler( void *context, const char *path );
+	idHttpBody *		GetListJSON( void );
+	idHttpBody *		GetStatsJSON( void ) const;
+
+	idSlotMap<serverData_t>	serverPool;					// registry entries, they never move once registered
+	idList<serverData_t *>	servers;					// sorted by ip and port up to numSortedServers, new servers after that
+	idHashIndex			serverHash;					// serverPool slots indexed by address
+	int					numSortedServers;
+
+	idNetFilter			filter;						// ban and allow ranges, checked before a packet is parsed
+	int					numFilteredPackets;
+	bool				receivedPacket;				// false until the first packet was processed, for com_showStartupTimes
+	int					startupBudget;				// msec to the first packet testStartup allows, -1 if it isn't waiting
+	bool				startupQuit;				// testStartup quits once it is done
+	idArena *			frameArena;					// temporaries of the current frame, NULL outside RunFrame
+
+	idList<subnetCount_t>	subnetCounts;				// registered servers per subnet, only subnets with servers
+	idHashIndex			subnetHash;					// subnetCounts indexed by subnet
+	int					numQuotaRefused;			// heartbeats refused because the subnet was full
+
+	idRegionTable		regions;					// address prefix to region, servers are tagged on their first heartbeat
+
+	replySource_t		replySources[MAX_REPLY_SOURCES];
+	replySource_t *		replySource;				// source of the reply being sent, NULL if it was verified
+	bool				replyActive;				// between BeginReply and EndReply
+	int					replyBudget;				// bytes left for the reply being sent, -1 for no limit
+	int					replySent;
+	double				replyStartTime;
+	replyStats_t		replyStats;
+
+	idHttpServer		http;						// JSON list and stats on net_masterHttpPort
+	idHttpBody *		listJSON;					// built from the list cache, NULL if there is none yet
+	int					listJSONGeneration;
+
+	int					listGeneration;				// bumped on every registry change
+	listChange_t		listHistory[MAX_LIST_HISTORY];	// change that produced generation g is at g % MAX_LIST_HISTORY
+	int					listHistoryNum;				// number of valid entries in listHistory
+
+	int					listCacheGeneration;		// generation the cached full lists were built for
+	bool				listCacheValid;
+	idList<byte>		plainListCache;				// sorted full list, ip and port per server
+	idList<int>			regionListCache;			// region of each server in plainListCache
+	idList<byte>		groupedListCache;			// sorted full list, ip, port count and ports per group
+	idList<byte>		compressedListCache;		// the same list through EncodeServerList, empty if it doesn't fit a packet
 };
 
 #endif /* !__ASYNCSERVER_H__ */
@@ -0,0 +1,450 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "sys/platform.h"
+#include "framework/Common.h"
+#include "framework/async/NetFilter.h"
+
+#include "framework/async/HttpServer.h"
+
+// keep-alive connections without a request for this long are closed, so are stalled replies
+const int HTTP_IDLE_MSEC				= 15000;
+
+// connections taken from the backlog per frame at most
+const int MAX_HTTP_ACCEPTS				= 16;
+
+// the listener isn't waited on for this long after accept failed, e.g. out of file descriptors,
+// it stays readable until a connection can be taken and the loop would spin otherwise
+const int HTTP_ACCEPT_RETRY_MSEC		= 1000;
+
+// connections are checked for idle timeouts this often at least
+const int HTTP_IDLE_CHECK_MSEC			= 1000;
+
+/*
+================
+idHttpServer::idHttpServer
+================
+*/
+idHttpServer::idHttpServer( void ) {
+	int i;
+
+	handler = NULL;
+	context = NULL;
+	filter = NULL;
+	acceptResumeTime = 0;
+	for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+		connections[i].requestSize = 0;
+		connections[i].body = NULL;
+		connections[i].replying = false;
+	}
+	memset( &stats, 0, sizeof( stats ) );
+}
+
+/*
+================
+idHttpServer::~idHttpServer
+================
+*/
+idHttpServer::~idHttpServer( void ) {
+	Shutdown();
+}
+
+/*
+================
+idHttpServer::Init
+================
+*/
+bool idHttpServer::Init( int port, httpHandler_t handler, void *context, const idNetFilter *filter ) {
+	Shutdown();
+
+	if ( !listener.Listen( port ) ) {
+		return false;
+	}
+	this->handler = handler;
+	this->context = context;
+	this->filter = filter;
+	acceptResumeTime = 0;
+	common->Printf( "HTTP server listening on port %d\n", port );
+	return true;
+}
+
+/*
+================
+idHttpServer::Shutdown
+================
+*/
+void idHttpServer::Shutdown( void ) {
+	int i;
+
+	for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+		CloseConnection( connections[i] );
+	}
+	listener.Close();
+}
+
+/*
+================
+idHttpServer::NumConnections
+================
+*/
+int idHttpServer::NumConnections( void ) const {
+	int i, num;
+
+	num = 0;
+	for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+		if ( connections[i].socket.IsOpen() ) {
+			num++;
+		}
+	}
+	return num;
+}
+
+/*
+================
+idHttpServer::GetWaitSockets
+================
+*/
+int idHttpServer::GetWaitSockets( idTCP **sockets, int maxSockets, int time ) {
+	int i, num;
+
+	num = 0;
+	if ( !listener.IsOpen() || maxSockets <= 0 ) {
+		return 0;
+	}
+	listener.waitFlags = ( time - acceptResumeTime >= 0 ) ? TCP_WAIT_READ : 0;
+	sockets[num++] = &listener;
+
+	for ( i = 0; i < MAX_HTTP_CONNECTIONS && num < maxSockets; i++ ) {
+		httpConnection_t &c = connections[i];
+		if ( !c.socket.IsOpen() ) {
+			continue;
+		}
+		// don't read further requests before the reply to the current one is out
+		c.socket.waitFlags = c.replying ? TCP_WAIT_WRITE : TCP_WAIT_READ;
+		sockets[num++] = &c.socket;
+	}
+	return num;
+}
+
+/*
+================
+idHttpServer::GetWaitTimeout
+
+Milliseconds until RunFrame has timed work to do, -1 if it only reacts to the sockets.
+================
+*/
+int idHttpServer::GetWaitTimeout( int time ) const {
+	int timeout = -1;
+
+	if ( !listener.IsOpen() ) {
+		return -1;
+	}
+	if ( time - acceptResumeTime < 0 ) {
+		timeout = acceptResumeTime - time;
+	}
+	if ( NumConnections() ) {
+		timeout = ( timeout < 0 ) ? HTTP_IDLE_CHECK_MSEC : Min( timeout, HTTP_IDLE_CHECK_MSEC );
+	}
+	return timeout;
+}
+
+/*
+================
+idHttpServer::CloseConnection
+================
+*/
+void idHttpServer::CloseConnection( httpConnection_t &c ) {
+	c.socket.Close();
+	c.socket.readyFlags = 0;
+	if ( c.body ) {
+		c.body->Release();
+		c.body = NULL;
+	}
+	c.requestSize = 0;
+	c.replying = false;
+}
+
+/*
+================
+idHttpServer::AcceptConnections
+
+Connections over the limit or from banned addresses are closed right away, so they don't sit in the backlog.
+================
+*/
+void idHttpServer::AcceptConnections( int time ) {
+	int		i, j, result;
+	idTCP	spare;
+
+	for ( i = 0; i < MAX_HTTP_ACCEPTS; i++ ) {
+		for ( j = 0; j < MAX_HTTP_CONNECTIONS; j++ ) {
+			if ( !connections[j].socket.IsOpen() ) {
+				break;
+			}
+		}
+		idTCP &socket = ( j < MAX_HTTP_CONNECTIONS ) ? connections[j].socket : spare;
+		result = listener.Accept( socket );
+		if ( result < 0 ) {
+			acceptResumeTime = time + HTTP_ACCEPT_RETRY_MSEC;
+			break;
+		}
+		if ( result == 0 ) {
+			break;
+		}
+		if ( &socket == &spare || ( filter && filter->IsBanned( socket.GetAdr() ) ) ) {
+			socket.Close();
+			stats.refused++;
+			continue;
+		}
+
+		httpConnection_t &c = connections[j];
+		c.requestSize = 0;
+		c.body = NULL;
+		c.replying = false;
+		c.keepAlive = true;
+		c.lastTime = time;
+		c.socket.readyFlags = 0;
+		stats.connections++;
+	}
+}
+
+/*
+================
+idHttpServer::SetReply
+
+Takes over the reference to body.
+================
+*/
+void idHttpServer::SetReply( httpConnection_t &c, int status, const char *reason, idHttpBody *body, bool sendBody ) {
+	int length = body ? body->text.Length() : 0;
+
+	c.headerSize = idStr::snPrintf( c.header, sizeof( c.header ),
+		"HTTP/1.1 %d %s\r\n"
+		"Content-Type: %s\r\n"
+		"Content-Length: %d\r\n"
+		"Cache-Control: no-cache\r\n"
+		"Access-Control-Allow-Origin: *\r\n"
+		"Connection: %s\r\n"
+		"\r\n",
+		status, reason, body ? body->contentType : "text/plain", length, c.keepAlive ? "keep-alive" : "close" );
+	c.body = body;
+	c.bodySize = sendBody ? length : 0;
+	c.sent = 0;
+	c.replying = true;
+
+	stats.requests++;
+	if ( status >= 400 ) {
+		stats.errors++;
+	}
+}
+
+/*
+================
+idHttpServer::HandleRequest
+
+Answers the first request in the buffer, returns false if it isn't complete yet.
+================
+*/
+bool idHttpServer::HandleRequest( httpConnection_t &c ) {
+	char		text[MAX_HTTP_REQUEST + 1];
+	char		method[16], path[1024];
+	char *		line;
+	char *		next;
+	int			i, length, major, minor;
+	bool		sendBody;
+	idHttpBody *body;
+
+	length = 0;
+	for ( i = 3; i < c.requestSize; i++ ) {
+		if ( c.request[i] == '\n' && c.request[i - 1] == '\r' && c.request[i - 2] == '\n' && c.request[i - 3] == '\r' ) {
+			length = i + 1;
+			break;
+		}
+	}
+	if ( !length ) {
+		if ( c.requestSize >= MAX_HTTP_REQUEST ) {
+			c.keepAlive = false;
+			c.requestSize = 0;
+			SetReply( c, 431, "Request Header Fields Too Large", NULL, false );
+			return true;
+		}
+		return false;
+	}
+
+	// take the request out of the buffer, whatever follows is the next pipelined request
+	memcpy( text, c.request, length );
+	text[length] = '\0';
+	c.requestSize -= length;
+	memmove( c.request, c.request + length, c.requestSize );
+
+	if ( sscanf( text, "%15s %1023s HTTP/%d.%d", method, path, &major, &minor ) != 4 || major != 1 ) {
+		c.keepAlive = false;
+		SetReply( c, 400, "Bad Request", NULL, false );
+		return true;
+	}
+
+	c.keepAlive = ( minor >= 1 );
+	for ( line = strchr( text, '\n' ); line; line = next ) {
+		line++;
+		next = strchr( line, '\n' );
+		if ( idStr::Icmpn( line, "Connection:", 11 ) ) {
+			continue;
+		}
+		if ( next ) {
+			*next = '\0';
+		}
+		if ( idStr::FindText( line, "close", false ) != -1 ) {
+			c.keepAlive = false;
+		} else if ( idStr::FindText( line, "keep-alive", false ) != -1 ) {
+			c.keepAlive = true;
+		}
+		if ( next ) {
+			*next = '\n';
+		}
+	}
+
+	if ( !idStr::Cmp( method, "GET" ) ) {
+		sendBody = true;
+	} else if ( !idStr::Cmp( method, "HEAD" ) ) {
+		sendBody = false;
+	} else {
+		SetReply( c, 405, "Method Not Allowed", NULL, false );
+		return true;
+	}
+
+	if ( ( line = strchr( path, '?' ) ) != NULL ) {
+		*line = '\0';
+	}
+	body = handler ? handler( context, path ) : NULL;
+	if ( !body ) {
+		SetReply( c, 404, "Not Found", NULL, false );
+		return true;
+	}
+	SetReply( c, 200, "OK", body, sendBody );
+	return true;
+}
+
+/*
+================
+idHttpServer::WriteReply
+
+Sends as much of the pending reply as the socket takes.
+Returns true if the reply went out completely and the connection stays open.
+================
+*/
+bool idHttpServer::WriteReply( httpConnection_t &c, int time ) {
+	const void *	data[2];
+	int				sizes[2];
+	int				count, n;
+
+	count = 0;
+	if ( c.sent < c.headerSize ) {
+		data[count] = c.header + c.sent;
+		sizes[count++] = c.headerSize - c.sent;
+		if ( c.bodySize ) {
+			data[count] = c.body->text.c_str();
+			sizes[count++] = c.bodySize;
+		}
+	} else {
+		data[count] = c.body->text.c_str() + ( c.sent - c.headerSize );
+		sizes[count++] = c.headerSize + c.bodySize - c.sent;
+	}
+
+	n = c.socket.WriteV( data, sizes, count );
+	if ( n < 0 ) {
+		CloseConnection( c );
+		return false;
+	}
+	if ( n > 0 ) {
+		c.sent += n;
+		c.lastTime = time;
+		stats.bytesSent += n;
+	}
+	if ( c.sent < c.headerSize + c.bodySize ) {
+		return false;
+	}
+
+	if ( c.body ) {
+		c.body->Release();
+		c.body = NULL;
+	}
+	c.replying = false;
+	if ( !c.keepAlive ) {
+		CloseConnection( c );
+		return false;
+	}
+	return true;
+}
+
+/*
+================
+idHttpServer::RunFrame
+================
+*/
+void idHttpServer::RunFrame( int time ) {
+	int i, n;
+
+	if ( !listener.IsOpen() ) {
+		return;
+	}
+
+	if ( listener.readyFlags & TCP_WAIT_READ ) {
+		AcceptConnections( time );
+	}
+	listener.readyFlags = 0;
+
+	for ( i = 0; i < MAX_HTTP_CONNECTIONS; i++ ) {
+		httpConnection_t &c = connections[i];
+		if ( !c.socket.IsOpen() ) {
+			continue;
+		}
+
+		if ( c.replying ) {
+			if ( ( c.socket.readyFlags & TCP_WAIT_WRITE ) && !WriteReply( c, time ) ) {
+				c.socket.readyFlags = 0;
+				continue;
+			}
+		} else if ( c.socket.readyFlags & TCP_WAIT_READ ) {
+			n = c.socket.Read( c.request + c.requestSize, MAX_HTTP_REQUEST - c.requestSize );
+			if ( n < 0 ) {
+				CloseConnection( c );
+				continue;
+			}
+			c.requestSize += n;
+			c.lastTime = time;
+		}
+		c.socket.readyFlags = 0;
+
+		// answer what is buffered for as long as the replies go out right away
+		while ( !c.replying && HandleRequest( c ) && WriteReply( c, time ) ) {
+		}
+
+		if ( c.socket.IsOpen() && time - c.lastTime > HTTP_IDLE_MSEC ) {
+			CloseConnection( c );
+		}
+	}
+}
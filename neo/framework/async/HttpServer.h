@@ -0,0 +1,129 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __HTTPSERVER_H__
+#define __HTTPSERVER_H__
+
+#include "idlib/Str.h"
+#include "sys/sys_public.h"
+
+class idNetFilter;
+
+/*
+===============================================================================
+
+  Minimal HTTP/1.1 server.
+
+  Serves GET and HEAD requests with keep-alive from non blocking sockets, meant to
+  run from the same loop as the UDP port. Replies are written straight from the
+  body they were generated into, which connections keep referenced until sent.
+
+===============================================================================
+*/
+
+// a reply body shared by all connections sending it
+class idHttpBody {
+public:
+						idHttpBody( const char *contentType ) : contentType( contentType ), refCount( 1 ) {}
+
+	void				AddRef( void ) { refCount++; }
+	void				Release( void ) { if ( --refCount == 0 ) { delete this; } }
+
+	idStr				text;
+	const char *		contentType;
+
+private:
+	int					refCount;
+};
+
+// returns a referenced body for path or NULL if there is nothing there
+typedef idHttpBody *(*httpHandler_t)( void *context, const char *path );
+
+const int MAX_HTTP_CONNECTIONS			= 64;
+const int MAX_HTTP_REQUEST				= 4096;		// request line and headers at most
+const int MAX_HTTP_HEADER				= 512;		// reply status line and headers at most
+
+typedef struct httpConnection_s {
+	idTCP				socket;
+	char				request[MAX_HTTP_REQUEST];
+	int					requestSize;
+	char				header[MAX_HTTP_HEADER];
+	int					headerSize;
+	idHttpBody *		body;				// NULL if there is no reply pending or it has no body
+	int					bodySize;			// 0 for HEAD requests
+	int					sent;				// of headerSize + bodySize
+	bool				replying;
+	bool				keepAlive;
+	int					lastTime;			// last time anything was read or written
+} httpConnection_t;
+
+typedef struct httpStats_s {
+	int					connections;		// accepted
+	int					refused;			// closed right away, banned or no free slot
+	int					requests;
+	int					errors;				// requests answered with an error status
+	int					bytesSent;
+} httpStats_t;
+
+class idHttpServer {
+public:
+						idHttpServer( void );
+						~idHttpServer( void );
+
+	bool				Init( int port, httpHandler_t handler, void *context, const idNetFilter *filter );
+	void				Shutdown( void );
+	bool				IsActive( void ) const { return listener.IsOpen(); }
+	int					GetPort( void ) const { return listener.GetAdr().port; }
+
+						// sockets for Sys_WaitForEvents, with their waitFlags set
+	int					GetWaitSockets( idTCP **sockets, int maxSockets, int time );
+						// milliseconds Sys_WaitForEvents may sleep at most, -1 for no limit
+	int					GetWaitTimeout( int time ) const;
+						// handles the sockets Sys_WaitForEvents found ready and drops idle connections
+	void				RunFrame( int time );
+
+	int					NumConnections( void ) const;
+	const httpStats_t &	GetStats( void ) const { return stats; }
+
+private:
+	idTCP				listener;
+	httpConnection_t	connections[MAX_HTTP_CONNECTIONS];
+	httpHandler_t		handler;
+	void *				context;
+	const idNetFilter *	filter;
+	httpStats_t			stats;
+	int					acceptResumeTime;	// the listener is left alone until then after accept failed
+
+	void				AcceptConnections( int time );
+	void				CloseConnection( httpConnection_t &c );
+	bool				HandleRequest( httpConnection_t &c );
+	void				SetReply( httpConnection_t &c, int status, const char *reason, idHttpBody *body, bool sendBody );
+	bool				WriteReply( httpConnection_t &c, int time );
+};
+
+#endif /* !__HTTPSERVER_H__ */
@@ -0,0 +1,299 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "sys/platform.h"
+#include "idlib/math/Math.h"
+#include "idlib/math/Random.h"
+#include "framework/Common.h"
+#include "framework/CmdSystem.h"
+#include "framework/FileSystem.h"
+
+#include "framework/async/NetUtil.h"
+#include "framework/async/NetFilter.h"
+
+/*
+================
+FilterBit
+
+Bit n of ip counting from the most significant one.
+================
+*/
+static ID_INLINE int FilterBit( unsigned int ip, int n ) {
+	return ( ip >> ( 31 - n ) ) & 1;
+}
+
+/*
+================
+FilterMask
+================
+*/
+static ID_INLINE unsigned int FilterMask( int numBits ) {
+	return numBits <= 0 ? 0 : 0xffffffffu << ( 32 - numBits );
+}
+
+/*
+================
+FilterCommonBits
+
+Length of the common prefix of a and b, at most maxBits.
+================
+*/
+static int FilterCommonBits( unsigned int a, unsigned int b, int maxBits ) {
+	unsigned int diff = a ^ b;
+	int n;
+
+	for ( n = 0; n < maxBits; n++ ) {
+		if ( diff & ( 0x80000000u >> n ) ) {
+			break;
+		}
+	}
+	return n;
+}
+
+/*
+================
+idNetFilter::idNetFilter
+================
+*/
+idNetFilter::idNetFilter( void ) {
+	root = -1;
+}
+
+/*
+================
+idNetFilter::Clear
+================
+*/
+void idNetFilter::Clear( void ) {
+	nodes.Clear();
+	rules.Clear();
+	root = -1;
+}
+
+/*
+================
+idNetFilter::NewNode
+================
+*/
+int idNetFilter::NewNode( unsigned int prefix, int numBits, filterAction_t action ) {
+	node_t n;
+
+	n.mask = FilterMask( numBits );
+	n.prefix = prefix & n.mask;
+	n.numBits = numBits;
+	n.action = action;
+	n.rule = ( action != FILTER_NONE ) ? NewRule( n.prefix, numBits, action ) : -1;
+	n.children[0] = -1;
+	n.children[1] = -1;
+	return nodes.Append( n );
+}
+
+/*
+================
+idNetFilter::NewRule
+================
+*/
+int idNetFilter::NewRule( unsigned int prefix, int numBits, filterAction_t action ) {
+	filterRule_t &rule = rules.Alloc();
+
+	rule.prefix = prefix;
+	rule.numBits = numBits;
+	rule.action = action;
+	return rules.Num() - 1;
+}
+
+/*
+================
+idNetFilter::AddRule
+
+A rule for a range that already has one replaces it. The range's node is found
+by the trie walk, so loading n rules doesn't scan the rule list n times.
+================
+*/
+void idNetFilter::AddRule( unsigned int prefix, int numBits, filterAction_t action ) {
+	int i, parent, side, common, up, leaf;
+
+	numBits = idMath::ClampInt( 0, 32, numBits );
+	prefix &= FilterMask( numBits );
+
+	parent = -1;
+	side = 0;
+	i = root;
+	while ( i != -1 ) {
+		common = FilterCommonBits( prefix, nodes[i].prefix, Min( numBits, nodes[i].numBits ) );
+		if ( common < nodes[i].numBits ) {
+			// the new range splits the edge above node i
+			if ( common == numBits ) {
+				up = NewNode( prefix, numBits, action );
+			} else {
+				up = NewNode( prefix, common, FILTER_NONE );
+				// NewNode can move nodes, so it can't be called in the same expression that indexes them
+				leaf = NewNode( prefix, numBits, action );
+				nodes[up].children[ FilterBit( prefix, common ) ] = leaf;
+			}
+			nodes[up].children[ FilterBit( nodes[i].prefix, common ) ] = i;
+			i = up;
+			break;
+		}
+		if ( nodes[i].numBits == numBits ) {
+			// a branch node for this range picks up its first rule
+			if ( nodes[i].rule == -1 ) {
+				nodes[i].rule = NewRule( prefix, numBits, action );
+			}
+			nodes[i].action = action;
+			rules[ nodes[i].rule ].action = action;
+			return;
+		}
+		parent = i;
+		side = FilterBit( prefix, nodes[i].numBits );
+		i = nodes[i].children[side];
+	}
+
+	if ( i == -1 ) {
+		i = NewNode( prefix, numBits, action );
+	}
+	if ( parent == -1 ) {
+		root = i;
+	} else {
+		nodes[parent].children[side] = i;
+	}
+}
+
+/*
+================
+idNetFilter::LoadFile
+
+One rule per line, "ban <range>" or "allow <range>", a bare range is banned.
+Everything after // or # is a comment. The current rules are kept if the file can't be read.
+================
+*/
+bool idNetFilter::LoadFile( const char *fileName ) {
+	char *			buffer;
+	char *			line;
+	char *			next;
+	char			word[2][64];
+	int				lineNum, numWords;
+	unsigned int	prefix;
+	int				numBits;
+	filterAction_t	action;
+
+	if ( fileSystem->ReadFile( fileName, (void **)&buffer ) < 0 ) {
+		return false;
+	}
+
+	Clear();
+	next = buffer;
+	for ( lineNum = 1; ( line = Net_NextLine( next ) ) != NULL; lineNum++ ) {
+		numWords = sscanf( line, "%63s %63s", word[0], word[1] );
+		if ( numWords <= 0 ) {
+			continue;
+		}
+		action = FILTER_BAN;
+		if ( numWords == 2 ) {
+			if ( !idStr::Icmp( word[0], "allow" ) ) {
+				action = FILTER_ALLOW;
+			} else if ( idStr::Icmp( word[0], "ban" ) ) {
+				common->Warning( "%s(%d): expected ban or allow instead of '%s'", fileName, lineNum, word[0] );
+				continue;
+			}
+			idStr::Copynz( word[0], word[1], sizeof( word[0] ) );
+		}
+		if ( !Net_ParseCIDR( word[0], prefix, numBits ) ) {
+			common->Warning( "%s(%d): bad address range '%s'", fileName, lineNum, word[0] );
+			continue;
+		}
+		AddRule( prefix, numBits, action );
+	}
+
+	fileSystem->FreeFile( buffer );
+	return true;
+}
+
+/*
+================
+idNetFilter::Test_f
+
+Checks lookups against a linear scan of the rules and times them.
+================
+*/
+void idNetFilter::Test_f( const idCmdArgs &args ) {
+	const int		NUM_LOOKUPS = 1000000;
+	const int		NUM_CHECKS = 20000;
+	idNetFilter		filter;
+	idRandom		rnd( 0xb4d );
+	idList<unsigned int> ips;
+	int				i, j, numRules, numErrors, bestBits, numBanned;
+	filterAction_t	expected;
+	double			start, usec;
+
+	numRules = ( args.Argc() > 1 ) ? atoi( args.Argv( 1 ) ) : 10000;
+	numRules = idMath::ClampInt( 1, 1000000, numRules );
+
+	for ( i = 0; i < numRules; i++ ) {
+		// mostly hosting sized networks with a few allowed holes in them
+		int numBits = 8 + rnd.RandomInt( 25 );
+		filter.AddRule( Net_RandomIP( rnd ), numBits, ( rnd.RandomInt( 8 ) == 0 ) ? FILTER_ALLOW : FILTER_BAN );
+	}
+
+	numErrors = 0;
+	for ( i = 0; i < NUM_CHECKS; i++ ) {
+		unsigned int ip = Net_RandomIP( rnd );
+		if ( i & 1 ) {
+			// land inside a rule half of the time
+			const filterRule_t &rule = filter.GetRule( rnd.RandomInt( filter.NumRules() ) );
+			ip = rule.prefix | ( ip & ~FilterMask( rule.numBits ) );
+		}
+		expected = FILTER_NONE;
+		bestBits = -1;
+		for ( j = 0; j < filter.NumRules(); j++ ) {
+			const filterRule_t &rule = filter.GetRule( j );
+			if ( rule.numBits > bestBits && !( ( ip ^ rule.prefix ) & FilterMask( rule.numBits ) ) ) {
+				bestBits = rule.numBits;
+				expected = rule.action;
+			}
+		}
+		if ( filter.Check( ip ) != expected ) {
+			numErrors++;
+		}
+	}
+
+	ips.SetNum( 4096 );
+	for ( i = 0; i < ips.Num(); i++ ) {
+		ips[i] = Net_RandomIP( rnd );
+	}
+	numBanned = 0;
+	start = Sys_Microseconds();
+	for ( i = 0; i < NUM_LOOKUPS; i++ ) {
+		numBanned += ( filter.Check( ips[i & 4095] ) == FILTER_BAN );
+	}
+	usec = Sys_Microseconds() - start;
+
+	common->Printf( "%d rules, %d trie nodes\n", filter.NumRules(), filter.nodes.Num() );
+	common->Printf( "lookup: %6.1f nsec, %d of %d banned\n", usec * 1000.0 / NUM_LOOKUPS, numBanned, NUM_LOOKUPS );
+	common->Printf( "%d of %d lookups differ from a linear scan %s\n", numErrors, NUM_CHECKS, numErrors ? S_COLOR_RED "X" S_COLOR_DEFAULT : "ok" );
+}
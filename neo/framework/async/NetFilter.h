@@ -0,0 +1,134 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __NETFILTER_H__
+#define __NETFILTER_H__
+
+#include "idlib/containers/List.h"
+#include "idlib/Str.h"
+#include "sys/sys_public.h"
+#include "framework/async/NetUtil.h"
+
+/*
+===============================================================================
+
+  Address filter.
+
+  Ban and allow rules for IPv4 CIDR ranges, stored in a path compressed binary
+  trie. The longest matching prefix decides, so an allowed host inside a banned
+  network gets through.
+
+===============================================================================
+*/
+
+typedef enum {
+	FILTER_NONE,
+	FILTER_BAN,
+	FILTER_ALLOW
+} filterAction_t;
+
+typedef struct filterRule_s {
+	unsigned int		prefix;			// host order, bits past numBits are zero
+	int					numBits;
+	filterAction_t		action;
+} filterRule_t;
+
+class idNetFilter {
+public:
+						idNetFilter( void );
+
+	void				Clear( void );
+	void				AddRule( unsigned int prefix, int numBits, filterAction_t action );
+	bool				LoadFile( const char *fileName );
+
+	filterAction_t		Check( unsigned int ip ) const;
+	bool				IsBanned( const netadr_t &adr ) const;
+
+	int					NumRules( void ) const { return rules.Num(); }
+	const filterRule_t &GetRule( int index ) const { return rules[index]; }
+
+	static void			Test_f( const class idCmdArgs &args );
+
+private:
+	typedef struct node_s {
+		unsigned int	prefix;
+		unsigned int	mask;			// numBits leading ones
+		int				numBits;
+		int				action;			// filterAction_t, FILTER_NONE for nodes that only branch
+		int				rule;			// index in rules, -1 for nodes that only branch
+		int				children[2];
+	} node_t;
+
+	idList<node_t>		nodes;
+	int					root;
+	idList<filterRule_t> rules;
+
+	int					NewNode( unsigned int prefix, int numBits, filterAction_t action );
+	int					NewRule( unsigned int prefix, int numBits, filterAction_t action );
+};
+
+/*
+================
+idNetFilter::Check
+
+Returns the action of the longest rule containing ip.
+================
+*/
+ID_INLINE filterAction_t idNetFilter::Check( unsigned int ip ) const {
+	int action = FILTER_NONE;
+	int i = root;
+
+	while ( i != -1 ) {
+		const node_t &n = nodes[i];
+		if ( ( ip ^ n.prefix ) & n.mask ) {
+			break;
+		}
+		if ( n.action != FILTER_NONE ) {
+			action = n.action;
+		}
+		if ( n.numBits >= 32 ) {
+			break;
+		}
+		i = n.children[ ( ip >> ( 31 - n.numBits ) ) & 1 ];
+	}
+	return (filterAction_t)action;
+}
+
+/*
+================
+idNetFilter::IsBanned
+================
+*/
+ID_INLINE bool idNetFilter::IsBanned( const netadr_t &adr ) const {
+	if ( adr.type != NA_IP || root == -1 ) {
+		return false;
+	}
+	return Check( Net_AdrToIP( adr ) ) == FILTER_BAN;
+}
+
+#endif /* !__NETFILTER_H__ */
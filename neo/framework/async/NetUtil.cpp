@@ -0,0 +1,101 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "sys/platform.h"
+#include "idlib/math/Random.h"
+
+#include "framework/async/NetUtil.h"
+
+/*
+================
+Net_ParseCIDR
+
+Parses a.b.c.d or a.b.c.d/n.
+================
+*/
+bool Net_ParseCIDR( const char *s, unsigned int &prefix, int &numBits ) {
+	unsigned int b[4];
+	int n, len;
+
+	len = 0;
+	if ( sscanf( s, "%u.%u.%u.%u%n", &b[0], &b[1], &b[2], &b[3], &len ) != 4 || b[0] > 255 || b[1] > 255 || b[2] > 255 || b[3] > 255 ) {
+		return false;
+	}
+	numBits = 32;
+	if ( s[len] == '/' ) {
+		if ( sscanf( s + len + 1, "%d%n", &numBits, &n ) != 1 || numBits < 0 || numBits > 32 ) {
+			return false;
+		}
+		len += 1 + n;
+	}
+	if ( s[len] != '\0' ) {
+		return false;
+	}
+	prefix = ( b[0] << 24 ) | ( b[1] << 16 ) | ( b[2] << 8 ) | b[3];
+	return true;
+}
+
+/*
+================
+Net_NextLine
+
+Cuts the next line out of a writable text buffer and strips everything after // or #.
+Returns NULL past the end of the buffer.
+================
+*/
+char *Net_NextLine( char *&text ) {
+	char *line;
+	char *comment;
+
+	line = text;
+	if ( !line ) {
+		return NULL;
+	}
+	text = strchr( line, '\n' );
+	if ( text ) {
+		*text++ = '\0';
+	}
+	if ( ( comment = strstr( line, "//" ) ) != NULL ) {
+		*comment = '\0';
+	}
+	if ( ( comment = strchr( line, '#' ) ) != NULL ) {
+		*comment = '\0';
+	}
+	return line;
+}
+
+/*
+================
+Net_RandomIP
+
+Spreads random bits over the whole address, for the filter and region benchmarks.
+================
+*/
+unsigned int Net_RandomIP( idRandom &rnd ) {
+	return ( (unsigned int)rnd.RandomInt() << 17 ) ^ ( (unsigned int)rnd.RandomInt() << 2 ) ^ (unsigned int)rnd.RandomInt();
+}
@@ -0,0 +1,60 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __NETUTIL_H__
+#define __NETUTIL_H__
+
+#include "sys/sys_public.h"
+
+class idRandom;
+
+/*
+===============================================================================
+
+  Address and text helpers shared by the master's address tables.
+
+  The filter and the region table both read line based files of address
+  ranges, and their tests both need random addresses.
+
+===============================================================================
+*/
+
+// host order address, the first octet in the top byte
+unsigned int		Net_AdrToIP( const netadr_t &adr );
+// parses a.b.c.d or a.b.c.d/n
+bool				Net_ParseCIDR( const char *s, unsigned int &prefix, int &numBits );
+// cuts the next line out of a writable buffer and strips comments, NULL past the end
+char *				Net_NextLine( char *&text );
+// random bits over the whole address, for the benchmarks
+unsigned int		Net_RandomIP( idRandom &rnd );
+
+ID_INLINE unsigned int Net_AdrToIP( const netadr_t &adr ) {
+	return ( (unsigned int)adr.ip[0] << 24 ) | ( adr.ip[1] << 16 ) | ( adr.ip[2] << 8 ) | adr.ip[3];
+}
+
+#endif /* !__NETUTIL_H__ */
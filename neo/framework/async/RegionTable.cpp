@@ -0,0 +1,308 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "sys/platform.h"
+#include "idlib/math/Math.h"
+#include "idlib/math/Random.h"
+#include "framework/Common.h"
+#include "framework/CmdSystem.h"
+#include "framework/FileSystem.h"
+
+#include "framework/async/RegionTable.h"
+
+/*
+================
+idRegionTable::idRegionTable
+================
+*/
+idRegionTable::idRegionTable( void ) {
+}
+
+/*
+================
+idRegionTable::Clear
+================
+*/
+void idRegionTable::Clear( void ) {
+	intervals.Clear();
+	regionNames.Clear();
+	pending.Clear();
+}
+
+/*
+================
+idRegionTable::BeginPrefixes
+================
+*/
+void idRegionTable::BeginPrefixes( void ) {
+	Clear();
+}
+
+/*
+================
+idRegionTable::AddPrefix
+================
+*/
+bool idRegionTable::AddPrefix( unsigned int prefix, int numBits, const char *region ) {
+	int i;
+
+	for ( i = 0; i < regionNames.Num(); i++ ) {
+		if ( !regionNames[i].Icmp( region ) ) {
+			break;
+		}
+	}
+	if ( i == regionNames.Num() ) {
+		if ( regionNames.Num() >= MAX_REGIONS ) {
+			return false;
+		}
+		regionNames.Append( region );
+	}
+
+	numBits = idMath::ClampInt( 0, 32, numBits );
+	prefix_t &p = pending.Alloc();
+	p.first = numBits ? prefix & ( 0xffffffffu << ( 32 - numBits ) ) : 0;
+	p.last = numBits ? p.first | ~( 0xffffffffu << ( 32 - numBits ) ) : 0xffffffffu;
+	p.region = i;
+	return true;
+}
+
+/*
+================
+idRegionTable::ComparePrefixes
+
+By first address, wider prefixes before the ones nested in them.
+================
+*/
+int idRegionTable::ComparePrefixes( const prefix_t *a, const prefix_t *b ) {
+	if ( a->first != b->first ) {
+		return ( a->first < b->first ) ? -1 : 1;
+	}
+	if ( a->last != b->last ) {
+		return ( a->last > b->last ) ? -1 : 1;
+	}
+	return 0;
+}
+
+/*
+================
+idRegionTable::AddInterval
+================
+*/
+void idRegionTable::AddInterval( unsigned int first, unsigned int last, int region ) {
+	if ( intervals.Num() ) {
+		interval_t &prev = intervals[intervals.Num() - 1];
+		if ( prev.region == region && prev.last + 1 == first ) {
+			prev.last = last;
+			return;
+		}
+	}
+	interval_t &i = intervals.Alloc();
+	i.first = first;
+	i.last = last;
+	i.region = region;
+}
+
+/*
+================
+idRegionTable::FinishPrefixes
+
+CIDR prefixes either nest or don't overlap at all, so after sorting a single sweep
+with a stack of the prefixes containing the current address flattens them.
+================
+*/
+void idRegionTable::FinishPrefixes( void ) {
+	idList<prefix_t>	stack;
+	unsigned long long	next;		// first address that isn't in an interval yet
+	int					i;
+
+	pending.Sort( ComparePrefixes );
+	intervals.SetNum( 0, false );
+	intervals.SetGranularity( Max( 16, pending.Num() ) );
+
+	next = 0;
+	for ( i = 0; i < pending.Num(); i++ ) {
+		const prefix_t &p = pending[i];
+
+		while ( stack.Num() && stack[stack.Num() - 1].last < p.first ) {
+			const prefix_t &top = stack[stack.Num() - 1];
+			if ( next <= top.last ) {
+				AddInterval( (unsigned int)next, top.last, top.region );
+				next = (unsigned long long)top.last + 1;
+			}
+			stack.SetNum( stack.Num() - 1, false );
+		}
+		if ( stack.Num() && next < p.first ) {
+			AddInterval( (unsigned int)next, p.first - 1, stack[stack.Num() - 1].region );
+		}
+		next = p.first;
+		stack.Append( p );
+	}
+	while ( stack.Num() ) {
+		const prefix_t &top = stack[stack.Num() - 1];
+		if ( next <= top.last ) {
+			AddInterval( (unsigned int)next, top.last, top.region );
+			next = (unsigned long long)top.last + 1;
+		}
+		stack.SetNum( stack.Num() - 1, false );
+	}
+
+	intervals.Condense();
+	pending.Clear();
+}
+
+/*
+================
+idRegionTable::LoadFile
+
+One "<range> <region>" per line, everything after // or # is a comment.
+The current table is kept if the file can't be read.
+================
+*/
+bool idRegionTable::LoadFile( const char *fileName ) {
+	char *			buffer;
+	char *			line;
+	char *			next;
+	char			range[64], region[64];
+	int				lineNum, numBits;
+	unsigned int	prefix;
+
+	if ( fileSystem->ReadFile( fileName, (void **)&buffer ) < 0 ) {
+		return false;
+	}
+
+	BeginPrefixes();
+	next = buffer;
+	for ( lineNum = 1; ( line = Net_NextLine( next ) ) != NULL; lineNum++ ) {
+		switch( sscanf( line, "%63s %63s", range, region ) ) {
+			case EOF:
+			case 0:
+				continue;
+			case 2:
+				break;
+			default:
+				common->Warning( "%s(%d): expected an address range and a region", fileName, lineNum );
+				continue;
+		}
+		if ( !Net_ParseCIDR( range, prefix, numBits ) ) {
+			common->Warning( "%s(%d): bad address range '%s'", fileName, lineNum, range );
+			continue;
+		}
+		if ( !AddPrefix( prefix, numBits, region ) ) {
+			common->Warning( "%s(%d): more than %d regions", fileName, lineNum, MAX_REGIONS );
+		}
+	}
+	FinishPrefixes();
+
+	fileSystem->FreeFile( buffer );
+	return true;
+}
+
+/*
+================
+idRegionTable::Test_f
+
+Checks a small table against a scan of its prefixes, then times lookups in a large one.
+================
+*/
+void idRegionTable::Test_f( const idCmdArgs &args ) {
+	static const char *names[] = { "eu", "na", "sa", "as", "oc", "af", "ru", "cn" };
+	const int		NUM_CHECK_PREFIXES = 2000;
+	const int		NUM_CHECKS = 20000;
+	const int		NUM_LOOKUPS = 1000000;
+	idRandom		rnd( 0x6e0 );
+	idRegionTable	table;
+	idList<prefix_t> prefixes;
+	idList<int>		numBits;
+	idList<unsigned int> ips;
+	int				i, j, numPrefixes, numErrors, best, sum;
+	double			start, usec;
+
+	// small table, checked against the most specific matching prefix
+	table.BeginPrefixes();
+	for ( i = 0; i < NUM_CHECK_PREFIXES; i++ ) {
+		int bits = 4 + rnd.RandomInt( 25 );
+		table.AddPrefix( Net_RandomIP( rnd ), bits, names[rnd.RandomInt( 8 )] );
+		prefixes.Append( table.pending[i] );
+		numBits.Append( bits );
+	}
+	table.FinishPrefixes();
+
+	numErrors = 0;
+	for ( i = 0; i < NUM_CHECKS; i++ ) {
+		unsigned int ip = Net_RandomIP( rnd );
+		if ( i & 1 ) {
+			const prefix_t &p = prefixes[rnd.RandomInt( prefixes.Num() )];
+			ip = p.first + ( ip % ( p.last - p.first + 1 ) );
+		}
+		int result = table.Lookup( ip );
+		bool ok = false;
+		best = -1;
+		for ( j = 0; j < prefixes.Num(); j++ ) {
+			if ( ip >= prefixes[j].first && ip <= prefixes[j].last && numBits[j] > best ) {
+				best = numBits[j];
+			}
+		}
+		// identical prefixes with different regions may resolve either way
+		for ( j = 0; j < prefixes.Num(); j++ ) {
+			if ( ip >= prefixes[j].first && ip <= prefixes[j].last && numBits[j] == best && prefixes[j].region == result ) {
+				ok = true;
+			}
+		}
+		if ( best == -1 ) {
+			ok = ( result == -1 );
+		}
+		if ( !ok ) {
+			numErrors++;
+		}
+	}
+
+	// large table for timing
+	numPrefixes = ( args.Argc() > 1 ) ? atoi( args.Argv( 1 ) ) : 300000;
+	numPrefixes = idMath::ClampInt( 1, 10000000, numPrefixes );
+	start = Sys_Microseconds();
+	table.BeginPrefixes();
+	for ( i = 0; i < numPrefixes; i++ ) {
+		table.AddPrefix( Net_RandomIP( rnd ), 8 + rnd.RandomInt( 17 ), names[rnd.RandomInt( 8 )] );
+	}
+	table.FinishPrefixes();
+	usec = Sys_Microseconds() - start;
+	common->Printf( "%d prefixes flattened to %d intervals in %.1f msec\n", numPrefixes, table.NumIntervals(), usec / 1000.0 );
+
+	ips.SetNum( 4096 );
+	for ( i = 0; i < ips.Num(); i++ ) {
+		ips[i] = Net_RandomIP( rnd );
+	}
+	sum = 0;
+	start = Sys_Microseconds();
+	for ( i = 0; i < NUM_LOOKUPS; i++ ) {
+		sum += table.Lookup( ips[i & 4095] );
+	}
+	usec = Sys_Microseconds() - start;
+	common->Printf( "lookup: %6.1f nsec (%d)\n", usec * 1000.0 / NUM_LOOKUPS, sum );
+	common->Printf( "%d of %d lookups differ from a scan of the prefixes %s\n", numErrors, NUM_CHECKS, numErrors ? S_COLOR_RED "X" S_COLOR_DEFAULT : "ok" );
+}
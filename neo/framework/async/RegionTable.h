@@ -0,0 +1,123 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __REGIONTABLE_H__
+#define __REGIONTABLE_H__
+
+#include "idlib/containers/List.h"
+#include "idlib/containers/StrList.h"
+#include "sys/sys_public.h"
+#include "framework/async/NetUtil.h"
+
+/*
+===============================================================================
+
+  Region table.
+
+  Maps IPv4 addresses to region names from a local prefix table. Overlapping
+  prefixes are flattened into sorted disjoint intervals when the table is loaded,
+  the most specific prefix wins, so a lookup is a single binary search.
+
+===============================================================================
+*/
+
+const int MAX_REGIONS					= 255;
+
+class idRegionTable {
+public:
+						idRegionTable( void );
+
+	void				Clear( void );
+	bool				LoadFile( const char *fileName );
+
+	void				BeginPrefixes( void );
+	bool				AddPrefix( unsigned int prefix, int numBits, const char *region );
+	void				FinishPrefixes( void );
+
+	int					Lookup( unsigned int ip ) const;		// region index or -1
+	int					Lookup( const netadr_t &adr ) const;
+	int					NumRegions( void ) const { return regionNames.Num(); }
+	const char *		GetRegionName( int region ) const { return ( region >= 0 && region < regionNames.Num() ) ? regionNames[region].c_str() : "none"; }
+	int					NumIntervals( void ) const { return intervals.Num(); }
+
+	static void			Test_f( const class idCmdArgs &args );
+
+private:
+	typedef struct interval_s {
+		unsigned int	first;
+		unsigned int	last;
+		int				region;
+	} interval_t;
+
+	typedef struct prefix_s {
+		unsigned int	first;
+		unsigned int	last;
+		int				region;
+	} prefix_t;
+
+	idList<interval_t>	intervals;			// sorted and disjoint
+	idStrList			regionNames;
+	idList<prefix_t>	pending;			// prefixes added since BeginPrefixes
+
+	void				AddInterval( unsigned int first, unsigned int last, int region );
+	static int			ComparePrefixes( const prefix_t *a, const prefix_t *b );
+};
+
+/*
+================
+idRegionTable::Lookup
+================
+*/
+ID_INLINE int idRegionTable::Lookup( unsigned int ip ) const {
+	int lo, hi, mid;
+
+	// last interval starting at or before ip
+	lo = 0;
+	hi = intervals.Num();
+	while ( lo < hi ) {
+		mid = ( lo + hi ) >> 1;
+		if ( intervals[mid].first <= ip ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if ( lo == 0 || intervals[lo - 1].last < ip ) {
+		return -1;
+	}
+	return intervals[lo - 1].region;
+}
+
+ID_INLINE int idRegionTable::Lookup( const netadr_t &adr ) const {
+	if ( adr.type != NA_IP ) {
+		return -1;
+	}
+	return Lookup( Net_AdrToIP( adr ) );
+}
+
+#endif /* !__REGIONTABLE_H__ */
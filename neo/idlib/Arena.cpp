@@ -0,0 +1,347 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "sys/platform.h"
+#include "idlib/Heap.h"
+#include "idlib/Str.h"
+#include "idlib/containers/List.h"
+#include "idlib/CmdArgs.h"
+#include "sys/sys_public.h"
+#include "framework/Common.h"
+
+#include "idlib/Arena.h"
+
+idArenaPool		arenaPool;
+
+/*
+================
+idArena::idArena
+================
+*/
+idArena::idArena( void ) {
+	base = NULL;
+	size = used = 0;
+	overflow = NULL;
+	overflowUsed = 0;
+	highWater = 0;
+	numHeapAllocs = 0;
+}
+
+/*
+================
+idArena::~idArena
+================
+*/
+idArena::~idArena( void ) {
+	Shutdown();
+}
+
+/*
+================
+idArena::Init
+================
+*/
+void idArena::Init( int blockSize ) {
+	Shutdown();
+
+	size = blockSize;
+	base = (byte *) Mem_Alloc( size );
+	numHeapAllocs++;
+}
+
+/*
+================
+idArena::Shutdown
+================
+*/
+void idArena::Shutdown( void ) {
+	while ( overflow ) {
+		block_t *next = overflow->next;
+		Mem_Free( overflow );
+		overflow = next;
+	}
+	Mem_Free( base );
+	base = NULL;
+	size = used = 0;
+	overflowUsed = 0;
+}
+
+/*
+================
+idArena::AllocOverflow
+
+The first block is full, allocate from the newest overflow block or add a new one.
+================
+*/
+void *idArena::AllocOverflow( int bytes, int align ) {
+	byte *data;
+	int offset;
+
+	if ( overflow ) {
+		data = (byte *)( overflow + 1 );
+		offset = (int)( ( ( (intptr_t)data + overflow->used + align - 1 ) & ~(intptr_t)( align - 1 ) ) - (intptr_t)data );
+		if ( offset + bytes <= overflow->size ) {
+			overflowUsed += offset + bytes - overflow->used;
+			overflow->used = offset + bytes;
+			return data + offset;
+		}
+	}
+
+	int blockSize = Max( Max( size, 4096 ), bytes + align );
+	block_t *block = (block_t *) Mem_Alloc( sizeof( block_t ) + blockSize );
+	numHeapAllocs++;
+	block->next = overflow;
+	block->size = blockSize;
+	block->used = 0;
+	overflow = block;
+
+	// the padding left in the previous block still counts as used
+	data = (byte *)( block + 1 );
+	offset = (int)( ( ( (intptr_t)data + align - 1 ) & ~(intptr_t)( align - 1 ) ) - (intptr_t)data );
+	block->used = offset + bytes;
+	overflowUsed += offset + bytes;
+	return data + offset;
+}
+
+/*
+================
+idArena::CopyString
+================
+*/
+char *idArena::CopyString( const char *text ) {
+	int l = strlen( text ) + 1;
+	char *out = (char *)Alloc( l, 1 );
+	memcpy( out, text, l );
+	return out;
+}
+
+/*
+================
+idArena::Printf
+================
+*/
+char *idArena::Printf( const char *fmt, ... ) {
+	va_list argptr;
+	char text[MAX_STRING_CHARS];
+
+	va_start( argptr, fmt );
+	idStr::vsnPrintf( text, sizeof( text ), fmt, argptr );
+	va_end( argptr );
+
+	return CopyString( text );
+}
+
+/*
+================
+idArena::Reset
+
+When the batch did not fit in the first block it is replaced with one that
+holds the largest batch seen so far with some slack, the overflow blocks are freed.
+================
+*/
+void idArena::Reset( void ) {
+	highWater = Max( highWater, used + overflowUsed );
+
+	if ( overflow ) {
+		while ( overflow ) {
+			block_t *next = overflow->next;
+			Mem_Free( overflow );
+			overflow = next;
+		}
+		Mem_Free( base );
+		size = ( highWater + ( highWater >> 2 ) + 4095 ) & ~4095;
+		base = (byte *) Mem_Alloc( size );
+		numHeapAllocs++;
+	}
+
+	used = 0;
+	overflowUsed = 0;
+}
+
+/*
+================
+idArenaPool::idArenaPool
+================
+*/
+idArenaPool::idArenaPool( void ) {
+	memset( inUse, 0, sizeof( inUse ) );
+}
+
+/*
+================
+idArenaPool::Get
+================
+*/
+idArena *idArenaPool::Get( void ) {
+	for ( int i = 0; i < MAX_POOLED_ARENAS; i++ ) {
+		if ( !inUse[i] ) {
+			if ( !arenas[i].IsInitialized() ) {
+				arenas[i].Init();
+			}
+			inUse[i] = true;
+			return &arenas[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+================
+idArenaPool::Release
+================
+*/
+void idArenaPool::Release( idArena *arena ) {
+	if ( !arena ) {
+		return;
+	}
+	assert( arena >= arenas && arena < arenas + MAX_POOLED_ARENAS );
+	arena->Reset();
+	inUse[arena - arenas] = false;
+}
+
+/*
+================
+idArenaPool::Shutdown
+================
+*/
+void idArenaPool::Shutdown( void ) {
+	for ( int i = 0; i < MAX_POOLED_ARENAS; i++ ) {
+		arenas[i].Shutdown();
+		inUse[i] = false;
+	}
+}
+
+/*
+================
+ArenaTestRequest
+
+Builds the temporaries a list request would, a server list and a text reply.
+Returns the number of times a buffer was allocated, each one a heap allocation
+unless the containers use an arena.
+================
+*/
+#define ARENA_TEST_SERVERS		64
+#define ARENA_TEST_BATCH		32
+
+static int ArenaTestRequest( idList<netadr_t> &list, idStr &text, int request ) {
+	int i, numAllocs;
+	const void *ptr;
+
+	numAllocs = 0;
+	for ( i = 0; i < ARENA_TEST_SERVERS; i++ ) {
+		ptr = list.Ptr();
+		netadr_t &adr = list.Alloc();
+		numAllocs += ( list.Ptr() != ptr );
+		adr = netadr_t();
+		adr.type = NA_IP;
+		adr.ip[0] = 10;
+		adr.ip[1] = request;
+		adr.ip[2] = i >> 8;
+		adr.ip[3] = i;
+		adr.port = 27666 + ( i & 3 );
+	}
+	text = "{\"servers\":[";
+	for ( i = 0; i < list.Num(); i++ ) {
+		ptr = text.c_str();
+		text += va( "%s\"%d.%d.%d.%d:%d\"", i ? "," : "", list[i].ip[0], list[i].ip[1], list[i].ip[2], list[i].ip[3], list[i].port );
+		numAllocs += ( text.c_str() != ptr );
+	}
+	text += "]}";
+	return numAllocs;
+}
+
+/*
+================
+idArena::Test_f
+
+Handles batches of simulated requests with heap and with arena temporaries.
+Once the arena has settled the arena requests must not touch the heap at all.
+================
+*/
+void idArena::Test_f( const idCmdArgs &args ) {
+	int numBatches = args.Argc() > 1 ? atoi( args.Argv( 1 ) ) : 1000;
+	int i, b, numRequests, bufferAllocs, heapAllocs, memAllocs;
+	double start, usec;
+	idArena *arena;
+
+	numBatches = Max( numBatches, 2 );
+	numRequests = ( numBatches - 1 ) * ARENA_TEST_BATCH;
+
+	idLib::common->Printf( "Testing %d batches of %d requests...\n", numBatches, ARENA_TEST_BATCH );
+
+	arena = arenaPool.Get();
+	if ( !arena ) {
+		idLib::common->Printf( "no free arena\n" );
+		return;
+	}
+
+	// heap temporaries, every buffer is a heap allocation
+	bufferAllocs = 0;
+	start = 0.0;
+	for ( b = 0; b < numBatches; b++ ) {
+		if ( b == 1 ) {
+			bufferAllocs = 0;
+			start = idLib::sys->GetMicroseconds();
+		}
+		for ( i = 0; i < ARENA_TEST_BATCH; i++ ) {
+			idList<netadr_t> list;
+			idStr text;
+			bufferAllocs += ArenaTestRequest( list, text, i );
+		}
+	}
+	usec = idLib::sys->GetMicroseconds() - start;
+	idLib::common->Printf( "heap:  %8.3f usec/request %6.2f heap allocs/request\n", usec / numRequests, (float)bufferAllocs / numRequests );
+
+	// arena temporaries, the first batch sizes the arena
+	heapAllocs = memAllocs = 0;
+	for ( b = 0; b < numBatches; b++ ) {
+		if ( b == 1 ) {
+			bufferAllocs = 0;
+			heapAllocs = arena->GetNumHeapAllocs();
+			memAllocs = Mem_GetAllocCount();
+			start = idLib::sys->GetMicroseconds();
+		}
+		for ( i = 0; i < ARENA_TEST_BATCH; i++ ) {
+			idList<netadr_t> list;
+			idArenaStr text( *arena );
+			list.SetArena( arena );
+			bufferAllocs += ArenaTestRequest( list, text, i );
+		}
+		arena->Reset();
+	}
+	usec = idLib::sys->GetMicroseconds() - start;
+	heapAllocs = arena->GetNumHeapAllocs() - heapAllocs + Mem_GetAllocCount() - memAllocs;
+	idLib::common->Printf( "arena: %8.3f usec/request %6.2f heap allocs/request (%.2f arena allocs/request, %d kB high water)\n",
+		usec / numRequests, (float)heapAllocs / numRequests, (float)bufferAllocs / numRequests, arena->GetHighWater() >> 10 );
+
+	arenaPool.Release( arena );
+
+	if ( heapAllocs ) {
+		idLib::common->Warning( "idArena: %d heap allocations after the first batch", heapAllocs );
+	}
+}
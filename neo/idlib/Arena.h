@@ -0,0 +1,165 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <new>
+
+#include "sys/platform.h"
+
+/*
+===============================================================================
+
+	Arena allocator.
+
+	Bump pointer allocation from one block of memory for temporaries that
+	all die at the same time, typically everything built while handling a
+	batch of packets. Nothing is freed individually, Reset releases all of it.
+	When the block runs out more blocks are taken from the heap, and the next
+	Reset replaces them with one block big enough for the whole batch, so a
+	steady load stops touching the heap after the first few batches.
+
+===============================================================================
+*/
+
+const int ARENA_BLOCK_SIZE		= 65536;
+
+class idArena {
+public:
+					idArena( void );
+					~idArena( void );
+
+	void			Init( int blockSize = ARENA_BLOCK_SIZE );	// allocates the first block
+	void			Shutdown( void );							// frees all memory
+	bool			IsInitialized( void ) const { return base != NULL; }
+
+	void *			Alloc( int bytes, int align = 8 );
+	char *			CopyString( const char *text );
+	char *			Printf( const char *fmt, ... ) id_attribute((format(printf,2,3)));	// like va() but not shared with other callers
+	template< class type >
+	type *			AllocArray( int num );						// default constructs num elements
+	template< class type >
+	void			DestroyArray( type *array, int num );		// runs the destructors, the memory is reclaimed by Reset
+
+	void			Reset( void );								// releases everything allocated since the last Reset
+
+	int				GetBytesUsed( void ) const { return used + overflowUsed; }
+	int				GetHighWater( void ) const { return highWater; }
+	int				GetBlockSize( void ) const { return size; }
+	int				GetNumHeapAllocs( void ) const { return numHeapAllocs; }
+
+	static void		Test_f( const class idCmdArgs &args );
+
+private:
+	struct block_t {
+		block_t *	next;
+		int			size;										// bytes following the header
+		int			used;
+	};
+
+	byte *			base;										// first block
+	int				size;
+	int				used;
+	block_t *		overflow;									// blocks added since the last Reset, newest first
+	int				overflowUsed;								// bytes taken from the overflow blocks including padding
+	int				highWater;									// most bytes used between two Resets
+	int				numHeapAllocs;								// blocks taken from the heap over the lifetime of the arena
+
+	void *			AllocOverflow( int bytes, int align );
+};
+
+ID_INLINE void *idArena::Alloc( int bytes, int align ) {
+	assert( bytes >= 0 && align > 0 && ( align & ( align - 1 ) ) == 0 );
+
+	if ( !overflow ) {
+		int offset = (int)( ( ( (intptr_t)base + used + align - 1 ) & ~(intptr_t)( align - 1 ) ) - (intptr_t)base );
+		if ( base && offset + bytes <= size ) {
+			used = offset + bytes;
+			return base + offset;
+		}
+	}
+	return AllocOverflow( bytes, align );
+}
+
+#ifdef ID_DEBUG_NEW
+#undef new
+#endif
+
+template< class type >
+ID_INLINE type *idArena::AllocArray( int num ) {
+	type *array = (type *)Alloc( num * sizeof( type ), 16 );
+	for ( int i = 0; i < num; i++ ) {
+		new ( &array[i] ) type;
+	}
+	return array;
+}
+
+#ifdef ID_DEBUG_NEW
+#define new ID_DEBUG_NEW
+#endif
+
+template< class type >
+ID_INLINE void idArena::DestroyArray( type *array, int num ) {
+	for ( int i = 0; i < num; i++ ) {
+		array[i].~type();
+	}
+}
+
+
+/*
+===============================================================================
+
+	Pool of arenas for request handlers.
+
+	A handler takes an arena at the start of a batch and releases it when
+	the batch is done, releasing resets it but keeps its memory for the next
+	user. Get returns NULL when every arena is in use, the containers then
+	fall back to the heap.
+
+===============================================================================
+*/
+
+const int MAX_POOLED_ARENAS		= 4;
+
+class idArenaPool {
+public:
+					idArenaPool( void );
+
+	idArena *		Get( void );
+	void			Release( idArena *arena );
+	void			Shutdown( void );
+
+private:
+	idArena			arenas[MAX_POOLED_ARENAS];
+	bool			inUse[MAX_POOLED_ARENAS];
+};
+
+extern idArenaPool	arenaPool;
+
+#endif /* !__ARENA_H__ */
@@ -28,6 +28,8 @@ If you have questions concerning this license or the applicable additional terms
 
 #include "sys/platform.h"
 
+#include "idlib/math/Random.h"
+
 #include "idlib/BitMsg.h"
 
 /*
@@ -100,6 +102,25 @@ byte *idBitMsg::GetByteSpace( int length ) {
 	return ptr;
 }
 
+/*
+================
+ValueOverflows
+
+  Returns true if the value does not fit in the given number of bits.
+  If the number of bits is negative a sign is included.
+================
+*/
+static ID_INLINE bool ValueOverflows( int value, int numBits ) {
+	if ( numBits == 32 ) {
+		return false;
+	}
+	if ( numBits > 0 ) {
+		return ( value > ( 1 << numBits ) - 1 || value < 0 );
+	}
+	int r = 1 << ( - 1 - numBits );
+	return ( value > r - 1 || value < -r );
+}
+
 /*
 ================
 idBitMsg::WriteBits
@@ -108,8 +129,49 @@ idBitMsg::WriteBits
 ================
 */
 void idBitMsg::WriteBits( int value, int numBits ) {
-	int		put;
-	int		fraction;
+	byte *	ptr;
+	int		pos, numBytes, bitPos;
+	unsigned long long bits;
+
+	// fast path for the common byte aligned 8, 16 and 32 bit fields
+	if ( writeBit == 0 && writeData ) {
+		switch( numBits ) {
+			case 8:
+			case -8:
+				if ( curSize + 1 > maxSize ) {
+					break;
+				}
+				if ( ValueOverflows( value, numBits ) ) {
+					idLib::common->Warning( "idBitMsg::WriteBits: value overflow %d %d", value, numBits );
+				}
+				writeData[curSize++] = (byte)value;
+				return;
+			case 16:
+			case -16:
+				if ( curSize + 2 > maxSize ) {
+					break;
+				}
+				if ( ValueOverflows( value, numBits ) ) {
+					idLib::common->Warning( "idBitMsg::WriteBits: value overflow %d %d", value, numBits );
+				}
+				ptr = writeData + curSize;
+				ptr[0] = (byte)value;
+				ptr[1] = (byte)( value >> 8 );
+				curSize += 2;
+				return;
+			case 32:
+				if ( curSize + 4 > maxSize ) {
+					break;
+				}
+				ptr = writeData + curSize;
+				ptr[0] = (byte)value;
+				ptr[1] = (byte)( value >> 8 );
+				ptr[2] = (byte)( value >> 16 );
+				ptr[3] = (byte)( value >> 24 );
+				curSize += 4;
+				return;
+		}
+	}
 
 	if ( !writeData ) {
 		idLib::common->Error( "idBitMsg::WriteBits: cannot write to message" );
@@ -122,21 +184,8 @@ void idBitMsg::WriteBits( int value, int numBits ) {
 
 	// check for value overflows
 	// this should be an error really, as it can go unnoticed and cause either bandwidth or corrupted data transmitted
-	if ( numBits != 32 ) {
-		if ( numBits > 0 ) {
-			if ( value > ( 1 << numBits ) - 1 ) {
-				idLib::common->Warning( "idBitMsg::WriteBits: value overflow %d %d", value, numBits );
-			} else if ( value < 0 ) {
-				idLib::common->Warning( "idBitMsg::WriteBits: value overflow %d %d", value, numBits );
-			}
-		} else {
-			int r = 1 << ( - 1 - numBits );
-			if ( value > r - 1 ) {
-				idLib::common->Warning( "idBitMsg::WriteBits: value overflow %d %d", value, numBits );
-			} else if ( value < -r ) {
-				idLib::common->Warning( "idBitMsg::WriteBits: value overflow %d %d", value, numBits );
-			}
-		}
+	if ( ValueOverflows( value, numBits ) ) {
+		idLib::common->Warning( "idBitMsg::WriteBits: value overflow %d %d", value, numBits );
 	}
 
 	if ( numBits < 0 ) {
@@ -148,22 +197,24 @@ void idBitMsg::WriteBits( int value, int numBits ) {
 		return;
 	}
 
-	// write the bits
-	while( numBits ) {
-		if ( writeBit == 0 ) {
-			writeData[curSize] = 0;
-			curSize++;
-		}
-		put = 8 - writeBit;
-		if ( put > numBits ) {
-			put = numBits;
-		}
-		fraction = value & ( ( 1 << put ) - 1 );
-		writeData[curSize - 1] |= fraction << writeBit;
-		numBits -= put;
-		value >>= put;
-		writeBit = ( writeBit + put ) & 7;
+	// shift the value into place in a 64 bit accumulator and store it a byte at a time,
+	// the first byte may already hold bits from the previous write
+	bits = ( (unsigned long long)(unsigned int)value & ( ( 1ULL << numBits ) - 1 ) ) << writeBit;
+	pos = writeBit ? curSize - 1 : curSize;
+	numBytes = ( writeBit + numBits + 7 ) >> 3;
+	ptr = writeData + pos;
+	if ( writeBit ) {
+		ptr[0] |= (byte)bits;
+	} else {
+		ptr[0] = (byte)bits;
+	}
+	for ( int i = 1; i < numBytes; i++ ) {
+		ptr[i] = (byte)( bits >> ( i << 3 ) );
 	}
+
+	bitPos = ( pos << 3 ) + writeBit + numBits;
+	curSize = ( bitPos + 7 ) >> 3;
+	writeBit = bitPos & 7;
 }
 
 /*
@@ -360,11 +411,48 @@ idBitMsg::ReadBits
 ================
 */
 int idBitMsg::ReadBits( int numBits ) const {
+	const byte *ptr;
 	int		value;
-	int		valueBits;
-	int		get;
-	int		fraction;
+	int		pos, numBytes, bitPos;
 	bool	sgn;
+	unsigned long long bits;
+
+	// fast path for the common byte aligned 8, 16 and 32 bit fields
+	if ( readBit == 0 ) {
+		ptr = readData + readCount;
+		switch( numBits ) {
+			case 8:
+				if ( readCount + 1 > curSize ) {
+					break;
+				}
+				readCount++;
+				return ptr[0];
+			case -8:
+				if ( readCount + 1 > curSize ) {
+					break;
+				}
+				readCount++;
+				return (signed char)ptr[0];
+			case 16:
+				if ( readCount + 2 > curSize ) {
+					break;
+				}
+				readCount += 2;
+				return ptr[0] | ( ptr[1] << 8 );
+			case -16:
+				if ( readCount + 2 > curSize ) {
+					break;
+				}
+				readCount += 2;
+				return (short)( ptr[0] | ( ptr[1] << 8 ) );
+			case 32:
+				if ( readCount + 4 > curSize ) {
+					break;
+				}
+				readCount += 4;
+				return (int)( ptr[0] | ( ptr[1] << 8 ) | ( ptr[2] << 16 ) | ( (unsigned int)ptr[3] << 24 ) );
+		}
+	}
 
 	if ( !readData ) {
 		idLib::common->FatalError( "idBitMsg::ReadBits: cannot read from message" );
@@ -375,9 +463,6 @@ int idBitMsg::ReadBits( int numBits ) const {
 		idLib::common->FatalError( "idBitMsg::ReadBits: bad numBits %i", numBits );
 	}
 
-	value = 0;
-	valueBits = 0;
-
 	if ( numBits < 0 ) {
 		numBits = -numBits;
 		sgn = true;
@@ -390,22 +475,20 @@ int idBitMsg::ReadBits( int numBits ) const {
 		return -1;
 	}
 
-	while ( valueBits < numBits ) {
-		if ( readBit == 0 ) {
-			readCount++;
-		}
-		get = 8 - readBit;
-		if ( get > (numBits - valueBits) ) {
-			get = numBits - valueBits;
-		}
-		fraction = readData[readCount - 1];
-		fraction >>= readBit;
-		fraction &= ( 1 << get ) - 1;
-		value |= fraction << valueBits;
-
-		valueBits += get;
-		readBit = ( readBit + get ) & 7;
+	// gather the bytes holding the value into a 64 bit accumulator and shift it out,
+	// the first byte may be partially read already
+	pos = readBit ? readCount - 1 : readCount;
+	numBytes = ( readBit + numBits + 7 ) >> 3;
+	ptr = readData + pos;
+	bits = 0;
+	for ( int i = 0; i < numBytes; i++ ) {
+		bits |= (unsigned long long)ptr[i] << ( i << 3 );
 	}
+	value = (int)( ( bits >> readBit ) & ( ( 1ULL << numBits ) - 1 ) );
+
+	bitPos = ( pos << 3 ) + readBit + numBits;
+	readCount = ( bitPos + 7 ) >> 3;
+	readBit = bitPos & 7;
 
 	if ( sgn ) {
 		if ( value & ( 1 << ( numBits - 1 ) ) ) {
@@ -1065,3 +1148,225 @@ int idBitMsgDelta::ReadDeltaIntCounter( int oldValue ) const {
 	}
 	return value;
 }
+
+
+//===============================================================
+//
+// Test code
+//
+//===============================================================
+
+#define BITMSG_TEST_COUNT		1024		// fields per message
+#define BITMSG_TEST_NUMTESTS	256			// number of tests
+
+#define BITMSG_TEST_SEED		1013904223L
+
+/*
+================
+RefWriteBits
+
+  Byte fragment at a time reference implementation the fast paths are compared against.
+================
+*/
+static void RefWriteBits( byte *data, int &curSize, int &writeBit, int value, int numBits ) {
+	int put, fraction;
+
+	if ( numBits < 0 ) {
+		numBits = -numBits;
+	}
+	while( numBits ) {
+		if ( writeBit == 0 ) {
+			data[curSize] = 0;
+			curSize++;
+		}
+		put = 8 - writeBit;
+		if ( put > numBits ) {
+			put = numBits;
+		}
+		fraction = value & ( ( 1 << put ) - 1 );
+		data[curSize - 1] |= fraction << writeBit;
+		numBits -= put;
+		value >>= put;
+		writeBit = ( writeBit + put ) & 7;
+	}
+}
+
+/*
+================
+RefReadBits
+================
+*/
+static int RefReadBits( const byte *data, int &readCount, int &readBit, int numBits ) {
+	int value, valueBits, get, fraction;
+	bool sgn;
+
+	value = 0;
+	valueBits = 0;
+	sgn = ( numBits < 0 );
+	if ( sgn ) {
+		numBits = -numBits;
+	}
+	while ( valueBits < numBits ) {
+		if ( readBit == 0 ) {
+			readCount++;
+		}
+		get = 8 - readBit;
+		if ( get > ( numBits - valueBits ) ) {
+			get = numBits - valueBits;
+		}
+		fraction = data[readCount - 1];
+		fraction >>= readBit;
+		fraction &= ( 1 << get ) - 1;
+		value |= fraction << valueBits;
+		valueBits += get;
+		readBit = ( readBit + get ) & 7;
+	}
+	if ( sgn && ( value & ( 1 << ( numBits - 1 ) ) ) ) {
+		value |= -1 ^ ( ( 1 << numBits ) - 1 );
+	}
+	return value;
+}
+
+/*
+================
+PrintBitMsgTime
+================
+*/
+static void PrintBitMsgTime( const char *string, int dataCount, double usec, double otherUsec = 0.0 ) {
+	int i;
+
+	idLib::common->Printf( "%s", string );
+	for ( i = idStr::LengthWithoutColors( string ); i < 48; i++ ) {
+		idLib::common->Printf( " " );
+	}
+	if ( otherUsec > 0.0 ) {
+		int p = (int) ( ( otherUsec - usec ) * 100.0 / otherUsec );
+		idLib::common->Printf( "c = %4d, usec = %8.2f, %d%%\n", dataCount, usec, p );
+	} else {
+		idLib::common->Printf( "c = %4d, usec = %8.2f\n", dataCount, usec );
+	}
+}
+
+/*
+================
+TestBitMsgShape
+================
+*/
+static void TestBitMsgShape( const char *name, const int *shape, int shapeSize ) {
+	static byte	refBuf[BITMSG_TEST_COUNT * 4 + 4];
+	static byte	msgBuf[BITMSG_TEST_COUNT * 4 + 4];
+	int			numBits[BITMSG_TEST_COUNT];
+	int			values[BITMSG_TEST_COUNT];
+	int			i, t, curSize, writeBit, readCount, readBit, sum;
+	double		start, bestRef, bestFast;
+	idBitMsg	msg;
+	idRandom	srnd( BITMSG_TEST_SEED );
+	const char	*result;
+
+	for ( i = 0; i < BITMSG_TEST_COUNT; i++ ) {
+		int bits = shape[i % shapeSize];
+		int absBits = bits < 0 ? -bits : bits;
+		numBits[i] = bits;
+		values[i] = srnd.RandomInt() ^ ( srnd.RandomInt() << 15 );
+		if ( absBits < 32 ) {
+			values[i] &= ( 1 << absBits ) - 1;
+			if ( bits < 0 && ( values[i] & ( 1 << ( absBits - 1 ) ) ) ) {
+				values[i] |= -1 ^ ( ( 1 << absBits ) - 1 );
+			}
+		}
+	}
+
+	msg.Init( msgBuf, sizeof( msgBuf ) );
+
+	// write
+	bestRef = 0.0;
+	for ( t = 0; t < BITMSG_TEST_NUMTESTS; t++ ) {
+		curSize = writeBit = 0;
+		start = idLib::sys->GetMicroseconds();
+		for ( i = 0; i < BITMSG_TEST_COUNT; i++ ) {
+			RefWriteBits( refBuf, curSize, writeBit, values[i], numBits[i] );
+		}
+		double usec = idLib::sys->GetMicroseconds() - start;
+		if ( !bestRef || usec < bestRef ) {
+			bestRef = usec;
+		}
+	}
+	PrintBitMsgTime( va( "generic->WriteBits( %s )", name ), BITMSG_TEST_COUNT, bestRef );
+
+	bestFast = 0.0;
+	for ( t = 0; t < BITMSG_TEST_NUMTESTS; t++ ) {
+		msg.BeginWriting();
+		start = idLib::sys->GetMicroseconds();
+		for ( i = 0; i < BITMSG_TEST_COUNT; i++ ) {
+			msg.WriteBits( values[i], numBits[i] );
+		}
+		double usec = idLib::sys->GetMicroseconds() - start;
+		if ( !bestFast || usec < bestFast ) {
+			bestFast = usec;
+		}
+	}
+	result = ( msg.GetSize() == curSize && memcmp( msgBuf, refBuf, curSize ) == 0 ) ? "ok" : S_COLOR_RED"X";
+	PrintBitMsgTime( va( "   fast->WriteBits( %s ) %s", name, result ), BITMSG_TEST_COUNT, bestFast, bestRef );
+
+	// read
+	sum = 0;
+	bestRef = 0.0;
+	for ( t = 0; t < BITMSG_TEST_NUMTESTS; t++ ) {
+		readCount = readBit = 0;
+		start = idLib::sys->GetMicroseconds();
+		for ( i = 0; i < BITMSG_TEST_COUNT; i++ ) {
+			sum += RefReadBits( refBuf, readCount, readBit, numBits[i] );
+		}
+		double usec = idLib::sys->GetMicroseconds() - start;
+		if ( !bestRef || usec < bestRef ) {
+			bestRef = usec;
+		}
+	}
+	PrintBitMsgTime( va( "generic->ReadBits( %s )", name ), BITMSG_TEST_COUNT, bestRef );
+
+	result = "ok";
+	bestFast = 0.0;
+	for ( t = 0; t < BITMSG_TEST_NUMTESTS; t++ ) {
+		msg.BeginReading();
+		start = idLib::sys->GetMicroseconds();
+		for ( i = 0; i < BITMSG_TEST_COUNT; i++ ) {
+			sum += msg.ReadBits( numBits[i] );
+		}
+		double usec = idLib::sys->GetMicroseconds() - start;
+		if ( !bestFast || usec < bestFast ) {
+			bestFast = usec;
+		}
+	}
+	msg.BeginReading();
+	for ( i = 0; i < BITMSG_TEST_COUNT; i++ ) {
+		if ( msg.ReadBits( numBits[i] ) != values[i] ) {
+			result = S_COLOR_RED"X";
+			break;
+		}
+	}
+	PrintBitMsgTime( va( "   fast->ReadBits( %s ) %s", name, result ), BITMSG_TEST_COUNT, bestFast, bestRef );
+
+	// keep the reads from being optimized away
+	if ( sum == 0x7fffffff ) {
+		idLib::common->Printf( "\n" );
+	}
+}
+
+/*
+================
+idBitMsg::Test_f
+================
+*/
+void idBitMsg::Test_f( const idCmdArgs &args ) {
+	// master server list entry: ip bytes followed by the port
+	static const int serverList[] = { 8, 8, 8, 8, 16 };
+	// idMsgChannel style header: id, sequence, fragment info
+	static const int channelHeader[] = { -16, 32, -16, 16 };
+	// delta compressed game state: flags and small quantized values
+	static const int unaligned[] = { 1, 3, -7, 11, 1, -16, 5, 32, 2 };
+
+	idLib::common->Printf( "Testing idBitMsg...\n" );
+	TestBitMsgShape( "server list", serverList, sizeof( serverList ) / sizeof( serverList[0] ) );
+	TestBitMsgShape( "channel header", channelHeader, sizeof( channelHeader ) / sizeof( channelHeader[0] ) );
+	TestBitMsgShape( "unaligned", unaligned, sizeof( unaligned ) / sizeof( unaligned[0] ) );
+}
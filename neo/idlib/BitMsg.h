@@ -137,6 +137,8 @@ public:
 	static int		DirToBits( const idVec3 &dir, int numBits );
 	static idVec3	BitsToDir( int bits, int numBits );
 
+	static void		Test_f( const class idCmdArgs &args );
+
 private:
 	byte *			writeData;			// pointer to data for writing
 	const byte *	readData;			// pointer to data for reading
@@ -432,6 +434,159 @@ ID_INLINE float idBitMsg::ReadDeltaFloat( float oldValue, int exponentBits, int
 }
 
 
+/*
+===============================================================================
+
+  idMsgView
+
+  Read-only, byte aligned view of a received message.
+  Reads straight from the buffer it was initialized with, nothing is copied.
+  Reading past the end marks the view as overflowed and returns -1 / NULL.
+  The buffer must be followed by at least one zero byte so strings that run
+  up to the end of the message stay terminated.
+
+===============================================================================
+*/
+
+class idMsgView {
+public:
+					idMsgView() { Init( NULL, 0 ); }
+					idMsgView( const byte *data, int size ) { Init( data, size ); }
+
+	void			Init( const byte *data, int size );
+	const byte *	GetData( void ) const { return data; }
+	int				GetSize( void ) const { return size; }
+	bool			IsOverflowed( void ) const { return overflowed; }
+
+	void			BeginReading( void ) const;
+	int				GetReadCount( void ) const { return readCount; }
+	int				GetRemainingData( void ) const { return size - readCount; }
+	const byte *	GetReadPointer( void ) const { return data + readCount; }
+	void			SkipBytes( int length ) const;
+
+	int				ReadChar( void ) const;
+	int				ReadByte( void ) const;
+	int				ReadShort( void ) const;
+	int				ReadUShort( void ) const;
+	int				ReadInt( void ) const;
+	const char *	ReadString( int *length = NULL ) const;	// points into the message, NULL on overflow
+	const byte *	ReadData( int length ) const;			// points into the message, NULL on overflow
+
+private:
+	const byte *	data;
+	int				size;
+	mutable int		readCount;
+	mutable bool	overflowed;
+
+	bool			CheckRead( int length ) const;
+};
+
+ID_INLINE void idMsgView::Init( const byte *data, int size ) {
+	this->data = data;
+	this->size = size;
+	readCount = 0;
+	overflowed = false;
+}
+
+ID_INLINE void idMsgView::BeginReading( void ) const {
+	readCount = 0;
+	overflowed = false;
+}
+
+ID_INLINE bool idMsgView::CheckRead( int length ) const {
+	if ( length > size - readCount ) {
+		readCount = size;
+		overflowed = true;
+		return false;
+	}
+	return true;
+}
+
+ID_INLINE void idMsgView::SkipBytes( int length ) const {
+	if ( CheckRead( length ) ) {
+		readCount += length;
+	}
+}
+
+ID_INLINE int idMsgView::ReadChar( void ) const {
+	if ( !CheckRead( 1 ) ) {
+		return -1;
+	}
+	return (signed char)data[readCount++];
+}
+
+ID_INLINE int idMsgView::ReadByte( void ) const {
+	if ( !CheckRead( 1 ) ) {
+		return -1;
+	}
+	return data[readCount++];
+}
+
+// multi-byte values are little endian on the wire, same as idBitMsg::WriteBits produces when byte aligned
+ID_INLINE int idMsgView::ReadShort( void ) const {
+	if ( !CheckRead( 2 ) ) {
+		return -1;
+	}
+	const byte *p = data + readCount;
+	readCount += 2;
+	return (short)( p[0] | ( p[1] << 8 ) );
+}
+
+ID_INLINE int idMsgView::ReadUShort( void ) const {
+	if ( !CheckRead( 2 ) ) {
+		return -1;
+	}
+	const byte *p = data + readCount;
+	readCount += 2;
+	return p[0] | ( p[1] << 8 );
+}
+
+ID_INLINE int idMsgView::ReadInt( void ) const {
+	if ( !CheckRead( 4 ) ) {
+		return -1;
+	}
+	const byte *p = data + readCount;
+	readCount += 4;
+	return (int)( p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (unsigned int)p[3] << 24 ) );
+}
+
+ID_INLINE const char *idMsgView::ReadString( int *length ) const {
+	const char *s;
+	const byte *end;
+	int l;
+
+	if ( readCount >= size ) {
+		overflowed = true;
+		if ( length ) {
+			*length = 0;
+		}
+		return NULL;
+	}
+	s = reinterpret_cast<const char *>( data + readCount );
+	end = static_cast<const byte *>( memchr( s, 0, size - readCount ) );
+	if ( end ) {
+		l = end - ( data + readCount );
+		readCount += l + 1;
+	} else {
+		// unterminated, the string runs up to the zero byte after the message
+		l = size - readCount;
+		readCount = size;
+	}
+	if ( length ) {
+		*length = l;
+	}
+	return s;
+}
+
+ID_INLINE const byte *idMsgView::ReadData( int length ) const {
+	if ( length < 0 || !CheckRead( length ) ) {
+		return NULL;
+	}
+	const byte *p = data + readCount;
+	readCount += length;
+	return p;
+}
+
 /*
 ===============================================================================
 
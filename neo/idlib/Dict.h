@@ -72,6 +72,9 @@ class idDict {
 public:
 						idDict( void );
 						idDict( const idDict &other );	// allow declaration with assignment
+#ifdef ID_MOVE_SEMANTICS
+						idDict( idDict &&other );
+#endif
 						~idDict( void );
 
 						// set the granularity for the index
@@ -80,6 +83,10 @@ public:
 	void				SetHashSize( int hashSize );
 						// clear existing key/value pairs and copy all key/value pairs from other
 	idDict &			operator=( const idDict &other );
+#ifdef ID_MOVE_SEMANTICS
+						// clear existing key/value pairs and take over the key/value pairs of other without copying
+	idDict &			operator=( idDict &&other );
+#endif
 						// copy from other while leaving existing key/value pairs in place
 	void				Copy( const idDict &other );
 						// clear existing key/value pairs and transfer key/value pairs from other
@@ -176,6 +183,22 @@ ID_INLINE idDict::idDict( const idDict &other ) {
 	*this = other;
 }
 
+#ifdef ID_MOVE_SEMANTICS
+ID_INLINE idDict::idDict( idDict &&other ) :
+	args( idMove( other.args ) ),
+	argHash( idMove( other.argHash ) ) {
+}
+
+ID_INLINE idDict &idDict::operator=( idDict &&other ) {
+	if ( this != &other ) {
+		Clear();
+		args = idMove( other.args );
+		argHash = idMove( other.argHash );
+	}
+	return *this;
+}
+#endif
+
 ID_INLINE idDict::~idDict( void ) {
 	Clear();
 }
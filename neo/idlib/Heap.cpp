@@ -27,10 +27,15 @@ If you have questions concerning this license or the applicable additional terms
 */
 
 #include "sys/platform.h"
+#include "idlib/math/Random.h"
 #include "framework/Common.h"
 
 #include "idlib/Heap.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #ifndef USE_LIBC_MALLOC
 	#define USE_LIBC_MALLOC		0
 #endif
@@ -977,6 +982,448 @@ void idHeap::LargeFree( void *ptr) {
 	FreePage(pg);
 }
 
+//===============================================================
+//
+//	idThreadHeap
+//
+//	Allocations up to TC_MAX_SIZE bytes are rounded up to one of a
+//	fixed set of size classes and served from a free list owned by the
+//	calling thread. Threads exchange blocks with the shared central
+//	lists in batches, so the central lock is taken once per batch
+//	rather than once per allocation. Blocks may be freed by any thread.
+//
+//===============================================================
+
+#ifndef USE_THREAD_CACHE
+	#define USE_THREAD_CACHE	!USE_LIBC_MALLOC
+#endif
+
+#define TC_ALLOC				0xee			// tag byte in front of every thread cache allocation
+#define TC_INVALID_ALLOC		0xdd
+#define TC_HEADER_SIZE			8				// keeps the data 8 byte aligned, class and tag in the last two bytes
+#define TC_MAX_SIZE				1024
+#define TC_NUM_CLASSES			28
+#define TC_SPAN_SIZE			65536			// central lists grow by one span at a time
+#define TC_SPAN_HEADER_SIZE		16
+#define TC_BATCH_BYTES			8192			// approximate number of bytes moved per batch
+
+/*
+================
+Mem_Lock
+================
+*/
+ID_INLINE void Mem_Lock( volatile long &lock ) {
+#ifdef _MSC_VER
+	while ( _InterlockedExchange( &lock, 1 ) ) {
+		while ( lock ) {
+		}
+	}
+#else
+	while ( __sync_lock_test_and_set( &lock, 1 ) ) {
+		while ( lock ) {
+		}
+	}
+#endif
+}
+
+/*
+================
+Mem_Unlock
+================
+*/
+ID_INLINE void Mem_Unlock( volatile long &lock ) {
+#ifdef _MSC_VER
+	_InterlockedExchange( &lock, 0 );
+#else
+	__sync_lock_release( &lock );
+#endif
+}
+
+typedef struct tcBlock_s {
+	struct tcBlock_s *		next;
+} tcBlock_t;
+
+typedef struct tcSpan_s {						// stored in the first TC_SPAN_HEADER_SIZE bytes of a span
+	struct tcSpan_s *		next;
+} tcSpan_t;
+
+typedef struct {
+	tcBlock_t *				free;				// blocks cached by this thread
+	int						count;				// number of blocks in the free list
+	int						allocs;				// allocations made by this thread
+	int						frees;				// frees made by this thread
+} tcThreadClass_t;
+
+typedef struct tcThreadCache_s {
+	tcThreadClass_t			classes[TC_NUM_CLASSES];
+	struct tcThreadCache_s *next;
+} tcThreadCache_t;
+
+typedef struct {
+	volatile long			lock;
+	tcBlock_t *				free;				// blocks not owned by any thread
+	int						count;
+	tcSpan_t *				spans;				// all spans carved for this class
+	int						numSpans;
+	int						retiredAllocs;		// counts of threads that released their cache
+	int						retiredFrees;
+} tcCentralClass_t;
+
+class idThreadHeap {
+public:
+					idThreadHeap( void );
+
+	void			Init( void );
+	void			Shutdown( void );						// frees all spans, outstanding blocks become invalid
+	bool			IsInitialized( void ) const { return initialized; }
+
+	void *			Allocate( const int bytes );			// bytes must be in the range [1, TC_MAX_SIZE]
+	void			Free( void *p );
+	int				Msize( void *p ) const { return classSizes[((byte *)(p))[-2]]; }
+	void			ReleaseCache( void );					// returns the blocks cached by the calling thread
+
+	void			GetClassStats( int classNum, int &allocs, int &frees, int &cached, int &spans );
+	void			GetTotals( int &num, int &bytes, int &numAllocs );
+
+	static int		ClassSize( int classNum ) { return classSizes[classNum]; }
+
+private:
+	bool			initialized;
+	int				generation;								// invalidates thread caches of a previous Init
+	volatile long	cacheLock;
+	tcThreadCache_t *caches;								// all thread caches, for statistics and Shutdown
+	tcCentralClass_t central[TC_NUM_CLASSES];
+	byte			sizeToClass[TC_MAX_SIZE / 8 + 1];
+
+	static const int classSizes[TC_NUM_CLASSES];
+
+	tcThreadCache_t *GetCache( void );
+	void			FetchBatch( int classNum, tcThreadClass_t &tc );
+	void			ReleaseBatch( int classNum, tcThreadClass_t &tc, int num );
+	void			AllocateSpan( int classNum );
+	static int		BatchSize( int classNum );
+};
+
+const int idThreadHeap::classSizes[TC_NUM_CLASSES] = {
+	8, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, 120, 128,
+	160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024
+};
+
+static ID_THREAD_LOCAL tcThreadCache_t *	tc_threadCache;
+static ID_THREAD_LOCAL int					tc_threadGeneration;
+
+/*
+================
+idThreadHeap::idThreadHeap
+================
+*/
+idThreadHeap::idThreadHeap( void ) {
+	initialized = false;
+	generation = 0;
+	cacheLock = 0;
+	caches = NULL;
+	memset( central, 0, sizeof( central ) );
+}
+
+/*
+================
+idThreadHeap::Init
+================
+*/
+void idThreadHeap::Init( void ) {
+	int i, c;
+
+	assert( !initialized );
+
+	for ( c = i = 0; i <= TC_MAX_SIZE / 8; i++ ) {
+		while ( classSizes[c] < i * 8 ) {
+			c++;
+		}
+		sizeToClass[i] = c;
+	}
+	memset( central, 0, sizeof( central ) );
+	caches = NULL;
+	cacheLock = 0;
+	generation++;
+	initialized = true;
+}
+
+/*
+================
+idThreadHeap::Shutdown
+================
+*/
+void idThreadHeap::Shutdown( void ) {
+	int i;
+
+	if ( !initialized ) {
+		return;
+	}
+	initialized = false;
+
+	while ( caches ) {
+		tcThreadCache_t *next = caches->next;
+		free( caches );
+		caches = next;
+	}
+	for ( i = 0; i < TC_NUM_CLASSES; i++ ) {
+		while ( central[i].spans ) {
+			tcSpan_t *next = central[i].spans->next;
+			free( central[i].spans );
+			central[i].spans = next;
+		}
+	}
+	memset( central, 0, sizeof( central ) );
+}
+
+/*
+================
+idThreadHeap::BatchSize
+================
+*/
+int idThreadHeap::BatchSize( int classNum ) {
+	return idMath::ClampInt( 4, 64, TC_BATCH_BYTES / classSizes[classNum] );
+}
+
+/*
+================
+idThreadHeap::GetCache
+================
+*/
+tcThreadCache_t *idThreadHeap::GetCache( void ) {
+	tcThreadCache_t *cache = tc_threadCache;
+
+	if ( cache && tc_threadGeneration == generation ) {
+		return cache;
+	}
+
+	cache = (tcThreadCache_t *) calloc( 1, sizeof( tcThreadCache_t ) );
+	if ( !cache ) {
+		idLib::common->FatalError( "malloc failure for %i", (int)sizeof( tcThreadCache_t ) );
+	}
+
+	Mem_Lock( cacheLock );
+	cache->next = caches;
+	caches = cache;
+	Mem_Unlock( cacheLock );
+
+	tc_threadCache = cache;
+	tc_threadGeneration = generation;
+	return cache;
+}
+
+/*
+================
+idThreadHeap::AllocateSpan
+
+  central lock must be held
+================
+*/
+void idThreadHeap::AllocateSpan( int classNum ) {
+	tcCentralClass_t &cc = central[classNum];
+	int blockSize = TC_HEADER_SIZE + classSizes[classNum];
+
+	tcSpan_t *span = (tcSpan_t *) malloc( TC_SPAN_SIZE );
+	if ( !span ) {
+		idLib::common->FatalError( "malloc failure for %i", TC_SPAN_SIZE );
+	}
+	span->next = cc.spans;
+	cc.spans = span;
+	cc.numSpans++;
+
+	for ( int offset = TC_SPAN_HEADER_SIZE; offset + blockSize <= TC_SPAN_SIZE; offset += blockSize ) {
+		byte *p = (byte *)span + offset + TC_HEADER_SIZE;
+		p[-2] = classNum;
+		p[-1] = TC_INVALID_ALLOC;
+		tcBlock_t *block = (tcBlock_t *)p;
+		block->next = cc.free;
+		cc.free = block;
+		cc.count++;
+	}
+}
+
+/*
+================
+idThreadHeap::FetchBatch
+================
+*/
+void idThreadHeap::FetchBatch( int classNum, tcThreadClass_t &tc ) {
+	tcCentralClass_t &cc = central[classNum];
+	int num = BatchSize( classNum );
+
+	Mem_Lock( cc.lock );
+	if ( cc.count < num ) {
+		AllocateSpan( classNum );
+	}
+	tcBlock_t *first = cc.free;
+	tcBlock_t *last = first;
+	for ( int i = 1; i < num; i++ ) {
+		last = last->next;
+	}
+	cc.free = last->next;
+	cc.count -= num;
+	Mem_Unlock( cc.lock );
+
+	last->next = tc.free;
+	tc.free = first;
+	tc.count += num;
+}
+
+/*
+================
+idThreadHeap::ReleaseBatch
+================
+*/
+void idThreadHeap::ReleaseBatch( int classNum, tcThreadClass_t &tc, int num ) {
+	tcCentralClass_t &cc = central[classNum];
+
+	if ( num <= 0 ) {
+		return;
+	}
+
+	tcBlock_t *first = tc.free;
+	tcBlock_t *last = first;
+	for ( int i = 1; i < num; i++ ) {
+		last = last->next;
+	}
+	tc.free = last->next;
+	tc.count -= num;
+
+	Mem_Lock( cc.lock );
+	last->next = cc.free;
+	cc.free = first;
+	cc.count += num;
+	Mem_Unlock( cc.lock );
+}
+
+/*
+================
+idThreadHeap::Allocate
+================
+*/
+void *idThreadHeap::Allocate( const int bytes ) {
+	int classNum = sizeToClass[( bytes + 7 ) >> 3];
+	tcThreadClass_t &tc = GetCache()->classes[classNum];
+
+	if ( !tc.free ) {
+		FetchBatch( classNum, tc );
+	}
+	tcBlock_t *block = tc.free;
+	tc.free = block->next;
+	tc.count--;
+	tc.allocs++;
+
+	((byte *)block)[-1] = TC_ALLOC;
+	return block;
+}
+
+/*
+================
+idThreadHeap::Free
+================
+*/
+void idThreadHeap::Free( void *p ) {
+	int classNum = ((byte *)(p))[-2];
+	tcThreadClass_t &tc = GetCache()->classes[classNum];
+
+	((byte *)(p))[-1] = TC_INVALID_ALLOC;
+
+	tcBlock_t *block = (tcBlock_t *)p;
+	block->next = tc.free;
+	tc.free = block;
+	tc.count++;
+	tc.frees++;
+
+	// hand half of an overfull cache back so blocks freed by a consumer thread flow back to the producer
+	int num = BatchSize( classNum );
+	if ( tc.count > 2 * num ) {
+		ReleaseBatch( classNum, tc, num );
+	}
+}
+
+/*
+================
+idThreadHeap::ReleaseCache
+================
+*/
+void idThreadHeap::ReleaseCache( void ) {
+	tcThreadCache_t *cache = tc_threadCache;
+
+	if ( !cache || tc_threadGeneration != generation ) {
+		return;
+	}
+
+	Mem_Lock( cacheLock );
+	tcThreadCache_t **link;
+	for ( link = &caches; *link && *link != cache; link = &(*link)->next ) {
+	}
+	if ( *link ) {
+		*link = cache->next;
+	}
+	Mem_Unlock( cacheLock );
+
+	for ( int i = 0; i < TC_NUM_CLASSES; i++ ) {
+		tcThreadClass_t &tc = cache->classes[i];
+		ReleaseBatch( i, tc, tc.count );
+
+		Mem_Lock( central[i].lock );
+		central[i].retiredAllocs += tc.allocs;
+		central[i].retiredFrees += tc.frees;
+		Mem_Unlock( central[i].lock );
+	}
+
+	free( cache );
+	tc_threadCache = NULL;
+}
+
+/*
+================
+idThreadHeap::GetClassStats
+
+  the per thread counters are read without synchronization, the result is approximate while other threads allocate
+================
+*/
+void idThreadHeap::GetClassStats( int classNum, int &allocs, int &frees, int &cached, int &spans ) {
+	tcCentralClass_t &cc = central[classNum];
+
+	Mem_Lock( cc.lock );
+	allocs = cc.retiredAllocs;
+	frees = cc.retiredFrees;
+	cached = cc.count;
+	spans = cc.numSpans;
+	Mem_Unlock( cc.lock );
+
+	Mem_Lock( cacheLock );
+	for ( tcThreadCache_t *cache = caches; cache; cache = cache->next ) {
+		allocs += cache->classes[classNum].allocs;
+		frees += cache->classes[classNum].frees;
+		cached += cache->classes[classNum].count;
+	}
+	Mem_Unlock( cacheLock );
+}
+
+/*
+================
+idThreadHeap::GetTotals
+================
+*/
+void idThreadHeap::GetTotals( int &num, int &bytes, int &numAllocs ) {
+	int allocs, frees, cached, spans;
+
+	num = bytes = numAllocs = 0;
+	if ( !initialized ) {
+		return;
+	}
+	for ( int i = 0; i < TC_NUM_CLASSES; i++ ) {
+		GetClassStats( i, allocs, frees, cached, spans );
+		num += allocs - frees;
+		bytes += ( allocs - frees ) * classSizes[i];
+		numAllocs += allocs;
+	}
+}
+
+static idThreadHeap		mem_threadHeap;
+
 //===============================================================
 //
 //	memory allocation all in one place
@@ -986,6 +1433,8 @@ void idHeap::LargeFree( void *ptr) {
 #undef new
 
 static idHeap *			mem_heap = NULL;
+static volatile long	mem_heapLock = 0;		// serializes the idHeap path, the thread cache has its own locks
+static int				mem_heapAllocCount = 0;	// allocations made through the idHeap path
 static memoryStats_t	mem_total_allocs = { 0, 0x0fffffff, -1, 0 };
 static memoryStats_t	mem_frame_allocs;
 static memoryStats_t	mem_frame_frees;
@@ -1018,7 +1467,24 @@ Mem_GetStats
 ==================
 */
 void Mem_GetStats( memoryStats_t &stats ) {
+	int num, bytes, numAllocs;
+
 	stats = mem_total_allocs;
+	mem_threadHeap.GetTotals( num, bytes, numAllocs );
+	stats.num += num;
+	stats.totalSize += bytes;
+}
+
+/*
+==================
+Mem_GetAllocCount
+==================
+*/
+int Mem_GetAllocCount( void ) {
+	int num, bytes, numAllocs;
+
+	mem_threadHeap.GetTotals( num, bytes, numAllocs );
+	return mem_heapAllocCount + numAllocs;
 }
 
 /*
@@ -1076,8 +1542,16 @@ void *Mem_Alloc( const int size ) {
 #endif
 		return malloc( size );
 	}
+#if USE_THREAD_CACHE
+	if ( (unsigned int)size <= TC_MAX_SIZE ) {
+		return mem_threadHeap.Allocate( size );
+	}
+#endif
+	Mem_Lock( mem_heapLock );
 	void *mem = mem_heap->Allocate( size );
 	Mem_UpdateAllocStats( mem_heap->Msize( mem ) );
+	mem_heapAllocCount++;
+	Mem_Unlock( mem_heapLock );
 	return mem;
 }
 
@@ -1097,8 +1571,16 @@ void Mem_Free( void *ptr ) {
 		free( ptr );
 		return;
 	}
+#if USE_THREAD_CACHE
+	if ( ((byte *)(ptr))[-1] == TC_ALLOC ) {
+		mem_threadHeap.Free( ptr );
+		return;
+	}
+#endif
+	Mem_Lock( mem_heapLock );
 	Mem_UpdateFreeStats( mem_heap->Msize( ptr ) );
 	mem_heap->Free( ptr );
+	Mem_Unlock( mem_heapLock );
 }
 
 /*
@@ -1116,7 +1598,10 @@ void *Mem_Alloc16( const int size ) {
 #endif
 		return malloc( size );
 	}
+	Mem_Lock( mem_heapLock );
 	void *mem = mem_heap->Allocate16( size );
+	mem_heapAllocCount++;
+	Mem_Unlock( mem_heapLock );
 	// make sure the memory is 16 byte aligned
 	assert( ( ((intptr_t)mem) & 15) == 0 );
 	return mem;
@@ -1140,7 +1625,9 @@ void Mem_Free16( void *ptr ) {
 	}
 	// make sure the memory is 16 byte aligned
 	assert( ( ((intptr_t)ptr) & 15) == 0 );
+	Mem_Lock( mem_heapLock );
 	mem_heap->Free16( ptr );
+	Mem_Unlock( mem_heapLock );
 }
 
 /*
@@ -1160,7 +1647,9 @@ Mem_ClearedAlloc
 ==================
 */
 void Mem_AllocDefragBlock( void ) {
+	Mem_Lock( mem_heapLock );
 	mem_heap->AllocDefragBlock();
+	Mem_Unlock( mem_heapLock );
 }
 
 /*
@@ -1198,6 +1687,9 @@ Mem_Init
 ==================
 */
 void Mem_Init( void ) {
+#if USE_THREAD_CACHE
+	mem_threadHeap.Init();
+#endif
 	mem_heap = new idHeap;
 	Mem_ClearFrameStats();
 }
@@ -1211,6 +1703,7 @@ void Mem_Shutdown( void ) {
 	idHeap *m = mem_heap;
 	mem_heap = NULL;
 	delete m;
+	mem_threadHeap.Shutdown();
 }
 
 /*
@@ -1550,6 +2043,7 @@ void *Mem_AllocDebugMemory( const int size, const char *fileName, const int line
 	}
 
 	Mem_UpdateAllocStats( size );
+	mem_heapAllocCount++;
 
 	m = (debugMemory_t *) p;
 	m->fileName = fileName;
@@ -1731,3 +2225,206 @@ void Mem_EnableLeakTest( const char *name ) {
 }
 
 #endif /* !ID_DEBUG_MEMORY */
+
+
+//===============================================================
+//
+//	thread cache statistics and benchmark
+//
+//===============================================================
+
+#define MEMTEST_MAX_THREADS		8
+#define MEMTEST_SLOTS			1024
+#define MEMTEST_MAX_SIZE		512
+
+typedef enum {
+	MEMTEST_LIBC,
+	MEMTEST_HEAP,
+	MEMTEST_THREAD_CACHE
+} memTestMode_t;
+
+typedef struct {
+	memTestMode_t			mode;
+	int						numAllocs;
+	int						seed;
+	xthreadInfo				thread;
+} memTestThread_t;
+
+static idHeap *				memtest_heap;
+static volatile long		memtest_heapLock;
+
+/*
+==================
+Mem_ReleaseThreadCache
+==================
+*/
+void Mem_ReleaseThreadCache( void ) {
+	if ( mem_threadHeap.IsInitialized() ) {
+		mem_threadHeap.ReleaseCache();
+	}
+}
+
+/*
+==================
+Mem_ClassStats_f
+==================
+*/
+void Mem_ClassStats_f( const idCmdArgs &args ) {
+	int i, allocs, frees, cached, spans;
+	int totalAllocs = 0, totalInUse = 0, totalBytes = 0, totalSpans = 0;
+
+	if ( !mem_threadHeap.IsInitialized() ) {
+		idLib::common->Printf( "thread cache is not active\n" );
+		return;
+	}
+
+	idLib::common->Printf( " size     allocs      frees   in use      bytes  cached spans\n" );
+	for ( i = 0; i < TC_NUM_CLASSES; i++ ) {
+		mem_threadHeap.GetClassStats( i, allocs, frees, cached, spans );
+		if ( !allocs && !spans ) {
+			continue;
+		}
+		int size = idThreadHeap::ClassSize( i );
+		idLib::common->Printf( "%5d %10d %10d %8d %10d %7d %5d\n", size, allocs, frees, allocs - frees, ( allocs - frees ) * size, cached, spans );
+		totalAllocs += allocs;
+		totalInUse += allocs - frees;
+		totalBytes += ( allocs - frees ) * size;
+		totalSpans += spans;
+	}
+	idLib::common->Printf( "%d allocations, %d in use, %d kB in use, %d kB in spans\n", totalAllocs, totalInUse, totalBytes >> 10, ( totalSpans * TC_SPAN_SIZE ) >> 10 );
+}
+
+/*
+==================
+Mem_TestAlloc
+==================
+*/
+static void *Mem_TestAlloc( memTestMode_t mode, int size ) {
+	void *p;
+
+	switch( mode ) {
+		case MEMTEST_LIBC:
+			return malloc( size );
+		case MEMTEST_HEAP:
+			Mem_Lock( memtest_heapLock );
+			p = memtest_heap->Allocate( size );
+			Mem_Unlock( memtest_heapLock );
+			return p;
+		default:
+			return mem_threadHeap.Allocate( size );
+	}
+}
+
+/*
+==================
+Mem_TestFree
+==================
+*/
+static void Mem_TestFree( memTestMode_t mode, void *p ) {
+	switch( mode ) {
+		case MEMTEST_LIBC:
+			free( p );
+			break;
+		case MEMTEST_HEAP:
+			Mem_Lock( memtest_heapLock );
+			memtest_heap->Free( p );
+			Mem_Unlock( memtest_heapLock );
+			break;
+		default:
+			mem_threadHeap.Free( p );
+			break;
+	}
+}
+
+/*
+==================
+Mem_TestThread
+
+  randomly allocates and frees small blocks, keeping up to MEMTEST_SLOTS alive
+==================
+*/
+static int Mem_TestThread( void *parms ) {
+	memTestThread_t *test = (memTestThread_t *)parms;
+	void *slots[MEMTEST_SLOTS];
+	idRandom rnd( test->seed );
+	int i, s;
+
+	memset( slots, 0, sizeof( slots ) );
+	for ( i = 0; i < test->numAllocs; i++ ) {
+		s = rnd.RandomInt( MEMTEST_SLOTS );
+		if ( slots[s] ) {
+			Mem_TestFree( test->mode, slots[s] );
+		}
+		int size = 1 + rnd.RandomInt( MEMTEST_MAX_SIZE );
+		slots[s] = Mem_TestAlloc( test->mode, size );
+		*(byte *)slots[s] = i;
+	}
+	for ( s = 0; s < MEMTEST_SLOTS; s++ ) {
+		if ( slots[s] ) {
+			Mem_TestFree( test->mode, slots[s] );
+		}
+	}
+	if ( test->mode == MEMTEST_THREAD_CACHE ) {
+		mem_threadHeap.ReleaseCache();
+	}
+	return 0;
+}
+
+/*
+==================
+Mem_TestMode
+==================
+*/
+static void Mem_TestMode( const char *name, memTestMode_t mode, int numThreads, int numAllocs ) {
+	memTestThread_t threads[MEMTEST_MAX_THREADS];
+	int i;
+
+	memset( threads, 0, sizeof( threads ) );
+
+	double start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numThreads; i++ ) {
+		threads[i].mode = mode;
+		threads[i].numAllocs = numAllocs;
+		threads[i].seed = 1013904223 + i;
+		Sys_CreateThread( Mem_TestThread, &threads[i], threads[i].thread, "memTest" );
+	}
+	for ( i = 0; i < numThreads; i++ ) {
+		Sys_DestroyThread( threads[i].thread );
+	}
+	double usec = idLib::sys->GetMicroseconds() - start;
+
+	idLib::common->Printf( "%-16s %10.2f ms %8.2f Mops/s\n", name, usec * 0.001, (double)numThreads * numAllocs / usec );
+}
+
+/*
+==================
+Mem_Test_f
+==================
+*/
+void Mem_Test_f( const idCmdArgs &args ) {
+	int numThreads = args.Argc() > 1 ? atoi( args.Argv( 1 ) ) : 4;
+	int numAllocs = args.Argc() > 2 ? atoi( args.Argv( 2 ) ) : 1000000;
+	bool initThreadHeap = !mem_threadHeap.IsInitialized();
+
+	numThreads = idMath::ClampInt( 1, MEMTEST_MAX_THREADS, numThreads );
+	numAllocs = Max( numAllocs, 1 );
+
+	idLib::common->Printf( "Testing %d threads with %d allocations of 1-%d bytes each...\n", numThreads, numAllocs, MEMTEST_MAX_SIZE );
+
+	Mem_TestMode( "libc malloc", MEMTEST_LIBC, numThreads, numAllocs );
+
+	memtest_heap = new idHeap;
+	memtest_heapLock = 0;
+	Mem_TestMode( "idHeap + lock", MEMTEST_HEAP, numThreads, numAllocs );
+	delete memtest_heap;
+	memtest_heap = NULL;
+
+	// the thread cache is not used by Mem_Alloc in every build, the benchmark sets it up if needed
+	if ( initThreadHeap ) {
+		mem_threadHeap.Init();
+	}
+	Mem_TestMode( "thread cache", MEMTEST_THREAD_CACHE, numThreads, numAllocs );
+	if ( initThreadHeap ) {
+		mem_threadHeap.Shutdown();
+	}
+}
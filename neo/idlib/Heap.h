@@ -59,9 +59,13 @@ void		Mem_EnableLeakTest( const char *name );
 void		Mem_ClearFrameStats( void );
 void		Mem_GetFrameStats( memoryStats_t &allocs, memoryStats_t &frees );
 void		Mem_GetStats( memoryStats_t &stats );
+int			Mem_GetAllocCount( void );			// allocations made since Mem_Init
 void		Mem_Dump_f( const class idCmdArgs &args );
 void		Mem_DumpCompressed_f( const class idCmdArgs &args );
 void		Mem_AllocDefragBlock( void );
+void		Mem_ReleaseThreadCache( void );		// call before a thread that used Mem_Alloc exits
+void		Mem_ClassStats_f( const class idCmdArgs &args );
+void		Mem_Test_f( const class idCmdArgs &args );
 
 
 #ifndef ID_DEBUG_MEMORY
@@ -42,6 +42,9 @@ If you have questions concerning this license or the applicable additional terms
 #include "idlib/math/Polynomial.h"
 #include "idlib/Str.h"
 #include "idlib/Dict.h"
+#include "idlib/Arena.h"
+#include "idlib/hashing/CRC32.h"
+#include "idlib/hashing/SipHash.h"
 #include "framework/Common.h"
 
 #include "idlib/Lib.h"
@@ -85,6 +88,12 @@ void idLib::Init( void ) {
 	// initialize math
 	idMath::Init();
 
+	// build the CRC32 slice tables
+	CRC32_Init();
+
+	// pick the key for hash tables indexed by network data
+	SipHash_Init();
+
 	// test idMatX
 	//idMatX::Test();
 
@@ -105,6 +114,9 @@ void idLib::ShutDown( void ) {
 	// shut down the dictionary string pools
 	idDict::Shutdown();
 
+	// free the request arenas
+	arenaPool.Shutdown();
+
 	// shut down the string memory allocator
 	idStr::ShutdownMemory();
 
@@ -29,6 +29,7 @@ If you have questions concerning this license or the applicable additional terms
 #include "sys/platform.h"
 #include "idlib/math/Vector.h"
 #include "idlib/Heap.h"
+#include "idlib/Arena.h"
 #include "framework/Common.h"
 
 #include "idlib/Str.h"
@@ -89,6 +90,19 @@ void idStr::ReAllocate( int amount, bool keepold ) {
 	//assert( data );
 	assert( amount > 0 );
 
+	if ( alloced & STR_ALLOC_ARENA ) {
+		// grow geometrically, the old buffer stays in the arena until it is reset
+		newsize = Max( amount, ( alloced & ~STR_ALLOC_ARENA ) * 2 );
+		newbuffer = (char *) static_cast<idArenaStr *>( this )->arena->Alloc( newsize, 1 );
+		if ( keepold && data ) {
+			data[ len ] = '\0';
+			strcpy( newbuffer, data );
+		}
+		alloced = newsize | STR_ALLOC_ARENA;
+		data = newbuffer;
+		return;
+	}
+
 	mod = amount % STR_ALLOC_GRAN;
 	if ( !mod ) {
 		newsize = amount;
@@ -125,6 +139,12 @@ idStr::FreeData
 ============
 */
 void idStr::FreeData( void ) {
+	if ( alloced & STR_ALLOC_ARENA ) {
+		// arena memory is released by idArena::Reset
+		data = baseBuffer;
+		alloced = STR_ALLOC_BASE | STR_ALLOC_ARENA;
+		return;
+	}
 	if ( data && data != baseBuffer ) {
 #ifdef USE_STRING_DATA_ALLOCATOR
 		stringDataAllocator.Free( data );
@@ -120,6 +120,9 @@ const int C_COLOR_BLACK				= '9';
 // don't make too large to keep memory requirements to a minimum
 const int STR_ALLOC_BASE			= 20;
 const int STR_ALLOC_GRAN			= 32;
+const int STR_ALLOC_ARENA			= 1 << 30;	// flag in alloced, the string is an idArenaStr
+
+class idArena;
 
 typedef enum {
 	MEASURE_SIZE = 0,
@@ -131,6 +134,9 @@ class idStr {
 public:
 						idStr( void );
 						idStr( const idStr &text );
+#ifdef ID_MOVE_SEMANTICS
+						idStr( idStr &&text );
+#endif
 						idStr( const idStr &text, int start, int end );
 						idStr( const char *text );
 						idStr( const char *text, int start, int end );
@@ -151,6 +157,9 @@ public:
 
 	void				operator=( const idStr &text );
 	void				operator=( const char *text );
+#ifdef ID_MOVE_SEMANTICS
+	void				operator=( idStr &&text );							// takes over the heap buffer of text and leaves it empty
+#endif
 
 	friend idStr		operator+( const idStr &a, const idStr &b );
 	friend idStr		operator+( const idStr &a, const char *b );
@@ -339,7 +348,7 @@ char *					va( const char *fmt, ... ) id_attribute((format(printf,1,2)));
 
 
 ID_INLINE void idStr::EnsureAlloced( int amount, bool keepold ) {
-	if ( amount > alloced ) {
+	if ( amount > ( alloced & ~STR_ALLOC_ARENA ) ) {
 		ReAllocate( amount, keepold );
 	}
 }
@@ -538,6 +547,31 @@ ID_INLINE void idStr::operator=( const idStr &text ) {
 	len = l;
 }
 
+#ifdef ID_MOVE_SEMANTICS
+ID_INLINE idStr::idStr( idStr &&text ) {
+	Init();
+	*this = static_cast<idStr &&>( text );
+}
+
+ID_INLINE void idStr::operator=( idStr &&text ) {
+	if ( &text == this ) {
+		return;
+	}
+
+	// the base buffer can't be handed over and arena memory must stay with arena strings
+	if ( text.data == text.baseBuffer || ( ( alloced | text.alloced ) & STR_ALLOC_ARENA ) ) {
+		*this = static_cast<const idStr &>( text );
+		return;
+	}
+
+	FreeData();
+	len = text.len;
+	data = text.data;
+	alloced = text.alloced;
+	text.Init();
+}
+#endif
+
 ID_INLINE idStr operator+( const idStr &a, const idStr &b ) {
 	idStr result( a );
 	result.Append( b );
@@ -727,7 +761,7 @@ ID_INLINE int idStr::Length( void ) const {
 
 ID_INLINE int idStr::Allocated( void ) const {
 	if ( data != baseBuffer ) {
-		return alloced;
+		return alloced & ~STR_ALLOC_ARENA;
 	} else {
 		return 0;
 	}
@@ -744,8 +778,10 @@ ID_INLINE bool idStr::IsEmpty( void ) const {
 }
 
 ID_INLINE void idStr::Clear( void ) {
+	int arenaFlag = alloced & STR_ALLOC_ARENA;
 	FreeData();
 	Init();
+	alloced |= arenaFlag;
 }
 
 ID_INLINE void idStr::Append( const char a ) {
@@ -1065,7 +1101,53 @@ ID_INLINE int idStr::ColorIndex( int c ) {
 }
 
 ID_INLINE int idStr::DynamicMemoryUsed() const {
-	return ( data == baseBuffer ) ? 0 : alloced;
+	return ( data == baseBuffer ) ? 0 : ( alloced & ~STR_ALLOC_ARENA );
+}
+
+/*
+===============================================================================
+
+	Arena string.
+
+	Behaves like idStr but takes memory beyond the base buffer from an
+	idArena. Old buffers are left to the arena, so the string must not
+	be used after the arena is Reset.
+
+===============================================================================
+*/
+
+class idArenaStr : public idStr {
+public:
+	explicit		idArenaStr( idArena &arena );
+					idArenaStr( idArena &arena, const char *text );
+					idArenaStr( const idArenaStr &text );
+
+	idArenaStr &	operator=( const idArenaStr &text ) { idStr::operator=( text ); return *this; }
+	idArenaStr &	operator=( const idStr &text ) { idStr::operator=( text ); return *this; }
+	idArenaStr &	operator=( const char *text ) { idStr::operator=( text ); return *this; }
+
+	idArena *		GetArena( void ) const { return arena; }
+
+private:
+	friend class	idStr;
+	idArena *		arena;
+};
+
+ID_INLINE idArenaStr::idArenaStr( idArena &arena ) : idStr() {
+	this->arena = &arena;
+	alloced |= STR_ALLOC_ARENA;
+}
+
+ID_INLINE idArenaStr::idArenaStr( idArena &arena, const char *text ) : idStr() {
+	this->arena = &arena;
+	alloced |= STR_ALLOC_ARENA;
+	idStr::operator=( text );
+}
+
+ID_INLINE idArenaStr::idArenaStr( const idArenaStr &text ) : idStr() {
+	arena = text.arena;
+	alloced |= STR_ALLOC_ARENA;
+	idStr::operator=( text );
 }
 
 #endif /* !__STR_H__ */
@@ -56,14 +56,16 @@ public:
 	void			Stop( void );
 	void			Clear( void );
 	unsigned int	Milliseconds( void ) const;
+	double			Microseconds( void ) const;
+	double			StartTime( void ) const { return start; }	// clock in microseconds at the last Start
 
 private:
 	enum			{
 						TS_STARTED,
 						TS_STOPPED
 					} state;
-	unsigned int	start;
-	unsigned int	ms;
+	double			start;
+	double			usec;
 };
 
 /*
@@ -73,7 +75,7 @@ idTimer::idTimer
 */
 ID_INLINE idTimer::idTimer( void ) {
 	state = TS_STOPPED;
-	ms = 0;
+	usec = 0.0;
 }
 
 /*
@@ -83,7 +85,7 @@ idTimer::idTimer
 */
 ID_INLINE idTimer::idTimer( unsigned int _ms ) {
 	state = TS_STOPPED;
-	ms = _ms;
+	usec = _ms * 1000.0;
 }
 
 /*
@@ -101,7 +103,9 @@ idTimer::operator+
 */
 ID_INLINE idTimer idTimer::operator+( const idTimer &t ) const {
 	assert( state == TS_STOPPED && t.state == TS_STOPPED );
-	return idTimer( ms + t.ms );
+	idTimer sum;
+	sum.usec = usec + t.usec;
+	return sum;
 }
 
 /*
@@ -111,7 +115,9 @@ idTimer::operator-
 */
 ID_INLINE idTimer idTimer::operator-( const idTimer &t ) const {
 	assert( state == TS_STOPPED && t.state == TS_STOPPED );
-	return idTimer( ms - t.ms );
+	idTimer difference;
+	difference.usec = usec - t.usec;
+	return difference;
 }
 
 /*
@@ -121,7 +127,7 @@ idTimer::operator+=
 */
 ID_INLINE idTimer &idTimer::operator+=( const idTimer &t ) {
 	assert( state == TS_STOPPED && t.state == TS_STOPPED );
-	ms += t.ms;
+	usec += t.usec;
 	return *this;
 }
 
@@ -132,7 +138,7 @@ idTimer::operator-=
 */
 ID_INLINE idTimer &idTimer::operator-=( const idTimer &t ) {
 	assert( state == TS_STOPPED && t.state == TS_STOPPED );
-	ms -= t.ms;
+	usec -= t.usec;
 	return *this;
 }
 
@@ -144,7 +150,7 @@ idTimer::Start
 ID_INLINE void idTimer::Start( void ) {
 	assert( state == TS_STOPPED );
 	state = TS_STARTED;
-	start = idLib::sys->GetMilliseconds();
+	start = idLib::sys->GetMicroseconds();
 }
 
 /*
@@ -154,7 +160,7 @@ idTimer::Stop
 */
 ID_INLINE void idTimer::Stop( void ) {
 	assert( state == TS_STARTED );
-	ms += idLib::sys->GetMilliseconds() - start;
+	usec += idLib::sys->GetMicroseconds() - start;
 	state = TS_STOPPED;
 }
 
@@ -164,7 +170,7 @@ idTimer::Clear
 =================
 */
 ID_INLINE void idTimer::Clear( void ) {
-	ms = 0;
+	usec = 0.0;
 }
 
 /*
@@ -174,7 +180,17 @@ idTimer::Milliseconds
 */
 ID_INLINE unsigned int idTimer::Milliseconds( void ) const {
 	assert( state == TS_STOPPED );
-	return ms;
+	return (unsigned int)( usec / 1000.0 );
+}
+
+/*
+=================
+idTimer::Microseconds
+=================
+*/
+ID_INLINE double idTimer::Microseconds( void ) const {
+	assert( state == TS_STOPPED );
+	return usec;
 }
 
 
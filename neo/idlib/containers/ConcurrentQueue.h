@@ -0,0 +1,373 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __CONCURRENTQUEUE_H__
+#define __CONCURRENTQUEUE_H__
+
+#include "idlib/math/Math.h"
+#include "idlib/containers/List.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+===============================================================================
+
+	Bounded lock-free queues for handing work between threads.
+
+	idSPSCQueue has one producer and one consumer thread, idMPMCQueue any
+	number of both. Both are fixed size rings, Push fails when the queue is
+	full and Pop fails when it is empty, nobody ever blocks. The indices
+	written by producers and consumers are kept on separate cache lines.
+
+	Elements are copied in on Push and moved out on Pop, the type needs a
+	default constructor.
+
+===============================================================================
+*/
+
+#define QUEUE_CACHE_LINE_SIZE		64
+
+/*
+================
+Queue_AtomicLoad
+
+  Load with acquire semantics, later reads can't move in front of it.
+================
+*/
+ID_INLINE unsigned int Queue_AtomicLoad( const volatile unsigned int &value ) {
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+	// x86 doesn't reorder loads with later loads or stores, only the compiler has to be held back
+	unsigned int v = value;
+	_ReadWriteBarrier();
+	return v;
+#elif defined( _MSC_VER )
+	// ARM can reorder, the interlocked operations are full barriers
+	return (unsigned int)_InterlockedOr( (volatile long *)&value, 0 );
+#else
+	return __atomic_load_n( &value, __ATOMIC_ACQUIRE );
+#endif
+}
+
+/*
+================
+Queue_AtomicStore
+
+  Store with release semantics, earlier writes can't move behind it.
+================
+*/
+ID_INLINE void Queue_AtomicStore( volatile unsigned int &value, unsigned int v ) {
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+	// x86 doesn't reorder stores with earlier loads or stores
+	_ReadWriteBarrier();
+	value = v;
+#elif defined( _MSC_VER )
+	_InterlockedExchange( (volatile long *)&value, (long)v );
+#else
+	__atomic_store_n( &value, v, __ATOMIC_RELEASE );
+#endif
+}
+
+/*
+================
+Queue_AtomicCompareExchange
+
+  Sets value to exchange if it is comparand, returns what value was before.
+================
+*/
+ID_INLINE unsigned int Queue_AtomicCompareExchange( volatile unsigned int &value, unsigned int comparand, unsigned int exchange ) {
+#ifdef _MSC_VER
+	return (unsigned int)_InterlockedCompareExchange( (volatile long *)&value, (long)exchange, (long)comparand );
+#else
+	return __sync_val_compare_and_swap( &value, comparand, exchange );
+#endif
+}
+
+/*
+===============================================================================
+
+	Single producer, single consumer queue.
+
+	Each side keeps a copy of the other side's index and only reloads it when
+	the copy says the queue is full or empty, so most calls touch no cache
+	line the other thread writes to.
+
+===============================================================================
+*/
+
+template< class type >
+class idSPSCQueue {
+public:
+						idSPSCQueue( void );
+						~idSPSCQueue( void );
+
+	void				Init( int size );			// size is rounded up to a power of two
+	void				Shutdown( void );
+
+	bool				Push( const type &element );	// producer thread only, false if the queue is full
+	bool				Pop( type &element );			// consumer thread only, false if the queue is empty
+
+	int					Num( void ) const;			// approximate when the queue is in use
+	int					GetSize( void ) const { return mask + 1; }
+
+private:
+	type *				elements;
+	unsigned int		mask;
+	byte				pad0[QUEUE_CACHE_LINE_SIZE];
+
+	volatile unsigned int	tail;					// written by the producer
+	unsigned int		cachedHead;
+	byte				pad1[QUEUE_CACHE_LINE_SIZE - 2 * sizeof( int )];
+
+	volatile unsigned int	head;					// written by the consumer
+	unsigned int		cachedTail;
+	byte				pad2[QUEUE_CACHE_LINE_SIZE - 2 * sizeof( int )];
+
+						idSPSCQueue( const idSPSCQueue & );
+	void				operator=( const idSPSCQueue & );
+};
+
+template< class type >
+ID_INLINE idSPSCQueue<type>::idSPSCQueue( void ) {
+	elements = NULL;
+	mask = 0;
+	tail = cachedHead = 0;
+	head = cachedTail = 0;
+}
+
+template< class type >
+ID_INLINE idSPSCQueue<type>::~idSPSCQueue( void ) {
+	Shutdown();
+}
+
+template< class type >
+ID_INLINE void idSPSCQueue<type>::Init( int size ) {
+	Shutdown();
+	size = idMath::CeilPowerOfTwo( size < 2 ? 2 : size );
+	elements = new type[size];
+	mask = size - 1;
+	tail = cachedHead = 0;
+	head = cachedTail = 0;
+}
+
+template< class type >
+ID_INLINE void idSPSCQueue<type>::Shutdown( void ) {
+	delete[] elements;
+	elements = NULL;
+	mask = 0;
+}
+
+template< class type >
+ID_INLINE bool idSPSCQueue<type>::Push( const type &element ) {
+	unsigned int t = tail;
+
+	if ( t - cachedHead > mask ) {
+		cachedHead = Queue_AtomicLoad( head );
+		if ( t - cachedHead > mask ) {
+			return false;
+		}
+	}
+	elements[t & mask] = element;
+	Queue_AtomicStore( tail, t + 1 );
+	return true;
+}
+
+template< class type >
+ID_INLINE bool idSPSCQueue<type>::Pop( type &element ) {
+	unsigned int h = head;
+
+	if ( h == cachedTail ) {
+		cachedTail = Queue_AtomicLoad( tail );
+		if ( h == cachedTail ) {
+			return false;
+		}
+	}
+	element = idMove( elements[h & mask] );
+	Queue_AtomicStore( head, h + 1 );
+	return true;
+}
+
+template< class type >
+ID_INLINE int idSPSCQueue<type>::Num( void ) const {
+	return (int)( Queue_AtomicLoad( tail ) - Queue_AtomicLoad( head ) );
+}
+
+/*
+===============================================================================
+
+	Multiple producer, multiple consumer queue.
+
+	Every cell has a sequence number that says whose turn it is. A producer
+	claims the cell at the enqueue position when its sequence equals the
+	position, fills it and sets the sequence to position + 1, which hands
+	it to the consumer that claims the same position. The consumer empties
+	the cell and sets the sequence to position + size for the producer one
+	lap later. Claiming a position is a single compare and exchange.
+
+===============================================================================
+*/
+
+template< class type >
+class idMPMCQueue {
+public:
+						idMPMCQueue( void );
+						~idMPMCQueue( void );
+
+	void				Init( int size );			// size is rounded up to a power of two
+	void				Shutdown( void );
+
+	bool				Push( const type &element );	// false if the queue is full
+	bool				Pop( type &element );			// false if the queue is empty
+
+	int					Num( void ) const;			// approximate when the queue is in use
+	int					GetSize( void ) const { return mask + 1; }
+
+private:
+	typedef struct cell_s {
+		volatile unsigned int	sequence;
+		type			element;
+	} cell_t;
+
+	cell_t *			cells;
+	unsigned int		mask;
+	byte				pad0[QUEUE_CACHE_LINE_SIZE];
+
+	volatile unsigned int	enqueuePos;
+	byte				pad1[QUEUE_CACHE_LINE_SIZE - sizeof( int )];
+
+	volatile unsigned int	dequeuePos;
+	byte				pad2[QUEUE_CACHE_LINE_SIZE - sizeof( int )];
+
+						idMPMCQueue( const idMPMCQueue & );
+	void				operator=( const idMPMCQueue & );
+};
+
+template< class type >
+ID_INLINE idMPMCQueue<type>::idMPMCQueue( void ) {
+	cells = NULL;
+	mask = 0;
+	enqueuePos = 0;
+	dequeuePos = 0;
+}
+
+template< class type >
+ID_INLINE idMPMCQueue<type>::~idMPMCQueue( void ) {
+	Shutdown();
+}
+
+template< class type >
+ID_INLINE void idMPMCQueue<type>::Init( int size ) {
+	int i;
+
+	Shutdown();
+	size = idMath::CeilPowerOfTwo( size < 2 ? 2 : size );
+	cells = new cell_t[size];
+	for ( i = 0; i < size; i++ ) {
+		cells[i].sequence = i;
+	}
+	mask = size - 1;
+	enqueuePos = 0;
+	dequeuePos = 0;
+}
+
+template< class type >
+ID_INLINE void idMPMCQueue<type>::Shutdown( void ) {
+	delete[] cells;
+	cells = NULL;
+	mask = 0;
+}
+
+template< class type >
+ID_INLINE bool idMPMCQueue<type>::Push( const type &element ) {
+	cell_t *cell;
+	unsigned int pos, prev;
+	int dif;
+
+	pos = enqueuePos;
+	while( 1 ) {
+		cell = &cells[pos & mask];
+		dif = (int)( Queue_AtomicLoad( cell->sequence ) - pos );
+		if ( dif == 0 ) {
+			prev = Queue_AtomicCompareExchange( enqueuePos, pos, pos + 1 );
+			if ( prev == pos ) {
+				break;
+			}
+			pos = prev;
+		} else if ( dif < 0 ) {
+			// the consumer of the previous lap hasn't emptied the cell yet
+			return false;
+		} else {
+			pos = enqueuePos;
+		}
+	}
+
+	cell->element = element;
+	Queue_AtomicStore( cell->sequence, pos + 1 );
+	return true;
+}
+
+template< class type >
+ID_INLINE bool idMPMCQueue<type>::Pop( type &element ) {
+	cell_t *cell;
+	unsigned int pos, prev;
+	int dif;
+
+	pos = dequeuePos;
+	while( 1 ) {
+		cell = &cells[pos & mask];
+		dif = (int)( Queue_AtomicLoad( cell->sequence ) - ( pos + 1 ) );
+		if ( dif == 0 ) {
+			prev = Queue_AtomicCompareExchange( dequeuePos, pos, pos + 1 );
+			if ( prev == pos ) {
+				break;
+			}
+			pos = prev;
+		} else if ( dif < 0 ) {
+			// no producer has filled the cell yet
+			return false;
+		} else {
+			pos = dequeuePos;
+		}
+	}
+
+	element = idMove( cell->element );
+	Queue_AtomicStore( cell->sequence, pos + mask + 1 );
+	return true;
+}
+
+template< class type >
+ID_INLINE int idMPMCQueue<type>::Num( void ) const {
+	int num = (int)( Queue_AtomicLoad( enqueuePos ) - Queue_AtomicLoad( dequeuePos ) );
+	return idMath::ClampInt( 0, mask + 1, num );
+}
+
+// times the queues with 1, 2, 4 and 8 producers and consumers
+void		Queue_Test_f( const class idCmdArgs &args );
+
+#endif /* !__CONCURRENTQUEUE_H__ */
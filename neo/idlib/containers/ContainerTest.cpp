@@ -0,0 +1,723 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+
+#include "sys/platform.h"
+#include "idlib/Heap.h"
+#include "idlib/Str.h"
+#include "idlib/Dict.h"
+#include "idlib/containers/List.h"
+#include "idlib/containers/StrList.h"
+#include "idlib/containers/HashIndex.h"
+#include "idlib/containers/HashTable.h"
+#include "idlib/containers/FlatHashMap.h"
+#include "idlib/containers/ConcurrentQueue.h"
+#include "idlib/CmdArgs.h"
+#include "sys/sys_public.h"
+#include "framework/Common.h"
+
+/*
+===============================================================================
+
+	Container microbenchmarks.
+
+	Container_Test_f runs a copying variant of every test, which is what the
+	containers did before they could move elements, next to the moving variant
+	and reports the time and the number of Mem_Alloc calls for both.
+
+	HashMap_Test_f times inserts, hits and misses of idHashIndex, idHashTable
+	and idFlatHashMap with integer and string keys.
+
+	Queue_Test_f pushes items through idSPSCQueue, idMPMCQueue and a ring
+	behind a critical section with several threads on each side.
+
+===============================================================================
+*/
+
+#define CONTAINER_TEST_STRINGS		256
+#define CONTAINER_TEST_KEYS			32
+#define CONTAINER_TEST_INTS			4096
+
+// an int the list can't memcpy, stands in for the element by element Resize
+class idCopiedInt {
+public:
+	int				value;
+
+	idCopiedInt &	operator=( const idCopiedInt &other ) { value = other.value; return *this; }
+};
+
+/*
+================
+ContainerTest_Report
+================
+*/
+static void ContainerTest_Report( const char *name, int numRuns, double copyUsec, int copyAllocs, double moveUsec, int moveAllocs ) {
+	idLib::common->Printf( "%-16s copy: %8.3f usec %8.2f allocs   move: %8.3f usec %8.2f allocs\n", name,
+		copyUsec / numRuns, (float)copyAllocs / numRuns, moveUsec / numRuns, (float)moveAllocs / numRuns );
+}
+
+/*
+================
+ContainerTest_GrowCopy
+
+Grows a string list the way Resize used to, copying every string into the new buffer.
+================
+*/
+static void ContainerTest_GrowCopy( idStr *&list, int &size, int num ) {
+	idStr *temp;
+	int i;
+
+	temp = new idStr[ size + 16 ];
+	for ( i = 0; i < num; i++ ) {
+		temp[i] = list[i];
+	}
+	delete[] list;
+	list = temp;
+	size += 16;
+}
+
+/*
+================
+ContainerTest_FillDict
+================
+*/
+static void ContainerTest_FillDict( idDict &dict ) {
+	for ( int i = 0; i < CONTAINER_TEST_KEYS; i++ ) {
+		dict.Set( va( "si_testKey%d", i ), va( "a value long enough for a heap buffer %d", i ) );
+	}
+}
+
+/*
+================
+Container_Test_f
+================
+*/
+void Container_Test_f( const idCmdArgs &args ) {
+	int numRuns = args.Argc() > 1 ? atoi( args.Argv( 1 ) ) : 100;
+	int r, i, size, num, copyAllocs, moveAllocs;
+	double start, copyUsec, moveUsec;
+	idStr *strings;
+
+	numRuns = Max( numRuns, 1 );
+
+	idLib::common->Printf( "Testing containers with %d runs...\n", numRuns );
+
+	idStr text = "a string too long for the base buffer";
+
+	// growing a list of strings
+	copyAllocs = Mem_GetAllocCount();
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		strings = NULL;
+		size = num = 0;
+		for ( i = 0; i < CONTAINER_TEST_STRINGS; i++ ) {
+			if ( num == size ) {
+				ContainerTest_GrowCopy( strings, size, num );
+			}
+			strings[num++] = text;
+		}
+		delete[] strings;
+	}
+	copyUsec = idLib::sys->GetMicroseconds() - start;
+	copyAllocs = Mem_GetAllocCount() - copyAllocs;
+
+	moveAllocs = Mem_GetAllocCount();
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		idList<idStr> list;
+		list.SetGranularity( 16 );
+		for ( i = 0; i < CONTAINER_TEST_STRINGS; i++ ) {
+			list.Append( text );
+		}
+	}
+	moveUsec = idLib::sys->GetMicroseconds() - start;
+	moveAllocs = Mem_GetAllocCount() - moveAllocs;
+	ContainerTest_Report( "idList<idStr>", numRuns, copyUsec, copyAllocs, moveUsec, moveAllocs );
+
+	// handing built strings over to a list
+	idList<idStr> list;
+	list.SetNum( CONTAINER_TEST_STRINGS );
+
+	copyAllocs = Mem_GetAllocCount();
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		for ( i = 0; i < CONTAINER_TEST_STRINGS; i++ ) {
+			idStr temp = text;
+			list[i].Clear();
+			list[i] = temp;
+		}
+	}
+	copyUsec = idLib::sys->GetMicroseconds() - start;
+	copyAllocs = Mem_GetAllocCount() - copyAllocs;
+
+	moveAllocs = Mem_GetAllocCount();
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		for ( i = 0; i < CONTAINER_TEST_STRINGS; i++ ) {
+			idStr temp = text;
+			list[i].Clear();
+			list[i] = idMove( temp );
+		}
+	}
+	moveUsec = idLib::sys->GetMicroseconds() - start;
+	moveAllocs = Mem_GetAllocCount() - moveAllocs;
+	ContainerTest_Report( "idStr", numRuns, copyUsec, copyAllocs, moveUsec, moveAllocs );
+	list.Clear();
+
+	// passing a dictionary along
+	idDict source, dest;
+
+	copyAllocs = Mem_GetAllocCount();
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		ContainerTest_FillDict( source );
+		dest = source;
+		source.Clear();
+	}
+	copyUsec = idLib::sys->GetMicroseconds() - start;
+	copyAllocs = Mem_GetAllocCount() - copyAllocs;
+
+	moveAllocs = Mem_GetAllocCount();
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		ContainerTest_FillDict( source );
+		dest = idMove( source );
+	}
+	moveUsec = idLib::sys->GetMicroseconds() - start;
+	moveAllocs = Mem_GetAllocCount() - moveAllocs;
+	ContainerTest_Report( "idDict", numRuns, copyUsec, copyAllocs, moveUsec, moveAllocs );
+	dest.Clear();
+
+	// resizing a list of plain data, element by element against memcpy
+	idList<idCopiedInt> copiedInts;
+	idList<int> ints;
+
+	copiedInts.SetGranularity( 64 );
+	ints.SetGranularity( 64 );
+
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		copiedInts.Clear();
+		for ( i = 0; i < CONTAINER_TEST_INTS; i++ ) {
+			copiedInts.Alloc().value = i;
+		}
+	}
+	copyUsec = idLib::sys->GetMicroseconds() - start;
+
+	start = idLib::sys->GetMicroseconds();
+	for ( r = 0; r < numRuns; r++ ) {
+		ints.Clear();
+		for ( i = 0; i < CONTAINER_TEST_INTS; i++ ) {
+			ints.Append( i );
+		}
+	}
+	moveUsec = idLib::sys->GetMicroseconds() - start;
+	ContainerTest_Report( "idList<int>", numRuns, copyUsec, 0, moveUsec, 0 );
+}
+
+/*
+===============================================================================
+
+	Hash maps
+
+===============================================================================
+*/
+
+#define HASHMAP_TEST_MAX_KEYS		( 1 << 20 )
+
+typedef struct hashMapTestTimes_s {
+	double			insert;
+	double			hit;
+	double			miss;
+	double			remove;
+} hashMapTestTimes_t;
+
+/*
+================
+HashMapTest_Report
+================
+*/
+static void HashMapTest_Report( const char *name, const hashMapTestTimes_t &t, int numKeys, size_t allocated ) {
+	if ( t.remove >= 0.0 ) {
+		idLib::common->Printf( "%-24s insert %7.2f hit %7.2f miss %7.2f remove %7.2f nsec %6d kB\n", name,
+			t.insert * 1000.0 / numKeys, t.hit * 1000.0 / numKeys, t.miss * 1000.0 / numKeys, t.remove * 1000.0 / numKeys, (int)( allocated >> 10 ) );
+	} else {
+		idLib::common->Printf( "%-24s insert %7.2f hit %7.2f miss %7.2f remove     n/a nsec %6d kB\n", name,
+			t.insert * 1000.0 / numKeys, t.hit * 1000.0 / numKeys, t.miss * 1000.0 / numKeys, (int)( allocated >> 10 ) );
+	}
+}
+
+/*
+================
+HashMapTest_Ints
+================
+*/
+static void HashMapTest_Ints( int numKeys ) {
+	idList<int> keys, values;
+	idHashIndex hash;
+	idFlatHashMap<int, int> map;
+	hashMapTestTimes_t t;
+	double start;
+	int i, j, found;
+
+	// distinct even keys for hits, odd keys for misses
+	keys.SetNum( numKeys );
+	for ( i = 0; i < numKeys; i++ ) {
+		keys[i] = (int)( (unsigned int)i * 2654435761u << 1 );
+	}
+
+	found = 0;
+
+	// idHashIndex over a key list, the way most of the code uses it
+	values.SetGranularity( numKeys );
+	hash.Clear( idMath::CeilPowerOfTwo( numKeys ), numKeys );
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		hash.Add( keys[i], values.Append( keys[i] ) );
+	}
+	t.insert = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		for ( j = hash.First( keys[i] ); j != -1 && values[j] != keys[i]; j = hash.Next( j ) ) {
+		}
+		found += ( j != -1 );
+	}
+	t.hit = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		for ( j = hash.First( keys[i] | 1 ); j != -1 && values[j] != ( keys[i] | 1 ); j = hash.Next( j ) ) {
+		}
+		found += ( j != -1 );
+	}
+	t.miss = idLib::sys->GetMicroseconds() - start;
+	t.remove = -1.0;
+	HashMapTest_Report( "idHashIndex<int>", t, numKeys, hash.Allocated() + values.Allocated() );
+
+	map.Reserve( numKeys );
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		map.Set( keys[i], i );
+	}
+	t.insert = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += ( map.Find( keys[i] ) != NULL );
+	}
+	t.hit = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += ( map.Find( keys[i] | 1 ) != NULL );
+	}
+	t.miss = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += map.Remove( keys[i] );
+	}
+	t.remove = idLib::sys->GetMicroseconds() - start;
+	HashMapTest_Report( "idFlatHashMap<int>", t, numKeys, map.Allocated() );
+
+	if ( found != numKeys * 3 ) {
+		idLib::common->Warning( "HashMap_Test_f: found %d of %d int keys", found, numKeys * 3 );
+	}
+}
+
+/*
+================
+HashMapTest_Strings
+================
+*/
+static void HashMapTest_Strings( int numKeys ) {
+	idStrList keys, misses;
+	idHashIndex hash;
+	idHashTable<int> *table;
+	idFlatHashMap<idStr, int> map;
+	hashMapTestTimes_t t;
+	double start;
+	int i, j, found, *value;
+
+	keys.SetNum( numKeys );
+	misses.SetNum( numKeys );
+	for ( i = 0; i < numKeys; i++ ) {
+		keys[i] = va( "server%d.example.net:%d", i * 7919, 27666 + ( i & 7 ) );
+		misses[i] = va( "client%d.example.net:%d", i * 7919, 27666 + ( i & 7 ) );
+	}
+
+	found = 0;
+
+	// idHashIndex over the key list
+	hash.Clear( idMath::CeilPowerOfTwo( numKeys ), numKeys );
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		hash.Add( hash.GenerateKey( keys[i].c_str() ), i );
+	}
+	t.insert = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		for ( j = hash.First( hash.GenerateKey( keys[i].c_str() ) ); j != -1 && keys[j].Cmp( keys[i].c_str() ) != 0; j = hash.Next( j ) ) {
+		}
+		found += ( j != -1 );
+	}
+	t.hit = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		for ( j = hash.First( hash.GenerateKey( misses[i].c_str() ) ); j != -1 && keys[j].Cmp( misses[i].c_str() ) != 0; j = hash.Next( j ) ) {
+		}
+		found += ( j != -1 );
+	}
+	t.miss = idLib::sys->GetMicroseconds() - start;
+	t.remove = -1.0;
+	HashMapTest_Report( "idHashIndex<idStr>", t, numKeys, hash.Allocated() );
+
+	table = new idHashTable<int>( idMath::CeilPowerOfTwo( numKeys ) );
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		table->Set( keys[i].c_str(), i );
+	}
+	t.insert = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += table->Get( keys[i].c_str(), &value );
+	}
+	t.hit = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += table->Get( misses[i].c_str(), &value );
+	}
+	t.miss = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		table->Remove( keys[i].c_str() );
+	}
+	t.remove = idLib::sys->GetMicroseconds() - start;
+	HashMapTest_Report( "idHashTable<idStr>", t, numKeys, table->Allocated() );
+	delete table;
+
+	map.Reserve( numKeys );
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		map.Set( keys[i], i );
+	}
+	t.insert = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += ( map.Find( keys[i].c_str() ) != NULL );
+	}
+	t.hit = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += ( map.Find( misses[i].c_str() ) != NULL );
+	}
+	t.miss = idLib::sys->GetMicroseconds() - start;
+	start = idLib::sys->GetMicroseconds();
+	for ( i = 0; i < numKeys; i++ ) {
+		found += map.Remove( keys[i].c_str() );
+	}
+	t.remove = idLib::sys->GetMicroseconds() - start;
+	HashMapTest_Report( "idFlatHashMap<idStr>", t, numKeys, map.Allocated() );
+
+	if ( found != numKeys * 4 ) {
+		idLib::common->Warning( "HashMap_Test_f: found %d of %d string keys", found, numKeys * 4 );
+	}
+}
+
+/*
+================
+HashMap_Test_f
+================
+*/
+void HashMap_Test_f( const idCmdArgs &args ) {
+	int numKeys = args.Argc() > 1 ? atoi( args.Argv( 1 ) ) : 65536;
+
+	numKeys = idMath::ClampInt( 16, HASHMAP_TEST_MAX_KEYS, numKeys );
+
+	idLib::common->Printf( "Testing hash maps with %d keys%s...\n", numKeys,
+#ifdef ID_FLATHASH_SSE2
+		", SSE2 probing"
+#else
+		""
+#endif
+		);
+
+	HashMapTest_Ints( numKeys );
+	HashMapTest_Strings( numKeys );
+}
+
+/*
+===============================================================================
+
+	Concurrent queues
+
+===============================================================================
+*/
+
+#define QUEUE_TEST_MAX_THREADS		8
+#define QUEUE_TEST_SIZE				1024
+#define QUEUE_TEST_LATENCY_SAMPLE	64			// every 64th item carries a time stamp
+#define QUEUE_TEST_SPINS			64			// failed pushes or pops before giving up the time slice
+
+typedef enum {
+	QUEUETEST_SPSC,
+	QUEUETEST_MPMC,
+	QUEUETEST_LOCKED
+} queueTestMode_t;
+
+typedef struct queueTestItem_s {
+	int						producer;
+	int						sequence;
+	double					sent;
+} queueTestItem_t;
+
+typedef struct queueTestShared_s {
+	queueTestMode_t			mode;
+	int						numItems;			// per thread
+	int						numProducers;
+	volatile unsigned int	go;
+	idSPSCQueue<queueTestItem_t>	spsc;
+	idMPMCQueue<queueTestItem_t>	mpmc;
+	queueTestItem_t			locked[QUEUE_TEST_SIZE];	// ring behind CRITICAL_SECTION_ONE
+	int						lockedHead;
+	int						lockedTail;
+} queueTestShared_t;
+
+typedef struct queueTestThread_s {
+	queueTestShared_t *		shared;
+	int						index;
+	unsigned int			sequenceSum;
+	int						orderErrors;
+	int						numLatencies;
+	double					latencySum;
+	double					latencyMax;
+	xthreadInfo				thread;
+} queueTestThread_t;
+
+/*
+================
+QueueTest_Push
+================
+*/
+static bool QueueTest_Push( queueTestShared_t *shared, const queueTestItem_t &item ) {
+	bool ok;
+
+	switch( shared->mode ) {
+		case QUEUETEST_SPSC:
+			return shared->spsc.Push( item );
+		case QUEUETEST_MPMC:
+			return shared->mpmc.Push( item );
+		default:
+			Sys_EnterCriticalSection( CRITICAL_SECTION_ONE );
+			ok = ( shared->lockedTail - shared->lockedHead < QUEUE_TEST_SIZE );
+			if ( ok ) {
+				shared->locked[shared->lockedTail++ & ( QUEUE_TEST_SIZE - 1 )] = item;
+			}
+			Sys_LeaveCriticalSection( CRITICAL_SECTION_ONE );
+			return ok;
+	}
+}
+
+/*
+================
+QueueTest_Pop
+================
+*/
+static bool QueueTest_Pop( queueTestShared_t *shared, queueTestItem_t &item ) {
+	bool ok;
+
+	switch( shared->mode ) {
+		case QUEUETEST_SPSC:
+			return shared->spsc.Pop( item );
+		case QUEUETEST_MPMC:
+			return shared->mpmc.Pop( item );
+		default:
+			Sys_EnterCriticalSection( CRITICAL_SECTION_ONE );
+			ok = ( shared->lockedTail != shared->lockedHead );
+			if ( ok ) {
+				item = shared->locked[shared->lockedHead++ & ( QUEUE_TEST_SIZE - 1 )];
+			}
+			Sys_LeaveCriticalSection( CRITICAL_SECTION_ONE );
+			return ok;
+	}
+}
+
+/*
+================
+QueueTest_Producer
+================
+*/
+static int QueueTest_Producer( void *parms ) {
+	queueTestThread_t *test = (queueTestThread_t *)parms;
+	queueTestShared_t *shared = test->shared;
+	queueTestItem_t item;
+	int i, spins;
+
+	while ( !Queue_AtomicLoad( shared->go ) ) {
+	}
+
+	item.producer = test->index;
+	for ( i = 0; i < shared->numItems; i++ ) {
+		item.sequence = i;
+		item.sent = ( i % QUEUE_TEST_LATENCY_SAMPLE ) ? 0.0 : idLib::sys->GetMicroseconds();
+		for ( spins = 0; !QueueTest_Push( shared, item ); spins++ ) {
+			if ( spins >= QUEUE_TEST_SPINS ) {
+				Sys_Sleep( 0 );
+				spins = 0;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+================
+QueueTest_Consumer
+
+  Every consumer takes as many items as one producer sends. Items of one
+  producer must come out of the queue in the order they went in.
+================
+*/
+static int QueueTest_Consumer( void *parms ) {
+	queueTestThread_t *test = (queueTestThread_t *)parms;
+	queueTestShared_t *shared = test->shared;
+	queueTestItem_t item;
+	int lastSequence[QUEUE_TEST_MAX_THREADS];
+	int i, spins;
+	double latency;
+
+	for ( i = 0; i < QUEUE_TEST_MAX_THREADS; i++ ) {
+		lastSequence[i] = -1;
+	}
+
+	while ( !Queue_AtomicLoad( shared->go ) ) {
+	}
+
+	for ( i = 0; i < shared->numItems; i++ ) {
+		for ( spins = 0; !QueueTest_Pop( shared, item ); spins++ ) {
+			if ( spins >= QUEUE_TEST_SPINS ) {
+				Sys_Sleep( 0 );
+				spins = 0;
+			}
+		}
+		if ( item.sequence <= lastSequence[item.producer] ) {
+			test->orderErrors++;
+		}
+		lastSequence[item.producer] = item.sequence;
+		test->sequenceSum += item.sequence;
+		if ( item.sent != 0.0 ) {
+			latency = idLib::sys->GetMicroseconds() - item.sent;
+			test->latencySum += latency;
+			test->latencyMax = Max( test->latencyMax, latency );
+			test->numLatencies++;
+		}
+	}
+	return 0;
+}
+
+/*
+================
+QueueTest_Mode
+================
+*/
+static void QueueTest_Mode( const char *name, queueTestShared_t *shared, queueTestMode_t mode, int numThreads, int numItems ) {
+	queueTestThread_t threads[QUEUE_TEST_MAX_THREADS * 2];
+	unsigned int sequenceSum, expectedSum;
+	int i, orderErrors, numLatencies;
+	double start, usec, latencySum, latencyMax;
+
+	memset( threads, 0, sizeof( threads ) );
+
+	shared->mode = mode;
+	shared->numItems = numItems;
+	shared->numProducers = numThreads;
+	shared->go = 0;
+	shared->spsc.Init( QUEUE_TEST_SIZE );
+	shared->mpmc.Init( QUEUE_TEST_SIZE );
+	shared->lockedHead = shared->lockedTail = 0;
+
+	// consumers first so the producers don't start against a queue nobody empties
+	for ( i = 0; i < numThreads * 2; i++ ) {
+		threads[i].shared = shared;
+		threads[i].index = i >> 1;
+		Sys_CreateThread( ( i & 1 ) ? QueueTest_Producer : QueueTest_Consumer, &threads[i], threads[i].thread, ( i & 1 ) ? "queueProducer" : "queueConsumer" );
+	}
+
+	start = idLib::sys->GetMicroseconds();
+	Queue_AtomicStore( shared->go, 1 );
+	for ( i = 0; i < numThreads * 2; i++ ) {
+		Sys_DestroyThread( threads[i].thread );
+	}
+	usec = idLib::sys->GetMicroseconds() - start;
+
+	sequenceSum = 0;
+	orderErrors = numLatencies = 0;
+	latencySum = latencyMax = 0.0;
+	for ( i = 0; i < numThreads * 2; i += 2 ) {
+		sequenceSum += threads[i].sequenceSum;
+		orderErrors += threads[i].orderErrors;
+		numLatencies += threads[i].numLatencies;
+		latencySum += threads[i].latencySum;
+		latencyMax = Max( latencyMax, threads[i].latencyMax );
+	}
+	expectedSum = 0;
+	for ( i = 0; i < numItems; i++ ) {
+		expectedSum += i;
+	}
+	expectedSum *= numThreads;
+
+	idLib::common->Printf( "%-8s %dx%d %10.2f ms %8.2f Mitems/s latency avg %8.2f usec max %10.2f usec\n", name, numThreads, numThreads,
+		usec * 0.001, (double)numThreads * numItems / usec, numLatencies ? latencySum / numLatencies : 0.0, latencyMax );
+
+	if ( sequenceSum != expectedSum || orderErrors ) {
+		idLib::common->Warning( "Queue_Test_f: %s lost or reordered items, %d out of order", name, orderErrors );
+	}
+}
+
+/*
+================
+Queue_Test_f
+================
+*/
+void Queue_Test_f( const idCmdArgs &args ) {
+	int maxThreads = args.Argc() > 1 ? atoi( args.Argv( 1 ) ) : QUEUE_TEST_MAX_THREADS;
+	int numItems = args.Argc() > 2 ? atoi( args.Argv( 2 ) ) : 1000000;
+	queueTestShared_t *shared;
+	int n;
+
+	maxThreads = idMath::ClampInt( 1, QUEUE_TEST_MAX_THREADS, maxThreads );
+	numItems = Max( numItems, 1 );
+
+	idLib::common->Printf( "Testing queues of %d items with %d items per producer...\n", QUEUE_TEST_SIZE, numItems );
+
+	shared = new queueTestShared_t;
+
+	QueueTest_Mode( "spsc", shared, QUEUETEST_SPSC, 1, numItems );
+	for ( n = 1; n <= maxThreads; n <<= 1 ) {
+		QueueTest_Mode( "mpmc", shared, QUEUETEST_MPMC, n, numItems );
+		QueueTest_Mode( "locked", shared, QUEUETEST_LOCKED, n, numItems );
+	}
+
+	delete shared;
+}
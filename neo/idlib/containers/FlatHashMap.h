@@ -0,0 +1,602 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __FLATHASHMAP_H__
+#define __FLATHASHMAP_H__
+
+#include "idlib/math/Math.h"
+#include "idlib/Str.h"
+#include "idlib/containers/List.h"
+
+#if ( defined(__GNUC__) && defined(__SSE2__) ) || ( defined(_MSC_VER) && ( defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) ) )
+#define ID_FLATHASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+===============================================================================
+
+	Flat hash map.
+
+	Open addressing with linear probing. The keys and values are stored in one
+	array of entries and there is one control byte per entry, either empty or
+	7 bits of the hash of the key in the entry. A lookup checks the control
+	bytes of 16 consecutive entries at a time, with SSE2 when available, and
+	only compares keys for entries with a matching tag.
+
+	Removing an entry shifts the entries behind it back into the hole instead
+	of leaving a tombstone, so probe sequences never get longer from removals.
+	The map grows to keep at least one entry in eight empty.
+
+	Entries move when the map grows or an entry is removed, pointers to values
+	are only valid until the next Set or Remove.
+
+===============================================================================
+*/
+
+/*
+================
+idFlatHashTraits
+
+  Hash and compare for keys that convert to int, specialize for other key types.
+================
+*/
+template< class type >
+class idFlatHashTraits {
+public:
+	static int		Hash( const type &key ) { return (int)key; }
+	static bool		Compare( const type &a, const type &b ) { return a == b; }
+};
+
+template<>
+class idFlatHashTraits<idStr> {
+public:
+	static int		Hash( const char *key ) {
+						unsigned int hash = 2166136261u;		// FNV-1a
+						while ( *key ) {
+							hash = ( hash ^ (byte)*key++ ) * 16777619u;
+						}
+						return (int)hash;
+					}
+	static int		Hash( const idStr &key ) { return Hash( key.c_str() ); }
+	static bool		Compare( const idStr &a, const char *b ) { return idStr::Cmp( a.c_str(), b ) == 0; }
+	static bool		Compare( const idStr &a, const idStr &b ) { return a.Length() == b.Length() && idStr::Cmp( a.c_str(), b.c_str() ) == 0; }
+};
+
+template< class keyType, class valueType, class traits = idFlatHashTraits<keyType> >
+class idFlatHashMap {
+public:
+					idFlatHashMap( void );
+					idFlatHashMap( const idFlatHashMap &map );
+					~idFlatHashMap( void );
+
+	idFlatHashMap &	operator=( const idFlatHashMap &map );
+
+					// returns total size of allocated memory
+	size_t			Allocated( void ) const;
+					// returns total size of allocated memory including size of the map type
+	size_t			Size( void ) const;
+
+					// makes room for num entries so the map doesn't grow until there are more
+	void			Reserve( int numEntries );
+					// adds the key or replaces the value of the key, returns the stored value
+	valueType &		Set( const keyType &key, const valueType &value );
+					// returns NULL if the key is not in the map
+	template< class lookupType >
+	valueType *		Find( const lookupType &key ) const;
+					// returns false if the key is not in the map
+	template< class lookupType >
+	bool			Remove( const lookupType &key );
+					// removes all entries, keeps the memory
+	void			Clear( void );
+					// removes all entries and frees the memory
+	void			Free( void );
+
+	int				Num( void ) const { return num; }
+
+					// the entries can be iterated over with slot numbers in [0, GetCapacity()),
+					// the slot of an entry changes when the map grows or entries are removed
+	int				GetCapacity( void ) const { return capacity; }
+	bool			IsUsed( int slot ) const { return ( ctrl[slot] & CTRL_EMPTY ) == 0; }
+	const keyType &	GetKey( int slot ) const { return slots[slot].key; }
+	valueType &		GetValue( int slot ) const { return slots[slot].value; }
+
+private:
+	enum {
+		GROUP_SIZE		= 16,					// control bytes checked at once
+		MIN_CAPACITY	= GROUP_SIZE,
+		CTRL_EMPTY		= 0x80
+	};
+
+	typedef struct entry_s {
+		keyType			key;
+		valueType		value;
+		int				hash;
+	} entry_t;
+
+	byte *			ctrl;						// capacity + GROUP_SIZE bytes, the first GROUP_SIZE bytes repeat at the end
+	entry_t *		slots;
+	int				capacity;					// power of two
+	int				mask;
+	int				num;
+	int				maxNum;						// grow when there are more entries
+
+	template< class lookupType >
+	int				FindSlot( const lookupType &key, int hash ) const;
+	int				FindEmptySlot( int hash ) const;
+	void			SetCtrl( int slot, byte c );
+	void			Rehash( int newCapacity );
+
+	static int		MixHash( int hash );
+	static byte		Tag( int hash ) { return (byte)( (unsigned int)hash >> 25 ); }
+	static int		MatchByte( const byte *group, byte b );
+	static int		MatchEmpty( const byte *group );
+	static int		LowestBit( int bits );
+};
+
+/*
+================
+idFlatHashMap::idFlatHashMap
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE idFlatHashMap<keyType,valueType,traits>::idFlatHashMap( void ) {
+	ctrl = NULL;
+	slots = NULL;
+	capacity = 0;
+	mask = 0;
+	num = 0;
+	maxNum = 0;
+}
+
+/*
+================
+idFlatHashMap::idFlatHashMap
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE idFlatHashMap<keyType,valueType,traits>::idFlatHashMap( const idFlatHashMap &map ) {
+	ctrl = NULL;
+	slots = NULL;
+	capacity = 0;
+	mask = 0;
+	num = 0;
+	maxNum = 0;
+	*this = map;
+}
+
+/*
+================
+idFlatHashMap::~idFlatHashMap
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE idFlatHashMap<keyType,valueType,traits>::~idFlatHashMap( void ) {
+	Free();
+}
+
+/*
+================
+idFlatHashMap::operator=
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE idFlatHashMap<keyType,valueType,traits> &idFlatHashMap<keyType,valueType,traits>::operator=( const idFlatHashMap &map ) {
+	int i;
+
+	if ( this == &map ) {
+		return *this;
+	}
+
+	Free();
+
+	if ( map.capacity ) {
+		capacity = map.capacity;
+		mask = map.mask;
+		maxNum = map.maxNum;
+		num = map.num;
+		ctrl = new byte[capacity + GROUP_SIZE];
+		slots = new entry_t[capacity];
+		memcpy( ctrl, map.ctrl, capacity + GROUP_SIZE );
+		for ( i = 0; i < capacity; i++ ) {
+			if ( IsUsed( i ) ) {
+				slots[i] = map.slots[i];
+			}
+		}
+	}
+
+	return *this;
+}
+
+/*
+================
+idFlatHashMap::Allocated
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE size_t idFlatHashMap<keyType,valueType,traits>::Allocated( void ) const {
+	if ( !capacity ) {
+		return 0;
+	}
+	return capacity * sizeof( entry_t ) + capacity + GROUP_SIZE;
+}
+
+/*
+================
+idFlatHashMap::Size
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE size_t idFlatHashMap<keyType,valueType,traits>::Size( void ) const {
+	return sizeof( *this ) + Allocated();
+}
+
+/*
+================
+idFlatHashMap::Reserve
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE void idFlatHashMap<keyType,valueType,traits>::Reserve( int numEntries ) {
+	int newCapacity;
+
+	newCapacity = MIN_CAPACITY;
+	while ( newCapacity - ( newCapacity >> 3 ) < numEntries ) {
+		newCapacity <<= 1;
+	}
+	if ( newCapacity > capacity ) {
+		Rehash( newCapacity );
+	}
+}
+
+/*
+================
+idFlatHashMap::Set
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE valueType &idFlatHashMap<keyType,valueType,traits>::Set( const keyType &key, const valueType &value ) {
+	int hash, slot;
+
+	hash = MixHash( traits::Hash( key ) );
+	slot = num ? FindSlot( key, hash ) : -1;
+	if ( slot < 0 ) {
+		if ( num >= maxNum ) {
+			Rehash( capacity ? capacity << 1 : MIN_CAPACITY );
+		}
+		slot = FindEmptySlot( hash );
+		SetCtrl( slot, Tag( hash ) );
+		slots[slot].key = key;
+		slots[slot].hash = hash;
+		num++;
+	}
+	slots[slot].value = value;
+	return slots[slot].value;
+}
+
+/*
+================
+idFlatHashMap::Find
+================
+*/
+template< class keyType, class valueType, class traits >
+template< class lookupType >
+ID_INLINE valueType *idFlatHashMap<keyType,valueType,traits>::Find( const lookupType &key ) const {
+	int slot;
+
+	if ( !num ) {
+		return NULL;
+	}
+	slot = FindSlot( key, MixHash( traits::Hash( key ) ) );
+	if ( slot < 0 ) {
+		return NULL;
+	}
+	return &slots[slot].value;
+}
+
+/*
+================
+idFlatHashMap::Remove
+
+  Moves every entry behind the removed one that may live closer to its home
+  slot back into the hole, so lookups still stop at the first empty slot.
+================
+*/
+template< class keyType, class valueType, class traits >
+template< class lookupType >
+ID_INLINE bool idFlatHashMap<keyType,valueType,traits>::Remove( const lookupType &key ) {
+	int hole, next, home;
+
+	if ( !num ) {
+		return false;
+	}
+	hole = FindSlot( key, MixHash( traits::Hash( key ) ) );
+	if ( hole < 0 ) {
+		return false;
+	}
+
+	for ( next = ( hole + 1 ) & mask; !( ctrl[next] & CTRL_EMPTY ); next = ( next + 1 ) & mask ) {
+		home = slots[next].hash & mask;
+		// stays if its home slot is after the hole
+		if ( ( ( next - home ) & mask ) < ( ( next - hole ) & mask ) ) {
+			continue;
+		}
+		slots[hole].key = idMove( slots[next].key );
+		slots[hole].value = idMove( slots[next].value );
+		slots[hole].hash = slots[next].hash;
+		SetCtrl( hole, ctrl[next] );
+		hole = next;
+	}
+
+	SetCtrl( hole, CTRL_EMPTY );
+	slots[hole].key = keyType();
+	slots[hole].value = valueType();
+	num--;
+	return true;
+}
+
+/*
+================
+idFlatHashMap::Clear
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE void idFlatHashMap<keyType,valueType,traits>::Clear( void ) {
+	int i;
+
+	if ( !num ) {
+		return;
+	}
+	for ( i = 0; i < capacity; i++ ) {
+		if ( IsUsed( i ) ) {
+			slots[i].key = keyType();
+			slots[i].value = valueType();
+		}
+	}
+	memset( ctrl, CTRL_EMPTY, capacity + GROUP_SIZE );
+	num = 0;
+}
+
+/*
+================
+idFlatHashMap::Free
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE void idFlatHashMap<keyType,valueType,traits>::Free( void ) {
+	delete[] ctrl;
+	delete[] slots;
+	ctrl = NULL;
+	slots = NULL;
+	capacity = 0;
+	mask = 0;
+	num = 0;
+	maxNum = 0;
+}
+
+/*
+================
+idFlatHashMap::FindSlot
+
+  Returns -1 if the key is not in the map, the map must not be empty.
+================
+*/
+template< class keyType, class valueType, class traits >
+template< class lookupType >
+ID_INLINE int idFlatHashMap<keyType,valueType,traits>::FindSlot( const lookupType &key, int hash ) const {
+	int pos, slot, matches, empties;
+	byte tag;
+
+	tag = Tag( hash );
+	pos = hash & mask;
+	while( 1 ) {
+		matches = MatchByte( ctrl + pos, tag );
+		empties = MatchEmpty( ctrl + pos );
+		if ( empties ) {
+			// the probe sequence ends at the first empty slot
+			matches &= ( empties & -empties ) - 1;
+		}
+		while ( matches ) {
+			slot = ( pos + LowestBit( matches ) ) & mask;
+			if ( slots[slot].hash == hash && traits::Compare( slots[slot].key, key ) ) {
+				return slot;
+			}
+			matches &= matches - 1;
+		}
+		if ( empties ) {
+			return -1;
+		}
+		pos = ( pos + GROUP_SIZE ) & mask;
+	}
+}
+
+/*
+================
+idFlatHashMap::FindEmptySlot
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE int idFlatHashMap<keyType,valueType,traits>::FindEmptySlot( int hash ) const {
+	int pos, empties;
+
+	pos = hash & mask;
+	while( 1 ) {
+		empties = MatchEmpty( ctrl + pos );
+		if ( empties ) {
+			return ( pos + LowestBit( empties ) ) & mask;
+		}
+		pos = ( pos + GROUP_SIZE ) & mask;
+	}
+}
+
+/*
+================
+idFlatHashMap::SetCtrl
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE void idFlatHashMap<keyType,valueType,traits>::SetCtrl( int slot, byte c ) {
+	ctrl[slot] = c;
+	if ( slot < GROUP_SIZE ) {
+		ctrl[capacity + slot] = c;
+	}
+}
+
+/*
+================
+idFlatHashMap::Rehash
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE void idFlatHashMap<keyType,valueType,traits>::Rehash( int newCapacity ) {
+	byte *oldCtrl;
+	entry_t *oldSlots;
+	int i, oldCapacity, slot;
+
+	assert( idMath::IsPowerOfTwo( newCapacity ) && newCapacity >= MIN_CAPACITY );
+
+	oldCtrl = ctrl;
+	oldSlots = slots;
+	oldCapacity = capacity;
+
+	capacity = newCapacity;
+	mask = capacity - 1;
+	maxNum = capacity - ( capacity >> 3 );
+	ctrl = new byte[capacity + GROUP_SIZE];
+	slots = new entry_t[capacity];
+	memset( ctrl, CTRL_EMPTY, capacity + GROUP_SIZE );
+
+	for ( i = 0; i < oldCapacity; i++ ) {
+		if ( oldCtrl[i] & CTRL_EMPTY ) {
+			continue;
+		}
+		slot = FindEmptySlot( oldSlots[i].hash );
+		SetCtrl( slot, oldCtrl[i] );
+		slots[slot].key = idMove( oldSlots[i].key );
+		slots[slot].value = idMove( oldSlots[i].value );
+		slots[slot].hash = oldSlots[i].hash;
+	}
+
+	delete[] oldCtrl;
+	delete[] oldSlots;
+}
+
+/*
+================
+idFlatHashMap::MixHash
+
+  Spreads the key hash over all bits, the low bits pick the home slot and the top 7 bits are the tag.
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE int idFlatHashMap<keyType,valueType,traits>::MixHash( int hash ) {
+	unsigned int h = (unsigned int)hash;
+
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return (int)h;
+}
+
+/*
+================
+idFlatHashMap::MatchByte
+
+  Returns a bit for every control byte in the group equal to b.
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE int idFlatHashMap<keyType,valueType,traits>::MatchByte( const byte *group, byte b ) {
+#ifdef ID_FLATHASH_SSE2
+	__m128i g = _mm_loadu_si128( (const __m128i *)group );
+	return _mm_movemask_epi8( _mm_cmpeq_epi8( g, _mm_set1_epi8( (char)b ) ) );
+#else
+	int i, bits;
+
+	bits = 0;
+	for ( i = 0; i < GROUP_SIZE; i++ ) {
+		bits |= ( group[i] == b ) << i;
+	}
+	return bits;
+#endif
+}
+
+/*
+================
+idFlatHashMap::MatchEmpty
+
+  Returns a bit for every empty slot in the group, tags never have the high bit set.
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE int idFlatHashMap<keyType,valueType,traits>::MatchEmpty( const byte *group ) {
+#ifdef ID_FLATHASH_SSE2
+	return _mm_movemask_epi8( _mm_loadu_si128( (const __m128i *)group ) );
+#else
+	int i, bits;
+
+	bits = 0;
+	for ( i = 0; i < GROUP_SIZE; i++ ) {
+		bits |= ( group[i] >> 7 ) << i;
+	}
+	return bits;
+#endif
+}
+
+/*
+================
+idFlatHashMap::LowestBit
+================
+*/
+template< class keyType, class valueType, class traits >
+ID_INLINE int idFlatHashMap<keyType,valueType,traits>::LowestBit( int bits ) {
+	assert( bits != 0 );
+#if defined(__GNUC__)
+	return __builtin_ctz( (unsigned int)bits );
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward( &index, (unsigned long)bits );
+	return (int)index;
+#else
+	int i;
+	for ( i = 0; !( bits & ( 1 << i ) ); i++ ) {
+	}
+	return i;
+#endif
+}
+
+// times idHashIndex, idHashTable and idFlatHashMap with integer and string keys
+void		HashMap_Test_f( const class idCmdArgs &args );
+
+#endif /* !__FLATHASHMAP_H__ */
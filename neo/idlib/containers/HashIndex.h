@@ -31,6 +31,7 @@ If you have questions concerning this license or the applicable additional terms
 
 #include "idlib/math/Vector.h"
 #include "idlib/Str.h"
+#include "idlib/hashing/SipHash.h"
 
 /*
 ===============================================================================
@@ -48,6 +49,10 @@ class idHashIndex {
 public:
 					idHashIndex( void );
 					idHashIndex( const int initialHashSize, const int initialIndexSize );
+					idHashIndex( const idHashIndex &other );
+#ifdef ID_MOVE_SEMANTICS
+					idHashIndex( idHashIndex &&other );
+#endif
 					~idHashIndex( void );
 
 					// returns total size of allocated memory
@@ -56,6 +61,10 @@ public:
 	size_t			Size( void ) const;
 
 	idHashIndex &	operator=( const idHashIndex &other );
+#ifdef ID_MOVE_SEMANTICS
+					// take over the hash and index chain of other, leaving other empty
+	idHashIndex &	operator=( idHashIndex &&other );
+#endif
 					// add an index to the hash, assumes the index has not yet been added to the hash
 	void			Add( const int key, const int index );
 					// remove an index from the hash
@@ -90,6 +99,8 @@ public:
 	int				GenerateKey( const idVec3 &v ) const;
 					// returns a key for two integers
 	int				GenerateKey( const int n1, const int n2 ) const;
+					// returns a keyed hash for untrusted data, use for anything received from the network
+	int				GenerateSecureKey( const void *data, int length ) const;
 
 private:
 	int				hashSize;
@@ -104,6 +115,7 @@ private:
 
 	void			Init( const int initialHashSize, const int initialIndexSize );
 	void			Allocate( const int newHashSize, const int newIndexSize );
+	void			Steal( idHashIndex &other );
 };
 
 /*
@@ -124,6 +136,28 @@ ID_INLINE idHashIndex::idHashIndex( const int initialHashSize, const int initial
 	Init( initialHashSize, initialIndexSize );
 }
 
+/*
+================
+idHashIndex::idHashIndex
+================
+*/
+ID_INLINE idHashIndex::idHashIndex( const idHashIndex &other ) {
+	Init( other.hashSize, other.indexSize );
+	*this = other;
+}
+
+#ifdef ID_MOVE_SEMANTICS
+/*
+================
+idHashIndex::idHashIndex
+================
+*/
+ID_INLINE idHashIndex::idHashIndex( idHashIndex &&other ) {
+	Init( other.hashSize, other.indexSize );
+	Steal( other );
+}
+#endif
+
 /*
 ================
 idHashIndex::~idHashIndex
@@ -188,6 +222,43 @@ ID_INLINE idHashIndex &idHashIndex::operator=( const idHashIndex &other ) {
 	return *this;
 }
 
+/*
+================
+idHashIndex::Steal
+
+  frees this index and takes over the allocations of other, other is left empty
+================
+*/
+ID_INLINE void idHashIndex::Steal( idHashIndex &other ) {
+	Free();
+
+	hashSize = other.hashSize;
+	hash = other.hash;
+	indexSize = other.indexSize;
+	indexChain = other.indexChain;
+	granularity = other.granularity;
+	hashMask = other.hashMask;
+	lookupMask = other.lookupMask;
+
+	other.hash = INVALID_INDEX;
+	other.indexChain = INVALID_INDEX;
+	other.lookupMask = 0;
+}
+
+#ifdef ID_MOVE_SEMANTICS
+/*
+================
+idHashIndex::operator=
+================
+*/
+ID_INLINE idHashIndex &idHashIndex::operator=( idHashIndex &&other ) {
+	if ( this != &other ) {
+		Steal( other );
+	}
+	return *this;
+}
+#endif
+
 /*
 ================
 idHashIndex::Add
@@ -396,6 +467,15 @@ ID_INLINE int idHashIndex::GenerateKey( const idVec3 &v ) const {
 	return ( (((int) v[0]) + ((int) v[1]) + ((int) v[2])) & hashMask );
 }
 
+/*
+================
+idHashIndex::GenerateSecureKey
+================
+*/
+ID_INLINE int idHashIndex::GenerateSecureKey( const void *data, int length ) const {
+	return ( (int) SipHash_BlockChecksum( data, length ) & hashMask );
+}
+
 /*
 ================
 idHashIndex::GenerateKey
@@ -30,11 +30,14 @@ If you have questions concerning this license or the applicable additional terms
 #define __LIST_H__
 
 #include "sys/platform.h"
+#include "idlib/Arena.h"
+
 /*
 ===============================================================================
 
 	List template
 	Does not allocate memory until the first item is added.
+	Memory comes from the heap unless an arena is set with SetArena.
 
 ===============================================================================
 */
@@ -69,6 +72,26 @@ ID_INLINE type *idListNewElement( void ) {
 	return new type;
 }
 
+/*
+================
+idMove<type>
+
+Lets an assignment take over the memory of an object that is overwritten or destroyed next.
+Without move semantics it is a plain copy.
+================
+*/
+#ifdef ID_MOVE_SEMANTICS
+template< class type >
+ID_INLINE type &&idMove( type &a ) {
+	return static_cast<type &&>( a );
+}
+#else
+template< class type >
+ID_INLINE type &idMove( type &a ) {
+	return a;
+}
+#endif
+
 /*
 ================
 idSwap<type>
@@ -76,11 +99,50 @@ idSwap<type>
 */
 template< class type >
 ID_INLINE void idSwap( type &a, type &b ) {
-	type c = a;
-	a = b;
-	b = c;
+	type c = idMove( a );
+	a = idMove( b );
+	b = idMove( c );
 }
 
+/*
+================
+idListRelocate<type,trivial>
+
+Moves or copies elements of a list, one assignment at a time unless the type
+is trivially copyable. Picked at compile time so memcpy is never compiled for
+types with their own assignment.
+================
+*/
+template< class type, bool trivial >
+class idListRelocate {
+public:
+	static void Move( type *to, type *from, int num ) {
+		for ( int i = 0; i < num; i++ ) {
+			to[i] = idMove( from[i] );
+		}
+	}
+	static void Copy( type *to, const type *from, int num ) {
+		for ( int i = 0; i < num; i++ ) {
+			to[i] = from[i];
+		}
+	}
+};
+
+template< class type >
+class idListRelocate<type, true> {
+public:
+	static void Move( type *to, type *from, int num ) {
+		if ( num > 0 ) {
+			memcpy( to, from, num * sizeof( type ) );
+		}
+	}
+	static void Copy( type *to, const type *from, int num ) {
+		if ( num > 0 ) {
+			memcpy( to, from, num * sizeof( type ) );
+		}
+	}
+};
+
 template< class type >
 class idList {
 public:
@@ -90,6 +152,9 @@ public:
 
 					idList( int newgranularity = 16 );
 					idList( const idList<type> &other );
+#ifdef ID_MOVE_SEMANTICS
+					idList( idList<type> &&other );
+#endif
 					~idList<type>( void );
 
 	void			Clear( void );										// clear the list
@@ -97,12 +162,17 @@ public:
 	int				NumAllocated( void ) const;							// returns number of elements allocated for
 	void			SetGranularity( int newgranularity );				// set new granularity
 	int				GetGranularity( void ) const;						// get the current granularity
+	void			SetArena( idArena *newArena );						// clears the list and takes future memory from the arena, NULL for the heap
+	idArena *		GetArena( void ) const { return arena; }
 
 	size_t			Allocated( void ) const;							// returns total size of allocated memory
 	size_t			Size( void ) const;									// returns total size of allocated memory including size of list type
 	size_t			MemoryUsed( void ) const;							// returns size of the used elements in the list
 
 	idList<type> &	operator=( const idList<type> &other );
+#ifdef ID_MOVE_SEMANTICS
+	idList<type> &	operator=( idList<type> &&other );					// takes over the memory of other and leaves it empty
+#endif
 	const type &	operator[]( int index ) const;
 	type &			operator[]( int index );
 
@@ -137,6 +207,12 @@ private:
 	int				size;
 	int				granularity;
 	type *			list;
+	idArena *		arena;
+
+	type *			AllocList( int num );
+	void			FreeList( type *oldList, int num );
+	static void		MoveElements( type *to, type *from, int num );
+	static void		CopyElements( type *to, const type *from, int num );
 };
 
 /*
@@ -149,6 +225,7 @@ ID_INLINE idList<type>::idList( int newgranularity ) {
 	assert( newgranularity > 0 );
 
 	list		= NULL;
+	arena		= NULL;
 	granularity	= newgranularity;
 	Clear();
 }
@@ -161,9 +238,26 @@ idList<type>::idList( const idList<type> &other )
 template< class type >
 ID_INLINE idList<type>::idList( const idList<type> &other ) {
 	list = NULL;
+	arena = NULL;
 	*this = other;
 }
 
+#ifdef ID_MOVE_SEMANTICS
+/*
+================
+idList<type>::idList( idList<type> &&other )
+================
+*/
+template< class type >
+ID_INLINE idList<type>::idList( idList<type> &&other ) {
+	list = NULL;
+	arena = NULL;
+	granularity = other.granularity;
+	num = size = 0;
+	Swap( other );
+}
+#endif
+
 /*
 ================
 idList<type>::~idList<type>
@@ -184,7 +278,7 @@ Frees up the memory allocated by the list.  Assumes that type automatically hand
 template< class type >
 ID_INLINE void idList<type>::Clear( void ) {
 	if ( list ) {
-		delete[] list;
+		FreeList( list, size );
 	}
 
 	list	= NULL;
@@ -354,7 +448,7 @@ ID_INLINE void idList<type>::Condense( void ) {
 idList<type>::Resize
 
 Allocates memory for the amount of elements requested while keeping the contents intact.
-Contents are copied using their = operator so that data is correnctly instantiated.
+Contents are moved using their = operator, or copied with memcpy when the type is plain data.
 ================
 */
 #pragma GCC diagnostic push
@@ -364,7 +458,7 @@ Contents are copied using their = operator so that data is correnctly instantiat
 template< class type >
 ID_INLINE void idList<type>::Resize( int newsize ) {
 	type	*temp;
-	int		i;
+	int		oldsize;
 
 	assert( newsize >= 0 );
 
@@ -380,21 +474,20 @@ ID_INLINE void idList<type>::Resize( int newsize ) {
 	}
 
 	temp	= list;
+	oldsize	= size;
 	size	= newsize;
 
 	if ( size < num ) {
 		num = size;
 	}
 
-	// copy the old list into our new one
-	list = new type[ size ];
-	for( i = 0; i < num; i++ ) {
-		list[ i ] = temp[ i ];
-	}
+	// move the old list into our new one
+	list = AllocList( size );
+	MoveElements( list, temp, num );
 
 	// delete the old list if it exists
 	if ( temp ) {
-		delete[] temp;
+		FreeList( temp, oldsize );
 	}
 }
 #pragma GCC diagnostic pop
@@ -404,13 +497,13 @@ ID_INLINE void idList<type>::Resize( int newsize ) {
 idList<type>::Resize
 
 Allocates memory for the amount of elements requested while keeping the contents intact.
-Contents are copied using their = operator so that data is correnctly instantiated.
+Contents are moved using their = operator, or copied with memcpy when the type is plain data.
 ================
 */
 template< class type >
 ID_INLINE void idList<type>::Resize( int newsize, int newgranularity ) {
 	type	*temp;
-	int		i;
+	int		oldsize;
 
 	assert( newsize >= 0 );
 
@@ -424,20 +517,19 @@ ID_INLINE void idList<type>::Resize( int newsize, int newgranularity ) {
 	}
 
 	temp	= list;
+	oldsize	= size;
 	size	= newsize;
 	if ( size < num ) {
 		num = size;
 	}
 
-	// copy the old list into our new one
-	list = new type[ size ];
-	for( i = 0; i < num; i++ ) {
-		list[ i ] = temp[ i ];
-	}
+	// move the old list into our new one
+	list = AllocList( size );
+	MoveElements( list, temp, num );
 
 	// delete the old list if it exists
 	if ( temp ) {
-		delete[] temp;
+		FreeList( temp, oldsize );
 	}
 }
 
@@ -538,8 +630,6 @@ Copies the contents and size attributes of another list.
 */
 template< class type >
 ID_INLINE idList<type> &idList<type>::operator=( const idList<type> &other ) {
-	int	i;
-
 	Clear();
 
 	num			= other.num;
@@ -547,15 +637,31 @@ ID_INLINE idList<type> &idList<type>::operator=( const idList<type> &other ) {
 	granularity	= other.granularity;
 
 	if ( size ) {
-		list = new type[ size ];
-		for( i = 0; i < num; i++ ) {
-			list[ i ] = other.list[ i ];
-		}
+		list = AllocList( size );
+		CopyElements( list, other.list, num );
 	}
 
 	return *this;
 }
 
+#ifdef ID_MOVE_SEMANTICS
+/*
+================
+idList<type>::operator=
+
+Takes over the memory of the other list, which is left empty.
+================
+*/
+template< class type >
+ID_INLINE idList<type> &idList<type>::operator=( idList<type> &&other ) {
+	if ( this != &other ) {
+		Clear();
+		Swap( other );
+	}
+	return *this;
+}
+#endif
+
 #pragma GCC diagnostic push
 // shut up GCC's stupid "warning: assuming signed overflow does not occur when assuming that
 // (X - c) > X is always false [-Wstrict-overflow]"
@@ -710,7 +816,7 @@ ID_INLINE int idList<type>::Insert( type const & obj, int index ) {
 		index = num;
 	}
 	for ( int i = num; i > index; --i ) {
-		list[i] = list[i-1];
+		list[i] = idMove( list[i-1] );
 	}
 	num++;
 	list[index] = obj;
@@ -871,7 +977,7 @@ ID_INLINE bool idList<type>::RemoveIndex( int index ) {
 
 	num--;
 	for( i = index; i < num; i++ ) {
-		list[ i ] = list[ i + 1 ];
+		list[ i ] = idMove( list[ i + 1 ] );
 	}
 
 	return true;
@@ -957,6 +1063,73 @@ ID_INLINE void idList<type>::Swap( idList<type> &other ) {
 	idSwap( size, other.size );
 	idSwap( granularity, other.granularity );
 	idSwap( list, other.list );
+	idSwap( arena, other.arena );
 }
 
+/*
+================
+idList<type>::SetArena
+
+The list is cleared, memory allocated from now on comes from the arena.
+The list must be cleared or destroyed before the arena is Reset.
+================
+*/
+template< class type >
+ID_INLINE void idList<type>::SetArena( idArena *newArena ) {
+	Clear();
+	arena = newArena;
+}
+
+/*
+================
+idList<type>::AllocList
+================
+*/
+template< class type >
+ID_INLINE type *idList<type>::AllocList( int num ) {
+	if ( arena ) {
+		return arena->AllocArray<type>( num );
+	}
+	return new type[ num ];
+}
+
+/*
+================
+idList<type>::MoveElements
+
+Plain data is copied in one go, anything else is moved element by element.
+================
+*/
+template< class type >
+ID_INLINE void idList<type>::MoveElements( type *to, type *from, int num ) {
+	idListRelocate<type, ID_IS_TRIVIALLY_COPYABLE( type )>::Move( to, from, num );
+}
+
+/*
+================
+idList<type>::CopyElements
+================
+*/
+template< class type >
+ID_INLINE void idList<type>::CopyElements( type *to, const type *from, int num ) {
+	idListRelocate<type, ID_IS_TRIVIALLY_COPYABLE( type )>::Copy( to, from, num );
+}
+
+/*
+================
+idList<type>::FreeList
+================
+*/
+template< class type >
+ID_INLINE void idList<type>::FreeList( type *oldList, int num ) {
+	if ( arena ) {
+		arena->DestroyArray( oldList, num );
+	} else {
+		delete[] oldList;
+	}
+}
+
+// compares copying and moving idList, idStr and idDict
+void		Container_Test_f( const class idCmdArgs &args );
+
 #endif /* !__LIST_H__ */
@@ -0,0 +1,223 @@
+/*
+===========================================================================
+
+Doom 3 GPL Source Code
+Copyright (C) 1999-2011 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 GPL Source Code ("Doom 3 Source Code").
+
+Doom 3 Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#ifndef __SLOTMAP_H__
+#define __SLOTMAP_H__
+
+#include "idlib/Heap.h"
+#include "idlib/containers/List.h"
+
+/*
+===============================================================================
+
+	Slot map.
+
+	Objects live in an idBlockAlloc so they never move once allocated, and
+	are reached through handles made of a slot index and the generation of
+	the slot. Freeing an object bumps the generation of its slot, so a handle
+	held past that point no longer resolves instead of pointing at whatever
+	reuses the slot. A dense array of the live objects is kept for iteration,
+	in no particular order.
+
+	Like idBlockAlloc, objects are constructed once when their block is
+	allocated and keep their contents when they are freed and reused.
+
+===============================================================================
+*/
+
+typedef struct slotHandle_s {
+	int					index;							// slot, -1 for no object
+	int					generation;						// generation of the slot when the handle was made
+
+	bool				IsValid( void ) const { return index >= 0; }
+	bool				operator==( const struct slotHandle_s &h ) const { return index == h.index && generation == h.generation; }
+	bool				operator!=( const struct slotHandle_s &h ) const { return !( *this == h ); }
+} slotHandle_t;
+
+const slotHandle_t SLOT_HANDLE_NONE = { -1, 0 };
+
+template< class type, int blockSize = 64 >
+class idSlotMap {
+public:
+						idSlotMap( void );
+
+	type *				Alloc( slotHandle_t &handle );		// O(1), the object keeps what was in it when it was last freed
+	void				Free( slotHandle_t handle );		// O(1), nothing happens when the handle is stale
+	void				Clear( void );						// frees all objects, all handles become stale
+	void				Shutdown( void );					// frees all memory
+
+	type *				Get( slotHandle_t handle ) const;	// NULL when the object was freed
+	type *				GetSlot( int index ) const;			// object in a slot without the generation check, NULL if the slot is free
+	slotHandle_t		GetHandle( const type *object ) const;	// handle of a live object
+
+	int					Num( void ) const { return dense.Num(); }
+	type *				operator[]( int index ) const { return &dense[index]->t; }	// dense iteration, the order changes when objects are freed
+
+	size_t				Allocated( void ) const;
+
+private:
+	typedef struct element_s {
+		type			t;
+		int				slot;
+		int				dense;								// index in dense
+	} element_t;
+
+	typedef struct slot_s {
+		element_t *		element;							// NULL when the slot is free
+		int				generation;
+		int				nextFree;
+	} slot_t;
+
+	idBlockAlloc<element_t, blockSize>	allocator;
+	idList<slot_t>		slots;
+	idList<element_t *>	dense;
+	int					firstFree;							// free slot list, -1 when empty
+};
+
+template< class type, int blockSize >
+ID_INLINE idSlotMap<type,blockSize>::idSlotMap( void ) {
+	slots.SetGranularity( blockSize );
+	dense.SetGranularity( blockSize );
+	firstFree = -1;
+}
+
+template< class type, int blockSize >
+ID_INLINE type *idSlotMap<type,blockSize>::Alloc( slotHandle_t &handle ) {
+	int index;
+
+	if ( firstFree >= 0 ) {
+		index = firstFree;
+		firstFree = slots[index].nextFree;
+	} else {
+		index = slots.Num();
+		slot_t &slot = slots.Alloc();
+		slot.generation = 0;
+	}
+
+	element_t *element = allocator.Alloc();
+	element->slot = index;
+	element->dense = dense.Append( element );
+
+	slot_t &slot = slots[index];
+	slot.element = element;
+	slot.nextFree = -1;
+
+	handle.index = index;
+	handle.generation = slot.generation;
+	return &element->t;
+}
+
+template< class type, int blockSize >
+ID_INLINE void idSlotMap<type,blockSize>::Free( slotHandle_t handle ) {
+	if ( !Get( handle ) ) {
+		return;
+	}
+
+	slot_t &slot = slots[handle.index];
+	element_t *element = slot.element;
+
+	// move the last live object into the hole
+	element_t *last = dense[dense.Num() - 1];
+	dense[element->dense] = last;
+	last->dense = element->dense;
+	dense.SetNum( dense.Num() - 1, false );
+
+	allocator.Free( element );
+
+	slot.element = NULL;
+	slot.generation++;
+	slot.nextFree = firstFree;
+	firstFree = handle.index;
+}
+
+template< class type, int blockSize >
+ID_INLINE void idSlotMap<type,blockSize>::Clear( void ) {
+	int i;
+
+	for ( i = 0; i < dense.Num(); i++ ) {
+		allocator.Free( dense[i] );
+	}
+	dense.SetNum( 0, false );
+
+	// slots are kept so their generations stay ahead of old handles
+	firstFree = -1;
+	for ( i = slots.Num() - 1; i >= 0; i-- ) {
+		if ( slots[i].element ) {
+			slots[i].element = NULL;
+			slots[i].generation++;
+		}
+		slots[i].nextFree = firstFree;
+		firstFree = i;
+	}
+}
+
+template< class type, int blockSize >
+ID_INLINE void idSlotMap<type,blockSize>::Shutdown( void ) {
+	allocator.Shutdown();
+	slots.Clear();
+	dense.Clear();
+	firstFree = -1;
+}
+
+template< class type, int blockSize >
+ID_INLINE type *idSlotMap<type,blockSize>::Get( slotHandle_t handle ) const {
+	if ( handle.index < 0 || handle.index >= slots.Num() ) {
+		return NULL;
+	}
+	const slot_t &slot = slots[handle.index];
+	if ( !slot.element || slot.generation != handle.generation ) {
+		return NULL;
+	}
+	return &slot.element->t;
+}
+
+template< class type, int blockSize >
+ID_INLINE type *idSlotMap<type,blockSize>::GetSlot( int index ) const {
+	if ( index < 0 || index >= slots.Num() || !slots[index].element ) {
+		return NULL;
+	}
+	return &slots[index].element->t;
+}
+
+template< class type, int blockSize >
+ID_INLINE slotHandle_t idSlotMap<type,blockSize>::GetHandle( const type *object ) const {
+	slotHandle_t handle;
+	const element_t *element = (const element_t *)object;
+
+	handle.index = element->slot;
+	handle.generation = slots[element->slot].generation;
+	assert( slots[element->slot].element == element );
+	return handle;
+}
+
+template< class type, int blockSize >
+ID_INLINE size_t idSlotMap<type,blockSize>::Allocated( void ) const {
+	return allocator.GetTotalCount() * sizeof( element_t ) + slots.Allocated() + dense.Allocated();
+}
+
+#endif /* !__SLOTMAP_H__ */
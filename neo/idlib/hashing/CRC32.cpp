@@ -1,7 +1,23 @@
 #include "sys/platform.h"
+#include "idlib/math/Random.h"
+#include "idlib/Heap.h"
+#include "framework/Common.h"
 
 #include "idlib/hashing/CRC32.h"
 
+#if defined(__GNUC__) && ( defined(__i386__) || defined(__x86_64__) )
+	#define CRC32_PCLMUL
+	#define CRC32_PCLMUL_TARGET		__attribute__((target("sse2,pclmul")))
+#elif defined(_MSC_VER) && ( defined(_M_IX86) || defined(_M_X64) )
+	#define CRC32_PCLMUL
+	#define CRC32_PCLMUL_TARGET
+#endif
+
+#ifdef CRC32_PCLMUL
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
 /*
    CRC-32
    Copyright (C) 1995-1998 Mark Adler
@@ -142,15 +158,212 @@ void CRC32_Update( unsigned int &crcvalue, const byte data ) {
 	crcvalue = crctable[ ( crcvalue ^ data ) & 0xff ] ^ ( crcvalue >> 8 );
 }
 
-void CRC32_UpdateChecksum( unsigned int &crcvalue, const void *data, int length ) {
-	unsigned int crc;
-	const unsigned char *buf = (const unsigned char *) data;
+/*
+   Slice-by-8: crcSliceTable[k][i] is the CRC of byte i followed by k zero bytes,
+   so eight input bytes can be folded into the register with eight independent lookups.
+   crcSliceTable[0] is crctable.
+*/
+static unsigned int crcSliceTable[8][256];
+static bool crcSliceTableValid = false;
+
+#ifdef CRC32_PCLMUL
+static bool crcUsePCLMUL = false;
+#endif
+
+/*
+================
+CRC32_Init
+================
+*/
+void CRC32_Init( void ) {
+	int i, k;
+
+#ifdef CREATE_CRC_TABLE
+	make_crc_table();
+#endif
+
+	for ( i = 0; i < 256; i++ ) {
+		crcSliceTable[0][i] = crctable[i];
+	}
+	for ( k = 1; k < 8; k++ ) {
+		for ( i = 0; i < 256; i++ ) {
+			unsigned int c = crcSliceTable[k - 1][i];
+			crcSliceTable[k][i] = crctable[c & 0xff] ^ ( c >> 8 );
+		}
+	}
+	crcSliceTableValid = true;
+}
 
-	crc = crcvalue;
+/*
+================
+CRC32_InitProcessor
+================
+*/
+void CRC32_InitProcessor( bool forceGeneric ) {
+#ifdef CRC32_PCLMUL
+	int cpuid = idLib::sys->GetProcessorId();
+	bool usePCLMUL = !forceGeneric && ( cpuid & CPUID_SSE2 ) && ( cpuid & CPUID_PCLMUL );
+
+	if ( usePCLMUL != crcUsePCLMUL ) {
+		crcUsePCLMUL = usePCLMUL;
+		idLib::common->Printf( "CRC32 using %s\n", crcUsePCLMUL ? "PCLMULQDQ" : "slice-by-8" );
+	}
+#endif
+}
+
+/*
+================
+CRC32_UpdateBytewise
+================
+*/
+static unsigned int CRC32_UpdateBytewise( unsigned int crc, const byte *buf, int length ) {
 	while( length-- ) {
 		crc = crctable[ ( crc ^ ( *buf++ ) ) & 0xff ] ^ ( crc >> 8 );
 	}
-	crcvalue = crc;
+	return crc;
+}
+
+/*
+================
+CRC32_UpdateSlice8
+================
+*/
+static unsigned int CRC32_UpdateSlice8( unsigned int crc, const byte *buf, int length ) {
+	unsigned int one, two;
+
+	if ( !crcSliceTableValid ) {
+		return CRC32_UpdateBytewise( crc, buf, length );
+	}
+
+	while( length >= 8 ) {
+		one = ( buf[0] | ( buf[1] << 8 ) | ( buf[2] << 16 ) | ( (unsigned int)buf[3] << 24 ) ) ^ crc;
+		two = buf[4] | ( buf[5] << 8 ) | ( buf[6] << 16 ) | ( (unsigned int)buf[7] << 24 );
+		crc = crcSliceTable[7][ one & 0xff ] ^
+				crcSliceTable[6][ ( one >> 8 ) & 0xff ] ^
+				crcSliceTable[5][ ( one >> 16 ) & 0xff ] ^
+				crcSliceTable[4][ one >> 24 ] ^
+				crcSliceTable[3][ two & 0xff ] ^
+				crcSliceTable[2][ ( two >> 8 ) & 0xff ] ^
+				crcSliceTable[1][ ( two >> 16 ) & 0xff ] ^
+				crcSliceTable[0][ two >> 24 ];
+		buf += 8;
+		length -= 8;
+	}
+	return CRC32_UpdateBytewise( crc, buf, length );
+}
+
+#ifdef CRC32_PCLMUL
+
+/*
+================
+CRC32_UpdatePCLMUL
+
+  Folds the buffer 64 bytes at a time with carry-less multiplies and finishes
+  with a Barrett reduction, see Intel's "Fast CRC Computation for Generic
+  Polynomials Using PCLMULQDQ Instruction". Only whole 16 byte blocks are
+  processed, length must be at least 64.
+================
+*/
+CRC32_PCLMUL_TARGET static unsigned int CRC32_UpdatePCLMUL( unsigned int crc, const byte *buf, int length ) {
+	// x^(4*128+32) mod P, x^(4*128-32) mod P, x^(128+32) mod P, x^(128-32) mod P, bit reflected
+	const __m128i k1k2 = _mm_set_epi32( 0x00000001, 0xc6e41596, 0x00000001, 0x54442bd4 );
+	const __m128i k3k4 = _mm_set_epi32( 0x00000000, 0xccaa009e, 0x00000001, 0x751997d0 );
+	// x^64 mod P
+	const __m128i k5 = _mm_set_epi32( 0x00000000, 0x00000000, 0x00000001, 0x63cd6124 );
+	// P' and mu for the Barrett reduction
+	const __m128i poly = _mm_set_epi32( 0x00000001, 0xf7011641, 0x00000001, 0xdb710641 );
+	const __m128i mask32 = _mm_set_epi32( 0, 0, 0, -1 );
+	__m128i x0, x1, x2, x3, y0, y1, y2, y3;
+
+	assert( length >= 64 );
+
+	x0 = _mm_loadu_si128( (const __m128i *)( buf + 0x00 ) );
+	x1 = _mm_loadu_si128( (const __m128i *)( buf + 0x10 ) );
+	x2 = _mm_loadu_si128( (const __m128i *)( buf + 0x20 ) );
+	x3 = _mm_loadu_si128( (const __m128i *)( buf + 0x30 ) );
+	x0 = _mm_xor_si128( x0, _mm_cvtsi32_si128( crc ) );
+	buf += 64;
+	length -= 64;
+
+	// fold four 128 bit lanes at a time
+	while( length >= 64 ) {
+		y0 = _mm_clmulepi64_si128( x0, k1k2, 0x11 );
+		y1 = _mm_clmulepi64_si128( x1, k1k2, 0x11 );
+		y2 = _mm_clmulepi64_si128( x2, k1k2, 0x11 );
+		y3 = _mm_clmulepi64_si128( x3, k1k2, 0x11 );
+		x0 = _mm_clmulepi64_si128( x0, k1k2, 0x00 );
+		x1 = _mm_clmulepi64_si128( x1, k1k2, 0x00 );
+		x2 = _mm_clmulepi64_si128( x2, k1k2, 0x00 );
+		x3 = _mm_clmulepi64_si128( x3, k1k2, 0x00 );
+		x0 = _mm_xor_si128( _mm_xor_si128( x0, y0 ), _mm_loadu_si128( (const __m128i *)( buf + 0x00 ) ) );
+		x1 = _mm_xor_si128( _mm_xor_si128( x1, y1 ), _mm_loadu_si128( (const __m128i *)( buf + 0x10 ) ) );
+		x2 = _mm_xor_si128( _mm_xor_si128( x2, y2 ), _mm_loadu_si128( (const __m128i *)( buf + 0x20 ) ) );
+		x3 = _mm_xor_si128( _mm_xor_si128( x3, y3 ), _mm_loadu_si128( (const __m128i *)( buf + 0x30 ) ) );
+		buf += 64;
+		length -= 64;
+	}
+
+	// fold the four lanes into one
+	y0 = _mm_clmulepi64_si128( x0, k3k4, 0x11 );
+	x0 = _mm_clmulepi64_si128( x0, k3k4, 0x00 );
+	x0 = _mm_xor_si128( _mm_xor_si128( x0, y0 ), x1 );
+	y0 = _mm_clmulepi64_si128( x0, k3k4, 0x11 );
+	x0 = _mm_clmulepi64_si128( x0, k3k4, 0x00 );
+	x0 = _mm_xor_si128( _mm_xor_si128( x0, y0 ), x2 );
+	y0 = _mm_clmulepi64_si128( x0, k3k4, 0x11 );
+	x0 = _mm_clmulepi64_si128( x0, k3k4, 0x00 );
+	x0 = _mm_xor_si128( _mm_xor_si128( x0, y0 ), x3 );
+
+	// fold the remaining 16 byte blocks
+	while( length >= 16 ) {
+		y0 = _mm_clmulepi64_si128( x0, k3k4, 0x11 );
+		x0 = _mm_clmulepi64_si128( x0, k3k4, 0x00 );
+		x0 = _mm_xor_si128( _mm_xor_si128( x0, y0 ), _mm_loadu_si128( (const __m128i *)buf ) );
+		buf += 16;
+		length -= 16;
+	}
+
+	// 128 -> 64 bits, also appends 32 zero bits to the message
+	y0 = _mm_clmulepi64_si128( x0, k3k4, 0x10 );
+	x0 = _mm_xor_si128( _mm_srli_si128( x0, 8 ), y0 );
+
+	// 64 -> 32 bits
+	y0 = _mm_srli_si128( x0, 4 );
+	x0 = _mm_clmulepi64_si128( _mm_and_si128( x0, mask32 ), k5, 0x00 );
+	x0 = _mm_xor_si128( x0, y0 );
+
+	// Barrett reduction
+	y0 = x0;
+	x0 = _mm_clmulepi64_si128( _mm_and_si128( x0, mask32 ), poly, 0x10 );
+	x0 = _mm_clmulepi64_si128( _mm_and_si128( x0, mask32 ), poly, 0x00 );
+	x0 = _mm_xor_si128( x0, y0 );
+
+	return (unsigned int)_mm_cvtsi128_si32( _mm_srli_si128( x0, 4 ) );
+}
+
+#endif
+
+/*
+================
+CRC32_UpdateFast
+
+  Uses the fastest implementation selected by CRC32_InitProcessor.
+================
+*/
+static unsigned int CRC32_UpdateFast( unsigned int crc, const byte *buf, int length ) {
+#ifdef CRC32_PCLMUL
+	if ( crcUsePCLMUL && length >= 64 ) {
+		int blocks = length & ~15;
+		crc = CRC32_UpdatePCLMUL( crc, buf, blocks );
+		buf += blocks;
+		length -= blocks;
+	}
+#endif
+	return CRC32_UpdateSlice8( crc, buf, length );
+}
+
+void CRC32_UpdateChecksum( unsigned int &crcvalue, const void *data, int length ) {
+	crcvalue = CRC32_UpdateFast( crcvalue, (const byte *) data, length );
 }
 
 void CRC32_FinishChecksum( unsigned int &crcvalue ) {
@@ -165,3 +378,80 @@ unsigned int CRC32_BlockChecksum( const void *data, int length ) {
 	CRC32_FinishChecksum( crc );
 	return crc;
 }
+
+
+//===============================================================
+//
+// Test code
+//
+//===============================================================
+
+#define CRC32_TEST_SIZE			( 8 * 1024 * 1024 )
+#define CRC32_TEST_NUMTESTS		8
+
+typedef unsigned int (*crc32Update_t)( unsigned int crc, const byte *buf, int length );
+
+/*
+================
+CRC32_TestUpdate
+================
+*/
+static void CRC32_TestUpdate( const char *name, crc32Update_t update, const byte *buf, int length, unsigned int expected, double &bestUsec, double otherUsec ) {
+	unsigned int crc = 0;
+	double start, usec;
+	int i;
+
+	bestUsec = 0.0;
+	for ( i = 0; i < CRC32_TEST_NUMTESTS; i++ ) {
+		start = idLib::sys->GetMicroseconds();
+		crc = update( CRC32_INIT_VALUE, buf, length ) ^ CRC32_XOR_VALUE;
+		usec = idLib::sys->GetMicroseconds() - start;
+		if ( !bestUsec || usec < bestUsec ) {
+			bestUsec = usec;
+		}
+	}
+
+	idLib::common->Printf( "%-32s %s %8.2f MB/s", name, ( crc == expected ) ? "ok" : S_COLOR_RED "X" S_COLOR_DEFAULT, length / bestUsec );
+	if ( otherUsec > 0.0 ) {
+		idLib::common->Printf( " (%.1fx)", otherUsec / bestUsec );
+	}
+	idLib::common->Printf( "\n" );
+}
+
+/*
+================
+CRC32_Test_f
+================
+*/
+void CRC32_Test_f( const idCmdArgs &args ) {
+	byte *buf;
+	unsigned int expected;
+	double bytewiseUsec, usec;
+	int i;
+	idRandom srnd( 1013904223L );
+
+	buf = (byte *) Mem_Alloc16( CRC32_TEST_SIZE );
+	for ( i = 0; i < CRC32_TEST_SIZE; i++ ) {
+		buf[i] = srnd.RandomInt( 256 );
+	}
+
+	// odd length and start so the unaligned head and tail are exercised as well
+	expected = CRC32_UpdateBytewise( CRC32_INIT_VALUE, buf + 1, CRC32_TEST_SIZE - 7 ) ^ CRC32_XOR_VALUE;
+
+	idLib::common->Printf( "Testing CRC32 on %d MB...\n", CRC32_TEST_SIZE >> 20 );
+	CRC32_TestUpdate( "bytewise", CRC32_UpdateBytewise, buf + 1, CRC32_TEST_SIZE - 7, expected, bytewiseUsec, 0.0 );
+	CRC32_TestUpdate( "slice-by-8", CRC32_UpdateSlice8, buf + 1, CRC32_TEST_SIZE - 7, expected, usec, bytewiseUsec );
+
+#ifdef CRC32_PCLMUL
+	if ( idLib::sys->GetProcessorId() & CPUID_PCLMUL ) {
+		bool usePCLMUL = crcUsePCLMUL;
+		crcUsePCLMUL = true;
+		CRC32_TestUpdate( "PCLMULQDQ", CRC32_UpdateFast, buf + 1, CRC32_TEST_SIZE - 7, expected, usec, bytewiseUsec );
+		crcUsePCLMUL = usePCLMUL;
+	} else {
+		idLib::common->Printf( "PCLMULQDQ not supported by this CPU\n" );
+	}
+#endif
+
+	Mem_Free16( buf );
+}
@@ -7,9 +7,16 @@
 	Calculates a checksum for a block of data
 	using the CRC-32.
 
+	CRC32_Init builds the slice-by-8 tables, CRC32_InitProcessor switches
+	to the carry-less multiply path when the CPU supports PCLMULQDQ.
+
 ===============================================================================
 */
 
+void CRC32_Init( void );
+void CRC32_InitProcessor( bool forceGeneric );
+void CRC32_Test_f( const class idCmdArgs &args );
+
 void CRC32_InitChecksum( unsigned int &crcvalue );
 void CRC32_UpdateChecksum( unsigned int &crcvalue, const void *data, int length );
 void CRC32_FinishChecksum( unsigned int &crcvalue );
@@ -0,0 +1,234 @@
+#include "sys/platform.h"
+#include "idlib/math/Random.h"
+#include "idlib/Str.h"
+#include "idlib/Heap.h"
+#include "idlib/Lib.h"
+#include "framework/Common.h"
+
+#include "idlib/hashing/SipHash.h"
+
+/*
+   SipHash-1-3, Jean-Philippe Aumasson and Daniel J. Bernstein.
+   One compression round per 8 byte word and three finalization rounds,
+   the variant also used by Rust and Python for their hash tables.
+*/
+
+#define ROTL64( x, b )	( ( (x) << (b) ) | ( (x) >> ( 64 - (b) ) ) )
+
+#define SIPROUND							\
+	do {									\
+		v0 += v1; v1 = ROTL64( v1, 13 );	\
+		v1 ^= v0; v0 = ROTL64( v0, 32 );	\
+		v2 += v3; v3 = ROTL64( v3, 16 );	\
+		v3 ^= v2;							\
+		v0 += v3; v3 = ROTL64( v3, 21 );	\
+		v3 ^= v0;							\
+		v2 += v1; v1 = ROTL64( v1, 17 );	\
+		v1 ^= v2; v2 = ROTL64( v2, 32 );	\
+	} while( 0 )
+
+static sipHashKey_t	processKey;
+
+/*
+================
+ReadLE64
+================
+*/
+static ID_INLINE unsigned long long ReadLE64( const byte *p ) {
+	return	( (unsigned long long)p[0] ) |
+			( (unsigned long long)p[1] << 8 ) |
+			( (unsigned long long)p[2] << 16 ) |
+			( (unsigned long long)p[3] << 24 ) |
+			( (unsigned long long)p[4] << 32 ) |
+			( (unsigned long long)p[5] << 40 ) |
+			( (unsigned long long)p[6] << 48 ) |
+			( (unsigned long long)p[7] << 56 );
+}
+
+/*
+================
+SipHash_Init
+
+  The key only has to be unpredictable from the outside, prefer the
+  system random source and fall back on mixing clocks and addresses.
+================
+*/
+void SipHash_Init( void ) {
+	byte seed[16];
+	bool seeded = false;
+
+#ifndef _WIN32
+	FILE *f = fopen( "/dev/urandom", "rb" );
+	if ( f ) {
+		seeded = ( fread( seed, 1, sizeof( seed ), f ) == sizeof( seed ) );
+		fclose( f );
+	}
+#endif
+
+	if ( !seeded ) {
+		unsigned long long mix[2];
+		mix[0] = (unsigned long long)time( NULL ) ^ ( (unsigned long long)(uintptr_t)&processKey << 16 );
+		mix[1] = (unsigned long long)( idLib::sys->GetMicroseconds() * 1000.0 ) ^ ( (unsigned long long)(uintptr_t)seed << 24 ) ^ clock();
+		memcpy( seed, mix, sizeof( seed ) );
+	}
+
+	// run the seed through the hash itself so weak fallback seeds are spread over all bits
+	sipHashKey_t seedKey = { 0x736f6d6570736575ULL, 0x646f72616e646f6dULL };
+	processKey.k0 = SipHash_BlockChecksum( seedKey, seed, 8 );
+	processKey.k1 = SipHash_BlockChecksum( seedKey, seed + 8, 8 ) ^ processKey.k0;
+}
+
+/*
+================
+SipHash_GetProcessKey
+================
+*/
+const sipHashKey_t &SipHash_GetProcessKey( void ) {
+	return processKey;
+}
+
+/*
+================
+SipHash_BlockChecksum
+================
+*/
+unsigned long long SipHash_BlockChecksum( const sipHashKey_t &key, const void *data, int length ) {
+	const byte *in = (const byte *) data;
+	const byte *end = in + ( length & ~7 );
+	unsigned long long v0 = key.k0 ^ 0x736f6d6570736575ULL;
+	unsigned long long v1 = key.k1 ^ 0x646f72616e646f6dULL;
+	unsigned long long v2 = key.k0 ^ 0x6c7967656e657261ULL;
+	unsigned long long v3 = key.k1 ^ 0x7465646279746573ULL;
+	unsigned long long m, b;
+
+	for ( ; in != end; in += 8 ) {
+		m = ReadLE64( in );
+		v3 ^= m;
+		SIPROUND;
+		v0 ^= m;
+	}
+
+	// last word holds the remaining bytes and the length in the top byte
+	b = ( (unsigned long long)length ) << 56;
+	switch( length & 7 ) {
+		case 7: b |= ( (unsigned long long)in[6] ) << 48;
+		case 6: b |= ( (unsigned long long)in[5] ) << 40;
+		case 5: b |= ( (unsigned long long)in[4] ) << 32;
+		case 4: b |= ( (unsigned long long)in[3] ) << 24;
+		case 3: b |= ( (unsigned long long)in[2] ) << 16;
+		case 2: b |= ( (unsigned long long)in[1] ) << 8;
+		case 1: b |= ( (unsigned long long)in[0] );
+		case 0: break;
+	}
+
+	v3 ^= b;
+	SIPROUND;
+	v0 ^= b;
+
+	v2 ^= 0xff;
+	SIPROUND;
+	SIPROUND;
+	SIPROUND;
+
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*
+================
+SipHash_BlockChecksum
+================
+*/
+unsigned long long SipHash_BlockChecksum( const void *data, int length ) {
+	return SipHash_BlockChecksum( processKey, data, length );
+}
+
+
+//===============================================================
+//
+// Test code
+//
+//===============================================================
+
+#define SIPHASH_TEST_COUNT		4096		// keys per test
+#define SIPHASH_TEST_NUMTESTS	64			// number of tests
+
+/*
+================
+SipHash_TestLength
+================
+*/
+static void SipHash_TestLength( const char *name, const char *keys, int length ) {
+	double start, usec, bestStr, bestSip;
+	unsigned long long sum;
+	int i, t;
+	const char *key;
+
+	sum = 0;
+	bestStr = 0.0;
+	for ( t = 0; t < SIPHASH_TEST_NUMTESTS; t++ ) {
+		start = idLib::sys->GetMicroseconds();
+		for ( i = 0, key = keys; i < SIPHASH_TEST_COUNT; i++, key += length + 1 ) {
+			sum += idStr::Hash( key, length );
+		}
+		usec = idLib::sys->GetMicroseconds() - start;
+		if ( !bestStr || usec < bestStr ) {
+			bestStr = usec;
+		}
+	}
+
+	bestSip = 0.0;
+	for ( t = 0; t < SIPHASH_TEST_NUMTESTS; t++ ) {
+		start = idLib::sys->GetMicroseconds();
+		for ( i = 0, key = keys; i < SIPHASH_TEST_COUNT; i++, key += length + 1 ) {
+			sum += SipHash_BlockChecksum( key, length );
+		}
+		usec = idLib::sys->GetMicroseconds() - start;
+		if ( !bestSip || usec < bestSip ) {
+			bestSip = usec;
+		}
+	}
+
+	idLib::common->Printf( "%-24s idStr::Hash %6.1f ns  SipHash %6.1f ns\n", name,
+		bestStr * 1000.0 / SIPHASH_TEST_COUNT, bestSip * 1000.0 / SIPHASH_TEST_COUNT );
+
+	// keep the hashes from being optimized away
+	if ( sum == 1 ) {
+		idLib::common->Printf( "\n" );
+	}
+}
+
+/*
+================
+SipHash_Test_f
+================
+*/
+void SipHash_Test_f( const idCmdArgs &args ) {
+	static const int lengths[] = { 6, 16, 32, 64 };
+	// SipHash-1-3 of the message 00..0e with the key 00..0f
+	static const unsigned long long expected = 0xd320d86d2a519956ULL;
+	sipHashKey_t refKey;
+	byte refKeyBytes[16], refMsg[15];
+	char *keys;
+	int i, j;
+	idRandom srnd( 1013904223L );
+
+	for ( i = 0; i < 16; i++ ) {
+		refKeyBytes[i] = i;
+	}
+	for ( i = 0; i < 15; i++ ) {
+		refMsg[i] = i;
+	}
+	refKey.k0 = ReadLE64( refKeyBytes );
+	refKey.k1 = ReadLE64( refKeyBytes + 8 );
+	idLib::common->Printf( "SipHash-1-3 reference vector %s\n", ( SipHash_BlockChecksum( refKey, refMsg, sizeof( refMsg ) ) == expected ) ? "ok" : S_COLOR_RED "X" S_COLOR_DEFAULT );
+
+	for ( i = 0; i < (int)( sizeof( lengths ) / sizeof( lengths[0] ) ); i++ ) {
+		int length = lengths[i];
+		keys = (char *) Mem_Alloc( SIPHASH_TEST_COUNT * ( length + 1 ) );
+		for ( j = 0; j < SIPHASH_TEST_COUNT * ( length + 1 ); j++ ) {
+			keys[j] = 'a' + srnd.RandomInt( 26 );
+		}
+		SipHash_TestLength( va( "%d byte keys", length ), keys, length );
+		Mem_Free( keys );
+	}
+}
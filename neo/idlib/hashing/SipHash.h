@@ -0,0 +1,29 @@
+#ifndef __SIPHASH_H__
+#define __SIPHASH_H__
+
+/*
+===============================================================================
+
+	Calculates a keyed 64 bit hash for a block of data
+	using SipHash-1-3.
+
+	Meant for hash tables keyed on data received from the network,
+	without the key an attacker cannot craft inputs that collide.
+	SipHash_Init picks a random key for the process, it changes every run
+	so the hashes must never be stored or sent anywhere.
+
+===============================================================================
+*/
+
+typedef struct {
+	unsigned long long	k0;
+	unsigned long long	k1;
+} sipHashKey_t;
+
+void				SipHash_Init( void );
+const sipHashKey_t &SipHash_GetProcessKey( void );
+unsigned long long	SipHash_BlockChecksum( const sipHashKey_t &key, const void *data, int length );
+unsigned long long	SipHash_BlockChecksum( const void *data, int length );	// uses the process key
+void				SipHash_Test_f( const class idCmdArgs &args );
+
+#endif /* !__SIPHASH_H__ */
@@ -53,6 +53,7 @@ If you have questions concerning this license or the applicable additional terms
 #include "sys/platform.h"
 #include "framework/Common.h"
 #include "framework/CVarSystem.h"
+#include "framework/Profiler.h"
 #include "sys/sys_public.h"
 
 #include "sys/aros/aros_public.h"
@@ -470,6 +471,7 @@ idPort::GetPacket
 ==================
 */
 bool idPort::GetPacket( netadr_t &net_from, void *data, int &size, int maxSize ) {
+	TRACE_SCOPE( "idPort::GetPacket" );
 	int ret;
 	struct sockaddr_in from;
 	socklen_t fromlen;
@@ -549,12 +551,85 @@ bool idPort::GetPacketBlocking( netadr_t &net_from, void *data, int &size, int m
 	return true;
 }
 
+/*
+==================
+Sys_WaitForEvents
+
+console input can't be waited on here, wake up regularly to poll it
+==================
+*/
+int Sys_WaitForEvents( const idPort &port, int timeout, idTCP **sockets, int numSockets ) {
+	const int			consolePoll = 10;
+	fd_set				set, writeSet;
+	struct timeval		tv;
+	int					i, ret, maxfd, flags;
+
+	if ( timeout < 0 || timeout > consolePoll ) {
+		timeout = consolePoll;
+	}
+
+	FD_ZERO( &set );
+	FD_ZERO( &writeSet );
+	maxfd = -1;
+	if ( port.netSocket ) {
+		FD_SET( port.netSocket, &set );
+		maxfd = port.netSocket;
+	}
+	for ( i = 0; i < numSockets; i++ ) {
+		idTCP *s = sockets[i];
+		s->readyFlags = 0;
+		if ( !s->fd ) {
+			continue;
+		}
+		if ( s->waitFlags & TCP_WAIT_READ ) {
+			FD_SET( s->fd, &set );
+		}
+		if ( s->waitFlags & TCP_WAIT_WRITE ) {
+			FD_SET( s->fd, &writeSet );
+		}
+		maxfd = Max( maxfd, s->fd );
+	}
+	if ( maxfd == -1 ) {
+		Sys_Sleep( timeout );
+		return SYS_WAIT_CONSOLE;
+	}
+
+	tv.tv_sec = 0;
+	tv.tv_usec = timeout * 1000;
+	ret = WaitSelect( maxfd + 1, &set, &writeSet, NULL, &tv, NULL );
+	if ( ret <= 0 ) {
+		return SYS_WAIT_CONSOLE;
+	}
+
+	flags = SYS_WAIT_CONSOLE;
+	if ( port.netSocket && FD_ISSET( port.netSocket, &set ) ) {
+		flags |= SYS_WAIT_PACKET;
+	}
+	for ( i = 0; i < numSockets; i++ ) {
+		idTCP *s = sockets[i];
+		if ( !s->fd ) {
+			continue;
+		}
+		if ( ( s->waitFlags & TCP_WAIT_READ ) && FD_ISSET( s->fd, &set ) ) {
+			s->readyFlags |= TCP_WAIT_READ;
+		}
+		if ( ( s->waitFlags & TCP_WAIT_WRITE ) && FD_ISSET( s->fd, &writeSet ) ) {
+			s->readyFlags |= TCP_WAIT_WRITE;
+		}
+		if ( s->readyFlags ) {
+			flags |= SYS_WAIT_SOCKET;
+		}
+	}
+	return flags;
+}
+
 /*
 ==================
 idPort::SendPacket
 ==================
 */
 void idPort::SendPacket( const netadr_t to, const void *data, int size ) {
+	TRACE_SCOPE( "idPort::SendPacket" );
 	int ret;
 	struct sockaddr_in addr;
 
@@ -600,6 +675,8 @@ idTCP::idTCP
 idTCP::idTCP() {
 	fd = 0;
 	memset(&address, 0, sizeof(address));
+	waitFlags = 0;
+	readyFlags = 0;
 }
 
 /*
@@ -757,3 +834,117 @@ int	idTCP::Write(void *data, int size) {
 
 	return nbytes;
 }
+
+/*
+==================
+idTCP::WriteV
+
+bsdsocket has no gather write, send the buffers one after the other
+==================
+*/
+int idTCP::WriteV( const void * const *data, const int *sizes, int count ) {
+	int i, nbytes, total;
+
+	if ( !fd ) {
+		common->Printf( "idTCP::WriteV: not initialized\n" );
+		return -1;
+	}
+
+	total = 0;
+	for ( i = 0; i < count; i++ ) {
+		nbytes = send( fd, (const char *)data[i], sizes[i], 0 );
+		if ( nbytes == -1 ) {
+			if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+				break;
+			}
+			common->DPrintf( "idTCP::WriteV: %s\n", strerror( errno ) );
+			Close();
+			return -1;
+		}
+		total += nbytes;
+		if ( nbytes < sizes[i] ) {
+			break;
+		}
+	}
+	return total;
+}
+
+/*
+==================
+idTCP::Listen
+==================
+*/
+bool idTCP::Listen( int port ) {
+	struct sockaddr_in	sadr;
+	int					status;
+
+	if ( fd ) {
+		common->Warning( "idTCP::Listen: already initialized?\n" );
+		Close();
+	}
+
+	if ( ( fd = socket( PF_INET, SOCK_STREAM, 0 ) ) == -1 ) {
+		fd = 0;
+		common->Printf( "ERROR: idTCP::Listen: socket: %s\n", strerror( errno ) );
+		return false;
+	}
+
+	memset( &sadr, 0, sizeof( sadr ) );
+	sadr.sin_family = AF_INET;
+	sadr.sin_addr.s_addr = INADDR_ANY;
+	sadr.sin_port = htons( (short)port );
+	if ( bind( fd, (struct sockaddr *)&sadr, sizeof( sadr ) ) == -1 || listen( fd, 16 ) == -1 ) {
+		common->Printf( "ERROR: idTCP::Listen: port %d: %s\n", port, strerror( errno ) );
+		close( fd );
+		fd = 0;
+		return false;
+	}
+
+	if ( ( status = fcntl( fd, F_GETFL, 0 ) ) != -1 ) {
+		status = fcntl( fd, F_SETFL, status | O_NONBLOCK );
+	}
+	if ( status == -1 ) {
+		common->Printf( "ERROR: idTCP::Listen: fcntl / O_NONBLOCK: %s\n", strerror( errno ) );
+		close( fd );
+		fd = 0;
+		return false;
+	}
+
+	memset( &address, 0, sizeof( address ) );
+	address.type = NA_IP;
+	address.port = port;
+	return true;
+}
+
+/*
+==================
+idTCP::Accept
+==================
+*/
+int idTCP::Accept( idTCP &client ) {
+	struct sockaddr_in	sadr;
+	socklen_t			len;
+	int					newfd, status;
+
+	if ( !fd ) {
+		return 0;
+	}
+
+	len = sizeof( sadr );
+	if ( ( newfd = accept( fd, (struct sockaddr *)&sadr, &len ) ) == -1 ) {
+		return ( errno == EAGAIN || errno == EWOULDBLOCK ) ? 0 : -1;
+	}
+
+	if ( ( status = fcntl( newfd, F_GETFL, 0 ) ) != -1 ) {
+		status = fcntl( newfd, F_SETFL, status | O_NONBLOCK );
+	}
+	if ( status == -1 ) {
+		close( newfd );
+		return 0;
+	}
+
+	client.Close();
+	client.fd = newfd;
+	SockadrToNetadr( &sadr, &client.address );
+	return 1;
+}
@@ -99,6 +99,7 @@ static inline void CPUid(int index, int *a, int *b, int *c, int *d) {
 #endif
 
 #define c_SSE3		(1 << 0)
+#define c_PCLMUL	(1 << 1)
 #define d_FXSAVE	(1 << 24)
 
 static inline bool HasDAZ() {
@@ -125,6 +126,18 @@ static inline bool HasSSE3() {
 	return (c & c_SSE3) == c_SSE3;
 }
 
+static inline bool HasPCLMUL() {
+	int a, b, c, d;
+
+	CPUid(0, &a, &b, &c, &d);
+	if (a < 1)
+		return false;
+
+	CPUid(1, &a, &b, &c, &d);
+
+	return (c & c_PCLMUL) == c_PCLMUL;
+}
+
 #define MXCSR_DAZ	(1 << 6)
 #define MXCSR_FTZ	(1 << 15)
 
@@ -214,6 +227,9 @@ int Sys_GetProcessorId( void ) {
 	// there is no SDL_HasSSE3() in SDL 1.2
 	if (HasSSE3())
 		flags |= CPUID_SSE3;
+
+	if (HasPCLMUL())
+		flags |= CPUID_PCLMUL;
 #endif
 
 	if (SDL_HasAltiVec())
@@ -168,6 +168,26 @@ If you have questions concerning this license or the applicable additional terms
 #define id_attribute(x)
 #endif
 
+#ifdef _MSC_VER
+#define ID_THREAD_LOCAL				__declspec( thread )
+#else
+#define ID_THREAD_LOCAL				__thread
+#endif
+
+// rvalue references, idlib containers get move constructors and move assignment
+#if __cplusplus >= 201103L || ( defined( _MSC_VER ) && _MSC_VER >= 1600 )
+#define ID_MOVE_SEMANTICS
+#endif
+
+// types that can be copied with memcpy
+#if defined( __clang__ ) || ( defined( __GNUC__ ) && __GNUC__ >= 5 ) || ( defined( _MSC_VER ) && _MSC_VER >= 1900 )
+#define ID_IS_TRIVIALLY_COPYABLE( type )	__is_trivially_copyable( type )
+#elif defined( __GNUC__ ) || defined( _MSC_VER )
+#define ID_IS_TRIVIALLY_COPYABLE( type )	__is_pod( type )
+#else
+#define ID_IS_TRIVIALLY_COPYABLE( type )	false
+#endif
+
 #if !defined(_MSC_VER)
 	// MSVC does not provide this C99 header
 	#include <inttypes.h>
@@ -67,6 +67,8 @@ idCVar in_tty( "in_tty", "1", CVAR_BOOL | CVAR_INIT | CVAR_SYSTEM, "terminal tab
 static bool				tty_enabled = false;
 static struct termios	tty_tc;
 
+static bool				input_eof = false;			// stdin was closed, stop waiting on it
+
 // pid - useful when you attach to gdb..
 idCVar com_pid( "com_pid", "0", CVAR_INTEGER | CVAR_INIT | CVAR_SYSTEM, "process id" );
 
@@ -423,6 +425,24 @@ void Posix_InitConsoleInput( void ) {
 	}
 }
 
+/*
+===============
+Posix_ConsoleInputFD
+===============
+*/
+int Posix_ConsoleInputFD( void ) {
+	if ( input_eof ) {
+		return -1;
+	}
+#ifdef MACOS_X
+	// Sys_ConsoleInput only reads complete lines from a terminal on OSX
+	if ( !tty_enabled ) {
+		return -1;
+	}
+#endif
+	return STDIN_FILENO;
+}
+
 /*
 ================
 terminal support utilities
@@ -718,6 +738,9 @@ char *Sys_ConsoleInput( void ) {
 				return NULL;
 			}
 		}
+		if ( feof( stdin ) ) {
+			input_eof = true;
+		}
 		if ( hidden ) {
 			tty_Show();
 		}
@@ -742,6 +765,7 @@ char *Sys_ConsoleInput( void ) {
 		len = read( 0, input_ret, sizeof( input_ret ) );
 		if ( len == 0 ) {
 			// EOF
+			input_eof = true;
 			return NULL;
 		}
 
@@ -45,6 +45,7 @@ If you have questions concerning this license or the applicable additional terms
 #include "sys/platform.h"
 #include "framework/Common.h"
 #include "framework/CVarSystem.h"
+#include "framework/Profiler.h"
 #include "sys/sys_public.h"
 
 #include "sys/posix/posix_public.h"
@@ -426,6 +427,7 @@ idPort::GetPacket
 ==================
 */
 bool idPort::GetPacket( netadr_t &net_from, void *data, int &size, int maxSize ) {
+	TRACE_SCOPE( "idPort::GetPacket" );
 	int ret;
 	struct sockaddr_in from;
 	int fromlen;
@@ -511,6 +513,7 @@ idPort::SendPacket
 ==================
 */
 void idPort::SendPacket( const netadr_t to, const void *data, int size ) {
+	TRACE_SCOPE( "idPort::SendPacket" );
 	int ret;
 	struct sockaddr_in addr;
 
@@ -546,6 +549,80 @@ bool idPort::InitForPort( int portNumber ) {
 	return true;
 }
 
+/*
+==================
+Sys_WaitForEvents
+==================
+*/
+int Sys_WaitForEvents( const idPort &port, int timeout, idTCP **sockets, int numSockets ) {
+	fd_set				set, writeSet;
+	struct timeval		tv;
+	int					i, ret, maxfd, consolefd, flags;
+
+	FD_ZERO( &set );
+	FD_ZERO( &writeSet );
+	maxfd = -1;
+	if ( port.netSocket ) {
+		FD_SET( port.netSocket, &set );
+		maxfd = port.netSocket;
+	}
+	consolefd = Posix_ConsoleInputFD();
+	if ( consolefd != -1 ) {
+		FD_SET( consolefd, &set );
+		maxfd = Max( maxfd, consolefd );
+	}
+	for ( i = 0; i < numSockets; i++ ) {
+		idTCP *s = sockets[i];
+		s->readyFlags = 0;
+		if ( !s->fd || s->fd >= FD_SETSIZE ) {
+			continue;
+		}
+		if ( s->waitFlags & TCP_WAIT_READ ) {
+			FD_SET( s->fd, &set );
+		}
+		if ( s->waitFlags & TCP_WAIT_WRITE ) {
+			FD_SET( s->fd, &writeSet );
+		}
+		maxfd = Max( maxfd, s->fd );
+	}
+
+	if ( timeout >= 0 ) {
+		tv.tv_sec = timeout / 1000;
+		tv.tv_usec = ( timeout % 1000 ) * 1000;
+	}
+	ret = select( maxfd + 1, &set, numSockets ? &writeSet : NULL, NULL, timeout >= 0 ? &tv : NULL );
+	if ( ret == -1 ) {
+		if ( errno != EINTR ) {
+			common->Error( "Sys_WaitForEvents: select failed: %s\n", strerror( errno ) );
+		}
+		return SYS_WAIT_TIMEOUT;
+	}
+
+	flags = SYS_WAIT_TIMEOUT;
+	if ( port.netSocket && FD_ISSET( port.netSocket, &set ) ) {
+		flags |= SYS_WAIT_PACKET;
+	}
+	if ( consolefd != -1 && FD_ISSET( consolefd, &set ) ) {
+		flags |= SYS_WAIT_CONSOLE;
+	}
+	for ( i = 0; i < numSockets; i++ ) {
+		idTCP *s = sockets[i];
+		if ( !s->fd || s->fd >= FD_SETSIZE ) {
+			continue;
+		}
+		if ( ( s->waitFlags & TCP_WAIT_READ ) && FD_ISSET( s->fd, &set ) ) {
+			s->readyFlags |= TCP_WAIT_READ;
+		}
+		if ( ( s->waitFlags & TCP_WAIT_WRITE ) && FD_ISSET( s->fd, &writeSet ) ) {
+			s->readyFlags |= TCP_WAIT_WRITE;
+		}
+		if ( s->readyFlags ) {
+			flags |= SYS_WAIT_SOCKET;
+		}
+	}
+	return flags;
+}
+
 //=============================================================================
 
 /*
@@ -556,6 +633,8 @@ idTCP::idTCP
 idTCP::idTCP() {
 	fd = 0;
 	memset(&address, 0, sizeof(address));
+	waitFlags = 0;
+	readyFlags = 0;
 }
 
 /*
@@ -723,3 +802,143 @@ int	idTCP::Write(void *data, int size) {
 
 	return nbytes;
 }
+
+/*
+==================
+idTCP::WriteV
+==================
+*/
+int idTCP::WriteV( const void * const *data, const int *sizes, int count ) {
+	struct iovec	iov[16];
+	int				i, nbytes;
+
+	if ( !fd ) {
+		common->Printf( "idTCP::WriteV: not initialized\n" );
+		return -1;
+	}
+
+	count = Min( count, (int)( sizeof( iov ) / sizeof( iov[0] ) ) );
+	for ( i = 0; i < count; i++ ) {
+		iov[i].iov_base = const_cast<void *>( data[i] );
+		iov[i].iov_len = sizes[i];
+	}
+
+#ifdef MSG_NOSIGNAL
+	// sendmsg is writev that can be told not to raise SIGPIPE
+	struct msghdr msg;
+	memset( &msg, 0, sizeof( msg ) );
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+	do {
+		nbytes = sendmsg( fd, &msg, MSG_NOSIGNAL );
+	} while ( nbytes == -1 && errno == EINTR );
+#else
+	signal( SIGPIPE, SIG_IGN );
+	do {
+		nbytes = writev( fd, iov, count );
+	} while ( nbytes == -1 && errno == EINTR );
+#endif
+	if ( nbytes == -1 ) {
+		if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+			return 0;
+		}
+		common->DPrintf( "idTCP::WriteV: %s\n", strerror( errno ) );
+		Close();
+		return -1;
+	}
+
+	return nbytes;
+}
+
+/*
+==================
+idTCP::Listen
+==================
+*/
+bool idTCP::Listen( int port ) {
+	struct sockaddr_in	sadr;
+	int					status, reuse;
+
+	if ( fd ) {
+		common->Warning( "idTCP::Listen: already initialized?\n" );
+		Close();
+	}
+
+	if ( ( fd = socket( PF_INET, SOCK_STREAM, 0 ) ) == -1 ) {
+		fd = 0;
+		common->Printf( "ERROR: idTCP::Listen: socket: %s\n", strerror( errno ) );
+		return false;
+	}
+
+	// don't wait for old connections to time out after a restart
+	reuse = 1;
+	setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof( reuse ) );
+
+	memset( &sadr, 0, sizeof( sadr ) );
+	sadr.sin_family = AF_INET;
+	sadr.sin_addr.s_addr = INADDR_ANY;
+	sadr.sin_port = htons( (short)port );
+	if ( bind( fd, (const sockaddr *)&sadr, sizeof( sadr ) ) == -1 || listen( fd, 16 ) == -1 ) {
+		common->Printf( "ERROR: idTCP::Listen: port %d: %s\n", port, strerror( errno ) );
+		close( fd );
+		fd = 0;
+		return false;
+	}
+
+	if ( ( status = fcntl( fd, F_GETFL, 0 ) ) != -1 ) {
+		status = fcntl( fd, F_SETFL, status | O_NONBLOCK );
+	}
+	if ( status == -1 ) {
+		common->Printf( "ERROR: idTCP::Listen: fcntl / O_NONBLOCK: %s\n", strerror( errno ) );
+		close( fd );
+		fd = 0;
+		return false;
+	}
+
+	memset( &address, 0, sizeof( address ) );
+	address.type = NA_IP;
+	address.port = port;
+	return true;
+}
+
+/*
+==================
+idTCP::Accept
+==================
+*/
+int idTCP::Accept( idTCP &client ) {
+	struct sockaddr_in	sadr;
+	socklen_t			len;
+	int					newfd, status;
+
+	if ( !fd ) {
+		return 0;
+	}
+
+	len = sizeof( sadr );
+	do {
+		newfd = accept( fd, (sockaddr *)&sadr, &len );
+	} while ( newfd == -1 && errno == EINTR );
+	if ( newfd == -1 ) {
+		if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED ) {
+			return 0;
+		}
+		// EMFILE, ENFILE, ENOBUFS: the connection stays queued
+		common->DPrintf( "idTCP::Accept: %s\n", strerror( errno ) );
+		return -1;
+	}
+
+	if ( ( status = fcntl( newfd, F_GETFL, 0 ) ) != -1 ) {
+		status = fcntl( newfd, F_SETFL, status | O_NONBLOCK );
+	}
+	if ( status == -1 ) {
+		common->DPrintf( "idTCP::Accept: fcntl / O_NONBLOCK: %s\n", strerror( errno ) );
+		close( newfd );
+		return 0;
+	}
+
+	client.Close();
+	client.fd = newfd;
+	SockadrToNetadr( &sadr, &client.address );
+	return 1;
+}
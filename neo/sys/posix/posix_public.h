@@ -40,6 +40,7 @@ void		Posix_SetExit(int ret); // override the exit code
 void		Posix_SetExitSpawn( const char *exeName ); // set the process to be spawned when we quit
 
 void		Posix_InitConsoleInput( void );
+int			Posix_ConsoleInputFD( void ); // descriptor to wait on for console input, -1 if there is none
 void		Posix_Shutdown( void );
 
 void		Sys_DoStartProcess( const char *exeName, bool dofork = true ); // if not forking, current process gets replaced
@@ -58,6 +58,10 @@ unsigned int idSysLocal::GetMilliseconds( void ) {
 	return Sys_Milliseconds();
 }
 
+double idSysLocal::GetMicroseconds( void ) {
+	return Sys_Microseconds();
+}
+
 int idSysLocal::GetProcessorId( void ) {
 	return Sys_GetProcessorId();
 }
@@ -41,6 +41,7 @@ typedef enum {
 	CPUID_SSE2							= 0x00080,	// Streaming SIMD Extensions 2
 	CPUID_SSE3							= 0x00100,	// Streaming SIMD Extentions 3 aka Prescott's New Instructions
 	CPUID_ALTIVEC						= 0x00200,	// AltiVec
+	CPUID_PCLMUL						= 0x00400,	// carry-less multiplication (PCLMULQDQ)
 } cpuidSimd_t;
 
 typedef enum {
@@ -111,14 +112,16 @@ void			Sys_Printf( const char *msg, ... )id_attribute((format(printf,1,2)));
 void			Sys_DebugPrintf( const char *fmt, ... )id_attribute((format(printf,1,2)));
 void			Sys_DebugVPrintf( const char *fmt, va_list arg );
 
-// allow game to yield CPU time
-// NOTE: due to SDL_TIMESLICE this is very bad portability karma, and should be completely removed
+// allow game to yield CPU time, 0 just gives up the time slice
 void			Sys_Sleep( int msec );
 
 // Sys_Milliseconds should only be used for profiling purposes,
 // any game related timing information should come from event timestamps
 unsigned int	Sys_Milliseconds( void );
 
+// high resolution clock for profiling, the origin is arbitrary
+double			Sys_Microseconds( void );
+
 // returns a selection of the CPUID_* flags
 int				Sys_GetProcessorId( void );
 
@@ -237,6 +240,8 @@ struct netadr_t {
 
 #define	PORT_ANY			-1
 
+class idTCP;
+
 class idPort {
 public:
 				idPort();				// this just zeros netSocket and port
@@ -261,6 +266,8 @@ public:
 private:
 	netadr_t	bound_to;		// interface and port
 	int			netSocket;		// OS specific socket
+
+	friend int	Sys_WaitForEvents( const idPort &port, int timeout, idTCP **sockets, int numSockets );
 };
 
 class idTCP {
@@ -279,9 +286,33 @@ public:
 	int			Read( void *data, int size );
 	int			Write( void *data, int size );
 
+	// writes the buffers in order with a single call, returns the number of bytes written,
+	// 0 if the socket can't take more right now or -1 on failure (and closes socket)
+	int			WriteV( const void * const *data, const int *sizes, int count );
+
+	// non blocking listening socket on all interfaces
+	bool		Listen( int port );
+	// takes a pending connection, returns 1 if there was one, 0 if there was none or it
+	// couldn't be set up and -1 if accept failed, the listener can stay readable then
+	int			Accept( idTCP &client );
+
+	bool		IsOpen( void ) const { return fd != 0; }
+	netadr_t	GetAdr( void ) const { return address; }
+
+	int			waitFlags;		// TCP_WAIT_ flags Sys_WaitForEvents should wait for
+	int			readyFlags;		// TCP_WAIT_ flags Sys_WaitForEvents found
+
 private:
-	netadr_t	address;		// remote address
+	netadr_t	address;		// remote address, the bound address for listening sockets
 	int			fd;				// OS specific socket
+
+	friend int	Sys_WaitForEvents( const idPort &port, int timeout, idTCP **sockets, int numSockets );
+};
+
+// idTCP::waitFlags and readyFlags
+enum {
+	TCP_WAIT_READ		= BIT( 0 ),	// data or a connection is pending, or the remote closed
+	TCP_WAIT_WRITE		= BIT( 1 )	// the socket can take more data
 };
 
 				// parses the port number
@@ -296,6 +327,20 @@ bool			Sys_CompareNetAdrBase( const netadr_t a, const netadr_t b );
 void			Sys_InitNetworking( void );
 void			Sys_ShutdownNetworking( void );
 
+// flags returned by Sys_WaitForEvents
+enum {
+	SYS_WAIT_TIMEOUT	= 0,
+	SYS_WAIT_PACKET		= BIT( 0 ),	// a packet can be read from the port
+	SYS_WAIT_CONSOLE	= BIT( 1 ),	// Sys_ConsoleInput should be polled
+	SYS_WAIT_SOCKET		= BIT( 2 )	// one of the TCP sockets has readyFlags set
+};
+
+				// blocks until a packet is pending on the port, console input is pending,
+				// one of the TCP sockets is ready for its waitFlags or timeout milliseconds
+				// have passed, a negative timeout waits forever
+				// platforms that can't wait on the console report SYS_WAIT_CONSOLE on every return
+int				Sys_WaitForEvents( const idPort &port, int timeout, idTCP **sockets = NULL, int numSockets = 0 );
+
 
 /*
 ==============================================================
@@ -305,18 +350,21 @@ void			Sys_ShutdownNetworking( void );
 ==============================================================
 */
 
-struct SDL_Thread;
-
 typedef int (*xthread_t)( void * );
 
 typedef struct {
 	const char		*name;
-	SDL_Thread		*threadHandle;
+	void			*threadHandle;
 	unsigned int	threadId;
 } xthreadInfo;
 
+// the name shows up in debuggers and system tools where the platform supports it
 void				Sys_CreateThread( xthread_t function, void *parms, xthreadInfo &info, const char *name );
-void				Sys_DestroyThread( xthreadInfo& info ); // sets threadHandle back to 0
+void				Sys_DestroyThread( xthreadInfo& info ); // waits for the thread to finish, sets threadHandle back to 0
+
+// pins a thread, or the calling thread if info is NULL, to one core, a negative core restores the cores the process started with
+// returns false if the platform can't pin threads or the core doesn't exist
+bool				Sys_SetThreadAffinity( xthreadInfo *info, int core );
 
 // find the name of the calling thread
 // if index != NULL, set the index in threads array (use -1 for "main" thread)
@@ -338,6 +386,23 @@ enum {
 void				Sys_EnterCriticalSection( int index = CRITICAL_SECTION_ZERO );
 void				Sys_LeaveCriticalSection( int index = CRITICAL_SECTION_ZERO );
 
+// a mutex of its own, for code that shouldn't share the critical sections above
+class idSysMutex {
+public:
+					idSysMutex( void );
+					~idSysMutex( void );
+
+	void			Lock( void );
+	bool			TryLock( void );		// false if another thread holds the lock
+	void			Unlock( void );
+
+private:
+	void *			handle;
+
+					idSysMutex( const idSysMutex & );
+	void			operator=( const idSysMutex & );
+};
+
 const int MAX_TRIGGER_EVENTS		= 4;
 
 enum {
@@ -364,6 +429,7 @@ public:
 	virtual void			DebugVPrintf( const char *fmt, va_list arg ) = 0;
 
 	virtual unsigned int	GetMilliseconds( void ) = 0;
+	virtual double			GetMicroseconds( void ) = 0;
 	virtual int				GetProcessorId( void ) = 0;
 	virtual void			FPU_SetFTZ( bool enable ) = 0;
 	virtual void			FPU_SetDAZ( bool enable ) = 0;
@@ -26,40 +26,141 @@ If you have questions concerning this license or the applicable additional terms
 ===========================================================================
 */
 
-#include <SDL_version.h>
-#include <SDL_mutex.h>
-#include <SDL_thread.h>
-#include <SDL_timer.h>
-
 #include "sys/platform.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/time.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+#endif
+
+#include "idlib/Heap.h"
+#include "idlib/Str.h"
+#include "idlib/containers/List.h"
 #include "framework/Common.h"
 
 #include "sys/sys_public.h"
 
-static SDL_mutex	*mutex[MAX_CRITICAL_SECTIONS] = { };
-static SDL_cond		*cond[MAX_TRIGGER_EVENTS] = { };
-static bool			signaled[MAX_TRIGGER_EVENTS] = { };
-static bool			waiting[MAX_TRIGGER_EVENTS] = { };
+/*
+===============================================================================
+
+	Threads, locks and timers on the native thread API, pthreads everywhere
+	but on Windows.
+
+===============================================================================
+*/
+
+typedef struct sysThread_s {
+	xthread_t		function;
+	void *			parms;
+	const char *	name;
+#ifdef _WIN32
+	HANDLE			handle;
+#else
+	pthread_t		handle;
+#endif
+} sysThread_t;
+
+typedef struct sysTriggerEvent_s {
+#ifdef _WIN32
+	HANDLE			handle;						// auto-reset event
+#else
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	bool			signaled;
+	bool			waiting;
+#endif
+} sysTriggerEvent_t;
+
+static idSysMutex	criticalSections[MAX_CRITICAL_SECTIONS];
+static sysTriggerEvent_t	events[MAX_TRIGGER_EVENTS];
+
+#if defined(__linux__) && defined(__GLIBC__)
+static cpu_set_t	startupAffinity;			// what the process was started with, taskset or cpuset
+static bool			startupAffinityValid;
+#endif
 
-static xthreadInfo	*thread[MAX_THREADS] = { };
-static size_t		thread_count = 0;
+static idSysMutex	threadLock;					// protects threads and nextThreadId
+static idList<xthreadInfo *>	threads;
+static unsigned int	nextThreadId = 1;
 
 /*
 ==============
 Sys_Sleep
 ==============
 */
-void Sys_Sleep(int msec) {
-	SDL_Delay(msec);
+void Sys_Sleep( int msec ) {
+#ifdef _WIN32
+	Sleep( msec );
+#else
+	if ( msec <= 0 ) {
+		sched_yield();
+		return;
+	}
+
+	struct timespec ts;
+	ts.tv_sec = msec / 1000;
+	ts.tv_nsec = ( msec % 1000 ) * 1000000;
+	while ( nanosleep( &ts, &ts ) == -1 && errno == EINTR ) {
+	}
+#endif
+}
+
+/*
+================
+Sys_Microseconds
+================
+*/
+double Sys_Microseconds() {
+#if defined(_WIN32)
+	static double ticksPerMicrosecond = 0.0;
+	LARGE_INTEGER count;
+
+	if ( ticksPerMicrosecond == 0.0 ) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency( &frequency );
+		ticksPerMicrosecond = (double)frequency.QuadPart / 1000000.0;
+	}
+	QueryPerformanceCounter( &count );
+	return (double)count.QuadPart / ticksPerMicrosecond;
+#elif defined(__APPLE__)
+	static double ticksPerMicrosecond = 0.0;
+
+	if ( ticksPerMicrosecond == 0.0 ) {
+		mach_timebase_info_data_t timebase;
+		mach_timebase_info( &timebase );
+		ticksPerMicrosecond = 1000.0 * timebase.denom / timebase.numer;
+	}
+	return (double)mach_absolute_time() / ticksPerMicrosecond;
+#elif defined(__AROS__)
+	struct timeval tv;
+	gettimeofday( &tv, NULL );
+	return (double)tv.tv_sec * 1000000.0 + tv.tv_usec;
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec * 1000000.0 + ts.tv_nsec * 0.001;
+#endif
 }
 
 /*
 ================
 Sys_Milliseconds
+
+  Milliseconds since the first call.
 ================
 */
 unsigned int Sys_Milliseconds() {
-	return SDL_GetTicks();
+	static double base = Sys_Microseconds();
+
+	return (unsigned int)( ( Sys_Microseconds() - base ) * 0.001 );
 }
 
 /*
@@ -68,34 +169,33 @@ Sys_InitThreads
 ==================
 */
 void Sys_InitThreads() {
-	// critical sections
-	for (int i = 0; i < MAX_CRITICAL_SECTIONS; i++) {
-		mutex[i] = SDL_CreateMutex();
-
-		if (!mutex[i]) {
-			Sys_Printf("ERROR: SDL_CreateMutex failed\n");
+	// events
+	for ( int i = 0; i < MAX_TRIGGER_EVENTS; i++ ) {
+#ifdef _WIN32
+		events[i].handle = CreateEvent( NULL, FALSE, FALSE, NULL );
+		if ( !events[i].handle ) {
+			Sys_Printf( "ERROR: CreateEvent failed\n" );
 			return;
 		}
-	}
-
-	// events
-	for (int i = 0; i < MAX_TRIGGER_EVENTS; i++) {
-		cond[i] = SDL_CreateCond();
-
-		if (!cond[i]) {
-			Sys_Printf("ERROR: SDL_CreateCond failed\n");
+#else
+		if ( pthread_mutex_init( &events[i].mutex, NULL ) != 0 || pthread_cond_init( &events[i].cond, NULL ) != 0 ) {
+			Sys_Printf( "ERROR: pthread_cond_init failed\n" );
 			return;
 		}
-
-		signaled[i] = false;
-		waiting[i] = false;
+		events[i].signaled = false;
+		events[i].waiting = false;
+#endif
 	}
 
 	// threads
-	for (int i = 0; i < MAX_THREADS; i++)
-		thread[i] = NULL;
+	threadLock.Lock();
+	threads.Clear();
+	threadLock.Unlock();
 
-	thread_count = 0;
+	// affinity
+#if defined(__linux__) && defined(__GLIBC__)
+	startupAffinityValid = ( sched_getaffinity( 0, sizeof( startupAffinity ), &startupAffinity ) == 0 );
+#endif
 }
 
 /*
@@ -104,33 +204,110 @@ Sys_ShutdownThreads
 ==================
 */
 void Sys_ShutdownThreads() {
-	// threads
-	for (int i = 0; i < MAX_THREADS; i++) {
-		if (!thread[i])
-			continue;
+	// threads, there is no safe way to kill them
+	threadLock.Lock();
+	for ( int i = 0; i < threads.Num(); i++ ) {
+		Sys_Printf( "WARNING: Thread '%s' still running\n", threads[i]->name );
+	}
+	threads.Clear();
+	threadLock.Unlock();
 
-		Sys_Printf("WARNING: Thread '%s' still running\n", thread[i]->name);
-#if SDL_VERSION_ATLEAST(2, 0, 0)
-		// TODO no equivalent in SDL2
+	// events
+	for ( int i = 0; i < MAX_TRIGGER_EVENTS; i++ ) {
+#ifdef _WIN32
+		CloseHandle( events[i].handle );
+		events[i].handle = NULL;
 #else
-		SDL_KillThread(thread[i]->threadHandle);
+		pthread_cond_destroy( &events[i].cond );
+		pthread_mutex_destroy( &events[i].mutex );
+		events[i].signaled = false;
+		events[i].waiting = false;
 #endif
-		thread[i] = NULL;
 	}
+}
 
-	// events
-	for (int i = 0; i < MAX_TRIGGER_EVENTS; i++) {
-		SDL_DestroyCond(cond[i]);
-		cond[i] = NULL;
-		signaled[i] = false;
-		waiting[i] = false;
+/*
+==================
+idSysMutex::idSysMutex
+
+  The native object comes from malloc, mutexes are created during static
+  initialization before the heap exists.
+==================
+*/
+idSysMutex::idSysMutex( void ) {
+#ifdef _WIN32
+	CRITICAL_SECTION *cs = (CRITICAL_SECTION *)malloc( sizeof( CRITICAL_SECTION ) );
+	InitializeCriticalSection( cs );
+	handle = cs;
+#else
+	pthread_mutex_t *mutex = (pthread_mutex_t *)malloc( sizeof( pthread_mutex_t ) );
+	pthread_mutexattr_t attr;
+
+	// recursive like the SDL and win32 critical sections were
+	pthread_mutexattr_init( &attr );
+	pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+	pthread_mutex_init( mutex, &attr );
+	pthread_mutexattr_destroy( &attr );
+	handle = mutex;
+#endif
+}
+
+/*
+==================
+idSysMutex::~idSysMutex
+==================
+*/
+idSysMutex::~idSysMutex( void ) {
+#ifdef _WIN32
+	DeleteCriticalSection( (CRITICAL_SECTION *)handle );
+#else
+	pthread_mutex_destroy( (pthread_mutex_t *)handle );
+#endif
+	free( handle );
+	handle = NULL;
+}
+
+/*
+==================
+idSysMutex::Lock
+==================
+*/
+void idSysMutex::Lock( void ) {
+#ifdef _WIN32
+	EnterCriticalSection( (CRITICAL_SECTION *)handle );
+#else
+	if ( pthread_mutex_lock( (pthread_mutex_t *)handle ) != 0 ) {
+		common->Error( "ERROR: pthread_mutex_lock failed\n" );
 	}
+#endif
+}
+
+/*
+==================
+idSysMutex::TryLock
+==================
+*/
+bool idSysMutex::TryLock( void ) {
+#ifdef _WIN32
+	return TryEnterCriticalSection( (CRITICAL_SECTION *)handle ) != FALSE;
+#else
+	return pthread_mutex_trylock( (pthread_mutex_t *)handle ) == 0;
+#endif
+}
 
-	// critical sections
-	for (int i = 0; i < MAX_CRITICAL_SECTIONS; i++) {
-		SDL_DestroyMutex(mutex[i]);
-		mutex[i] = NULL;
+/*
+==================
+idSysMutex::Unlock
+==================
+*/
+void idSysMutex::Unlock( void ) {
+#ifdef _WIN32
+	LeaveCriticalSection( (CRITICAL_SECTION *)handle );
+#else
+	if ( pthread_mutex_unlock( (pthread_mutex_t *)handle ) != 0 ) {
+		common->Error( "ERROR: pthread_mutex_unlock failed\n" );
 	}
+#endif
 }
 
 /*
@@ -138,11 +315,10 @@ void Sys_ShutdownThreads() {
 Sys_EnterCriticalSection
 ==================
 */
-void Sys_EnterCriticalSection(int index) {
-	assert(index >= 0 && index < MAX_CRITICAL_SECTIONS);
+void Sys_EnterCriticalSection( int index ) {
+	assert( index >= 0 && index < MAX_CRITICAL_SECTIONS );
 
-	if (SDL_LockMutex(mutex[index]) != 0)
-		common->Error("ERROR: SDL_LockMutex failed\n");
+	criticalSections[index].Lock();
 }
 
 /*
@@ -150,23 +326,19 @@ void Sys_EnterCriticalSection(int index) {
 Sys_LeaveCriticalSection
 ==================
 */
-void Sys_LeaveCriticalSection(int index) {
-	assert(index >= 0 && index < MAX_CRITICAL_SECTIONS);
+void Sys_LeaveCriticalSection( int index ) {
+	assert( index >= 0 && index < MAX_CRITICAL_SECTIONS );
 
-	if (SDL_UnlockMutex(mutex[index]) != 0)
-		common->Error("ERROR: SDL_UnlockMutex failed\n");
+	criticalSections[index].Unlock();
 }
 
 /*
 ======================================================
 wait and trigger events
-we use a single lock to manipulate the conditions, CRITICAL_SECTION_SYS
-
-the semantics match the win32 version. signals raised while no one is waiting stay raised until a wait happens (which then does a simple pass-through)
 
-NOTE: we use the same mutex for all the events. I don't think this would become much of a problem
-cond_wait unlocks atomically with setting the wait condition, and locks it back before exiting the function
-the potential for time wasting lock waits is very low
+the semantics are those of win32 auto-reset events, which is what Windows uses.
+signals raised while no one is waiting stay raised until a wait happens (which
+then does a simple pass-through)
 ======================================================
 */
 
@@ -175,23 +347,30 @@ the potential for time wasting lock waits is very low
 Sys_WaitForEvent
 ==================
 */
-void Sys_WaitForEvent(int index) {
-	assert(index >= 0 && index < MAX_TRIGGER_EVENTS);
+void Sys_WaitForEvent( int index ) {
+	assert( index >= 0 && index < MAX_TRIGGER_EVENTS );
 
-	Sys_EnterCriticalSection(CRITICAL_SECTION_SYS);
+#ifdef _WIN32
+	if ( WaitForSingleObject( events[index].handle, INFINITE ) != WAIT_OBJECT_0 ) {
+		common->Error( "ERROR: WaitForSingleObject failed\n" );
+	}
+#else
+	sysTriggerEvent_t &event = events[index];
 
-	assert(!waiting[index]);	// WaitForEvent from multiple threads? that wouldn't be good
-	if (signaled[index]) {
-		// emulate windows behaviour: signal has been raised already. clear and keep going
-		signaled[index] = false;
-	} else {
-		waiting[index] = true;
-		if (SDL_CondWait(cond[index], mutex[CRITICAL_SECTION_SYS]) != 0)
-			common->Error("ERROR: SDL_CondWait failed\n");
-		waiting[index] = false;
+	pthread_mutex_lock( &event.mutex );
+
+	assert( !event.waiting );	// WaitForEvent from multiple threads? that wouldn't be good
+	event.waiting = true;
+	while ( !event.signaled ) {
+		if ( pthread_cond_wait( &event.cond, &event.mutex ) != 0 ) {
+			common->Error( "ERROR: pthread_cond_wait failed\n" );
+		}
 	}
+	event.signaled = false;
+	event.waiting = false;
 
-	Sys_LeaveCriticalSection(CRITICAL_SECTION_SYS);
+	pthread_mutex_unlock( &event.mutex );
+#endif
 }
 
 /*
@@ -199,52 +378,115 @@ void Sys_WaitForEvent(int index) {
 Sys_TriggerEvent
 ==================
 */
-void Sys_TriggerEvent(int index) {
-	assert(index >= 0 && index < MAX_TRIGGER_EVENTS);
+void Sys_TriggerEvent( int index ) {
+	assert( index >= 0 && index < MAX_TRIGGER_EVENTS );
+
+#ifdef _WIN32
+	SetEvent( events[index].handle );
+#else
+	sysTriggerEvent_t &event = events[index];
 
-	Sys_EnterCriticalSection(CRITICAL_SECTION_SYS);
+	pthread_mutex_lock( &event.mutex );
 
-	if (waiting[index]) {
-		if (SDL_CondSignal(cond[index]) != 0)
-			common->Error("ERROR: SDL_CondSignal failed\n");
-	} else {
-		// emulate windows behaviour: if no thread is waiting, leave the signal on so next wait keeps going
-		signaled[index] = true;
+	event.signaled = true;
+	if ( event.waiting ) {
+		pthread_cond_signal( &event.cond );
 	}
 
-	Sys_LeaveCriticalSection(CRITICAL_SECTION_SYS);
+	pthread_mutex_unlock( &event.mutex );
+#endif
 }
 
 /*
 ==================
-Sys_CreateThread
+Sys_SetCurrentThreadName
+==================
+*/
+static void Sys_SetCurrentThreadName( const char *name ) {
+#if defined(_MSC_VER)
+	// the exception the Visual Studio debugger picks thread names from
+	#pragma pack( push, 8 )
+	struct {
+		DWORD	type;
+		LPCSTR	name;
+		DWORD	threadId;
+		DWORD	flags;
+	} info = { 0x1000, name, (DWORD)-1, 0 };
+	#pragma pack( pop )
+
+	__try {
+		RaiseException( 0x406D1388, 0, sizeof( info ) / sizeof( ULONG_PTR ), (ULONG_PTR *)&info );
+	} __except( EXCEPTION_EXECUTE_HANDLER ) {
+	}
+#elif defined(__linux__) && defined(__GLIBC__)
+	char shortName[16];		// the kernel keeps 15 characters
+
+	idStr::Copynz( shortName, name, sizeof( shortName ) );
+	pthread_setname_np( pthread_self(), shortName );
+#elif defined(__APPLE__)
+	pthread_setname_np( name );
+#endif
+}
+
+/*
+==================
+Sys_ThreadStart
 ==================
 */
-void Sys_CreateThread(xthread_t function, void *parms, xthreadInfo& info, const char *name) {
-	Sys_EnterCriticalSection();
+#ifdef _WIN32
+static DWORD WINAPI Sys_ThreadStart( LPVOID parms ) {
+#else
+static void *Sys_ThreadStart( void *parms ) {
+#endif
+	sysThread_t *thread = (sysThread_t *)parms;
+
+	Sys_SetCurrentThreadName( thread->name );
+	thread->function( thread->parms );
 
-#if SDL_VERSION_ATLEAST(2, 0, 0)
-	SDL_Thread *t = SDL_CreateThread(function, name, parms);
+	// hand the blocks the thread cached back to the central lists
+	Mem_ReleaseThreadCache();
+	return 0;
+}
+
+/*
+==================
+Sys_CreateThread
+==================
+*/
+void Sys_CreateThread( xthread_t function, void *parms, xthreadInfo& info, const char *name ) {
+	sysThread_t *thread;
+	bool created;
+
+	thread = (sysThread_t *)malloc( sizeof( sysThread_t ) );
+	thread->function = function;
+	thread->parms = parms;
+	thread->name = name;
+
+	// the new thread can't look itself up before it is in the list
+	threadLock.Lock();
+
+#ifdef _WIN32
+	DWORD id;
+	thread->handle = CreateThread( NULL, 0, Sys_ThreadStart, thread, 0, &id );
+	created = ( thread->handle != NULL );
+	info.threadId = id;
 #else
-	SDL_Thread *t = SDL_CreateThread(function, parms);
+	created = ( pthread_create( &thread->handle, NULL, Sys_ThreadStart, thread ) == 0 );
+	info.threadId = nextThreadId++;
 #endif
 
-	if (!t) {
-		common->Error("ERROR: SDL_thread for '%s' failed\n", name);
-		Sys_LeaveCriticalSection();
+	if ( !created ) {
+		threadLock.Unlock();
+		free( thread );
+		common->Error( "ERROR: thread for '%s' failed\n", name );
 		return;
 	}
 
 	info.name = name;
-	info.threadHandle = t;
-	info.threadId = SDL_GetThreadID(t);
+	info.threadHandle = thread;
+	threads.Append( &info );
 
-	if (thread_count < MAX_THREADS)
-		thread[thread_count++] = &info;
-	else
-		common->DPrintf("WARNING: MAX_THREADS reached\n");
-
-	Sys_LeaveCriticalSection();
+	threadLock.Unlock();
 }
 
 /*
@@ -252,33 +494,72 @@ void Sys_CreateThread(xthread_t function, void *parms, xthreadInfo& info, const
 Sys_DestroyThread
 ==================
 */
-void Sys_DestroyThread(xthreadInfo& info) {
-	assert(info.threadHandle);
+void Sys_DestroyThread( xthreadInfo& info ) {
+	sysThread_t *thread = (sysThread_t *)info.threadHandle;
 
-	SDL_WaitThread(info.threadHandle, NULL);
+	assert( thread );
+
+#ifdef _WIN32
+	WaitForSingleObject( thread->handle, INFINITE );
+	CloseHandle( thread->handle );
+#else
+	pthread_join( thread->handle, NULL );
+#endif
+	free( thread );
+
+	threadLock.Lock();
+	threads.Remove( &info );
+	threadLock.Unlock();
 
 	info.name = NULL;
 	info.threadHandle = NULL;
 	info.threadId = 0;
+}
 
-	Sys_EnterCriticalSection();
-
-	for (int i = 0; i < thread_count; i++) {
-		if (&info == thread[i]) {
-			thread[i] = NULL;
+/*
+==================
+Sys_SetThreadAffinity
 
-			int j;
-			for (j = i + 1; j < thread_count; j++)
-				thread[j - 1] = thread[j];
+A negative core restores the cores the process was started with.
+==================
+*/
+bool Sys_SetThreadAffinity( xthreadInfo *info, int core ) {
+#if defined(_WIN32)
+	HANDLE handle = info ? ( (sysThread_t *)info->threadHandle )->handle : GetCurrentThread();
+	DWORD_PTR processMask, systemMask, mask;
 
-			thread[j - 1] = NULL;
-			thread_count--;
+	if ( !GetProcessAffinityMask( GetCurrentProcess(), &processMask, &systemMask ) ) {
+		return false;
+	}
+	if ( core < 0 ) {
+		mask = processMask;
+	} else if ( core < (int)( sizeof( DWORD_PTR ) * 8 ) ) {
+		mask = (DWORD_PTR)1 << core;
+	} else {
+		return false;
+	}
+	return ( mask & processMask ) && SetThreadAffinityMask( handle, mask ) != 0;
+#elif defined(__linux__) && defined(__GLIBC__)
+	pthread_t handle = info ? ( (sysThread_t *)info->threadHandle )->handle : pthread_self();
+	cpu_set_t set;
 
-			break;
+	if ( core >= CPU_SETSIZE ) {
+		return false;
+	}
+	if ( core < 0 ) {
+		if ( !startupAffinityValid ) {
+			return false;
 		}
+		set = startupAffinity;
+	} else {
+		CPU_ZERO( &set );
+		CPU_SET( core, &set );
 	}
-
-	Sys_LeaveCriticalSection( );
+	return pthread_setaffinity_np( handle, sizeof( set ), &set ) == 0;
+#else
+	// macOS only takes affinity hints, AROS and the BSDs aren't handled
+	return core < 0;
+#endif
 }
 
 /*
@@ -287,30 +568,33 @@ Sys_GetThreadName
 find the name of the calling thread
 ==================
 */
-const char *Sys_GetThreadName(int *index) {
+const char *Sys_GetThreadName( int *index ) {
 	const char *name;
 
-	Sys_EnterCriticalSection();
-
-	unsigned int id = SDL_ThreadID();
+	threadLock.Lock();
 
-	for (int i = 0; i < thread_count; i++) {
-		if (id == thread[i]->threadId) {
-			if (index)
+	for ( int i = 0; i < threads.Num(); i++ ) {
+#ifdef _WIN32
+		if ( GetCurrentThreadId() == threads[i]->threadId ) {
+#else
+		if ( pthread_equal( pthread_self(), ( (sysThread_t *)threads[i]->threadHandle )->handle ) ) {
+#endif
+			if ( index ) {
 				*index = i;
+			}
+			name = threads[i]->name;
 
-			name = thread[i]->name;
-
-			Sys_LeaveCriticalSection();
+			threadLock.Unlock();
 
 			return name;
 		}
 	}
 
-	if (index)
+	if ( index ) {
 		*index = -1;
+	}
 
-	Sys_LeaveCriticalSection();
+	threadLock.Unlock();
 
 	return "main";
 }
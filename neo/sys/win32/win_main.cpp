@@ -639,9 +639,6 @@ int main(int argc, char *argv[]) {
 			DispatchMessage(&msg);
 		}
 
-		// Give the OS a little time to recuperate.
-		Sleep(10);
-
 		Win_Frame();
 
 		// run the game
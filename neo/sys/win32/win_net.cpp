@@ -28,6 +28,7 @@ If you have questions concerning this license or the applicable additional terms
 
 #include "sys/platform.h"
 #include "framework/Common.h"
+#include "framework/Profiler.h"
 
 #include "sys/win32/win_local.h"
 
@@ -714,6 +715,7 @@ idPort::GetPacket
 ==================
 */
 bool idPort::GetPacket( netadr_t &from, void *data, int &size, int maxSize ) {
+	TRACE_SCOPE( "idPort::GetPacket" );
 	udpMsg_t *msg;
 	bool ret;
 
@@ -790,12 +792,89 @@ bool idPort::GetPacketBlocking( netadr_t &from, void *data, int &size, int maxSi
 	return false;
 }
 
+/*
+==================
+Sys_WaitForEvents
+
+the console is a window, so it can't be waited on like the socket
+wake up regularly to let the message pump feed it
+==================
+*/
+int Sys_WaitForEvents( const idPort &port, int timeout, idTCP **sockets, int numSockets ) {
+	const int consolePoll = 10;
+	fd_set			set, writeSet;
+	struct timeval	tv;
+	int				i, ret, flags, numSet;
+
+	if ( timeout < 0 || timeout > consolePoll ) {
+		timeout = consolePoll;
+	}
+
+	FD_ZERO( &set );
+	FD_ZERO( &writeSet );
+	numSet = 0;
+	if ( port.netSocket ) {
+		FD_SET( port.netSocket, &set );
+		numSet++;
+	}
+	for ( i = 0; i < numSockets; i++ ) {
+		idTCP *s = sockets[i];
+		s->readyFlags = 0;
+		if ( !s->fd ) {
+			continue;
+		}
+		if ( s->waitFlags & TCP_WAIT_READ ) {
+			FD_SET( s->fd, &set );
+			numSet++;
+		}
+		if ( s->waitFlags & TCP_WAIT_WRITE ) {
+			FD_SET( s->fd, &writeSet );
+			numSet++;
+		}
+	}
+	// select fails without any socket to wait on
+	if ( !numSet ) {
+		Sleep( timeout );
+		return SYS_WAIT_CONSOLE;
+	}
+
+	tv.tv_sec = 0;
+	tv.tv_usec = timeout * 1000;
+	ret = select( 0, &set, &writeSet, NULL, &tv );
+	if ( ret == SOCKET_ERROR ) {
+		common->DPrintf( "Sys_WaitForEvents: select: %s\n", NET_ErrorString() );
+		return SYS_WAIT_CONSOLE;
+	}
+
+	flags = SYS_WAIT_CONSOLE;
+	if ( port.netSocket && FD_ISSET( port.netSocket, &set ) ) {
+		flags |= SYS_WAIT_PACKET;
+	}
+	for ( i = 0; i < numSockets; i++ ) {
+		idTCP *s = sockets[i];
+		if ( !s->fd ) {
+			continue;
+		}
+		if ( ( s->waitFlags & TCP_WAIT_READ ) && FD_ISSET( s->fd, &set ) ) {
+			s->readyFlags |= TCP_WAIT_READ;
+		}
+		if ( ( s->waitFlags & TCP_WAIT_WRITE ) && FD_ISSET( s->fd, &writeSet ) ) {
+			s->readyFlags |= TCP_WAIT_WRITE;
+		}
+		if ( s->readyFlags ) {
+			flags |= SYS_WAIT_SOCKET;
+		}
+	}
+	return flags;
+}
+
 /*
 ==================
 idPort::SendPacket
 ==================
 */
 void idPort::SendPacket( const netadr_t to, const void *data, int size ) {
+	TRACE_SCOPE( "idPort::SendPacket" );
 	udpMsg_t *msg;
 
 	if ( to.type == NA_BAD ) {
@@ -853,6 +932,8 @@ idTCP::idTCP
 idTCP::idTCP() {
 	fd = 0;
 	memset( &address, 0, sizeof( address ) );
+	waitFlags = 0;
+	readyFlags = 0;
 }
 
 /*
@@ -978,3 +1059,117 @@ int idTCP::Write( void *data, int size ) {
 
 	return nbytes;
 }
+
+/*
+==================
+idTCP::WriteV
+==================
+*/
+int idTCP::WriteV( const void * const *data, const int *sizes, int count ) {
+	WSABUF	bufs[16];
+	DWORD	nbytes;
+	int		i;
+
+	if ( !fd ) {
+		common->Printf( "idTCP::WriteV: not initialized\n" );
+		return -1;
+	}
+
+	count = Min( count, (int)( sizeof( bufs ) / sizeof( bufs[0] ) ) );
+	for ( i = 0; i < count; i++ ) {
+		bufs[i].buf = (char *)data[i];
+		bufs[i].len = sizes[i];
+	}
+
+	if ( WSASend( fd, bufs, count, &nbytes, 0, NULL, NULL ) == SOCKET_ERROR ) {
+		if ( WSAGetLastError() == WSAEWOULDBLOCK ) {
+			return 0;
+		}
+		common->DPrintf( "idTCP::WriteV: %s\n", NET_ErrorString() );
+		Close();
+		return -1;
+	}
+
+	return nbytes;
+}
+
+/*
+==================
+idTCP::Listen
+==================
+*/
+bool idTCP::Listen( int port ) {
+	unsigned long		_true = 1;
+	struct sockaddr_in	sadr;
+
+	if ( fd ) {
+		common->Warning( "idTCP::Listen: already initialized?" );
+		Close();
+	}
+
+	if ( ( fd = socket( AF_INET, SOCK_STREAM, 0 ) ) == INVALID_SOCKET ) {
+		fd = 0;
+		common->Printf( "ERROR: idTCP::Listen: socket: %s\n", NET_ErrorString() );
+		return false;
+	}
+
+	memset( &sadr, 0, sizeof( sadr ) );
+	sadr.sin_family = AF_INET;
+	sadr.sin_addr.s_addr = INADDR_ANY;
+	sadr.sin_port = htons( (short)port );
+	if ( bind( fd, (const sockaddr *)&sadr, sizeof( sadr ) ) == SOCKET_ERROR || listen( fd, 16 ) == SOCKET_ERROR ) {
+		common->Printf( "ERROR: idTCP::Listen: port %d: %s\n", port, NET_ErrorString() );
+		closesocket( fd );
+		fd = 0;
+		return false;
+	}
+
+	if ( ioctlsocket( fd, FIONBIO, &_true ) == SOCKET_ERROR ) {
+		common->Printf( "ERROR: idTCP::Listen: ioctl FIONBIO: %s\n", NET_ErrorString() );
+		closesocket( fd );
+		fd = 0;
+		return false;
+	}
+
+	memset( &address, 0, sizeof( address ) );
+	address.type = NA_IP;
+	address.port = port;
+	return true;
+}
+
+/*
+==================
+idTCP::Accept
+==================
+*/
+int idTCP::Accept( idTCP &client ) {
+	unsigned long	_true = 1;
+	struct sockaddr	sadr;
+	int				len, err;
+	SOCKET			newfd;
+
+	if ( !fd ) {
+		return 0;
+	}
+
+	len = sizeof( sadr );
+	if ( ( newfd = accept( fd, &sadr, &len ) ) == INVALID_SOCKET ) {
+		err = WSAGetLastError();
+		if ( err == WSAEWOULDBLOCK || err == WSAECONNRESET ) {
+			return 0;
+		}
+		common->DPrintf( "idTCP::Accept: %s\n", NET_ErrorString() );
+		return -1;
+	}
+
+	if ( ioctlsocket( newfd, FIONBIO, &_true ) == SOCKET_ERROR ) {
+		common->DPrintf( "idTCP::Accept: ioctl FIONBIO: %s\n", NET_ErrorString() );
+		closesocket( newfd );
+		return 0;
+	}
+
+	client.Close();
+	client.fd = newfd;
+	Net_SockadrToNetadr( &sadr, &client.address );
+	return 1;
+}